@@ -48,16 +48,6 @@ class ADrawable
 		 * \param	type	Type of the subelement. This helps when the primitive has more subelement.
 		 */
 		virtual void select(unsigned i, int type) = 0;
-
-		/**
-		 * Selects the i-th subelement of the primitive with the given type in the given circle.
-		 * \param	i		The number of the subelement in it's array.
-		 * \param	type	Type of the subelement. This helps when the primitive has more subelement.
-		 * \param	xc		\e x coordinate of the selection circle's center.
-		 * \param	yc		\e y coordinate of the selection circle's center.
-		 * \param	r		Radius of the selection circle's center.
-		 */
-		virtual void circleSelect(unsigned i, int type, int xc, int yc, float r) = 0;
 };
 
 } /* namespace Animata */
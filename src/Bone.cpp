@@ -34,6 +34,8 @@
 
 using namespace Animata;
 
+HandleTable<Bone> *Bone::handles = new HandleTable<Bone>;
+
 /**
  * Constructs a bone from the two given joints.
  * \param j0 pointer to joint 0
@@ -45,6 +47,7 @@ Bone::Bone(Joint *j0, Joint *j1)
 	this->j1 = j1;
 
 	damp = BONE_DEFAULT_DAMP;
+	inNameIndex = false;
 
 	float x0 = j0->x;
 	float y0 = j0->y;
@@ -56,6 +59,8 @@ Bone::Bone(Joint *j0, Joint *j1)
 	dOrig = sqrt((x1-x0)*(x1-x0) + (y1-y0)*(y1-y0));
 
 	selected = false;
+	selectionIndex = 0;
+	index = 0;
 
 	dsts = weights = sa = ca = NULL;
 	attachedVertices = new vector<Vertex *>;
@@ -70,10 +75,12 @@ Bone::Bone(Joint *j0, Joint *j1)
 	tempo = 0.0;
 	time = M_PI_2; // pi/2 -> bone animation starts at maximum length
 
+	handle = handles->add(this);
 }
 
 Bone::~Bone()
 {
+	handles->remove(handle);
 	disattachVertices();
 	delete attachedVertices;
 }
@@ -260,14 +267,6 @@ void Bone::draw(int mouseOver, int active)
 
 }
 
-/**
- * Inverts the bone's state of selection.
- **/
-void Bone::flipSelection(void)
-{
-	selected = !selected;
-}
-
 /**
  * Returns the name of the bone.
  * \return pointer to name
@@ -284,8 +283,18 @@ const char *Bone::getName(void)
  **/
 void Bone::setName(const char *str)
 {
+	// the name index is keyed by the name, the bone is added again if it
+	// was in the index, also when it was unnamed
+	NameIndex<Bone> *index = ui ? ui->editorBox->getBoneNames() : NULL;
+	bool indexed = index && index->remove(this);
+
 	strncpy(name, str, 15);
 	name[15] = 0;
+
+	if (indexed)
+		index->add(this);
+	if (ui)
+		ui->editorBox->namesChanged();
 }
 
 /**
@@ -368,6 +377,7 @@ void Bone::attachVertices(vector<Vertex *> *verts)
 			ca[i] = vd * (cos(a));
 
 			attachedVertices->push_back(v);
+			v->bones.push_back(this);
 		}
 	}
 }
@@ -392,6 +402,7 @@ void Bone::attachVertices(vector<Vertex *> *verts, float *dsts,
 	for (unsigned i = 0; i < count; i++)
 	{
 		attachedVertices->push_back((*verts)[i]);
+		(*verts)[i]->bones.push_back(this);
 	}
 	this->dsts = dsts;
 	this->weights = weights;
@@ -421,13 +432,36 @@ void Bone::recalculateWeights(void)
 	}
 }
 
+/**
+ * Removes the bone from the bones of an attached vertex.
+ * \param v pointer to vertex
+ * \param b pointer to bone
+ **/
+static void removeVertexBone(Vertex *v, Bone *b)
+{
+	for (unsigned i = 0; i < v->bones.size(); i++)
+	{
+		if (v->bones[i] == b)
+		{
+			v->bones[i] = v->bones.back();
+			v->bones.pop_back();
+			break;
+		}
+	}
+}
+
 /**
  * Disattach vertex from bone.
  * \param v pointer to vertex
  **/
 void Bone::disattachVertex(Vertex *v)
 {
-	if (attachedVertices->empty() || v == NULL)
+	if (v == NULL)
+		return;
+
+	removeVertexBone(v, this);
+
+	if (attachedVertices->empty())
 		return;
 
 	// delete vertex pointer from vector
@@ -452,15 +486,42 @@ void Bone::disattachVertex(Vertex *v)
 	}
 }
 
+/**
+ * Selects the vertices inside the selection circle of the bone.
+ * The circle is tested in layer coordinates, its radius is based on the
+ * current length of the bone like the circle drawn in the editor.
+ * \param mesh the mesh of the vertices
+ **/
+void Bone::selectVerticesInRange(Mesh *mesh)
+{
+	float dx = j1->x - j0->x;
+	float dy = j1->y - j0->y;
+	float x = j0->x + dx * 0.5f;
+	float y = j0->y + dy * 0.5f;
+	float r = sqrt(dx*dx + dy*dy) * 0.5f * attachRadiusMult;
+
+	vector<Vertex *> *vertices = mesh->getVertices();
+	for (unsigned i = 0; i < vertices->size(); i++)
+	{
+		Vertex *v = (*vertices)[i];
+		float vx = v->coord.x - x;
+		float vy = v->coord.y - y;
+
+		if (vx*vx + vy*vy <= r*r)
+			mesh->selectVertex(v);
+	}
+}
+
 /**
  * Selects attached vertices.
+ * \param mesh the mesh of the vertices
  * \param s bool, select/deselect
  **/
-void Bone::selectAttachedVertices(bool s /* = true */)
+void Bone::selectAttachedVertices(Mesh *mesh, bool s /* = true */)
 {
 	for (unsigned i = 0; i < attachedVertices->size(); i++)
 	{
-		((*attachedVertices)[i])->selected = s;
+		mesh->selectVertex((*attachedVertices)[i], s);
 	}
 }
 
@@ -470,6 +531,8 @@ void Bone::selectAttachedVertices(bool s /* = true */)
 void Bone::disattachVertices(void)
 {
 	/* clear previously attached vertices */
+	for (unsigned i = 0; i < attachedVertices->size(); i++)
+		removeVertexBone((*attachedVertices)[i], this);
 	attachedVertices->clear();
 
 	if (dsts)
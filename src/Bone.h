@@ -52,7 +52,6 @@ class Bone
 		void release(void);
 
 		void draw(int mouseOver, int active = 1);
-		void flipSelection(void);
 
 		const char *getName(void);
 		void setName(const char *str);
@@ -63,7 +62,8 @@ class Bone
 			float *weights, float *ca, float *sa);
 
 		/// Selects attached vertices.
-		void selectAttachedVertices(bool s = true);
+		void selectAttachedVertices(Mesh *mesh, bool s = true);
+		void selectVerticesInRange(Mesh *mesh);
 		void disattachVertices(void);
 		/// Disattaches one vertex.
 		void disattachVertex(Vertex *v);
@@ -113,7 +113,13 @@ class Bone
 		Joint *j0; ///< one endpoint of bone
 		Joint *j1; ///< the other endpoint of bone
 		float damp; ///< stiffness
-		bool selected; ///< set to true if the bone is selected
+		bool selected; ///< set to true if the bone is selected, changed through Skeleton::selectBone()
+		unsigned selectionIndex; ///< position in the selection set of the skeleton while selected
+		unsigned index; ///< position in the bones of the skeleton
+		Handle handle; ///< stable identity of the bone
+		bool inNameIndex; ///< true while in the name index of the editor, changed by NameIndex
+
+		static HandleTable<Bone> *handles; ///< handles of all existing bones
 
 		/// Sets radius multiplier used when attaching vertices to bone.
 		inline void setRadiusMult(float f) { attachRadiusMult = f; }
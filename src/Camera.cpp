@@ -57,6 +57,7 @@ Camera::Camera()
 
 	width = height = 0;
 	pictureWidth = pictureHeight = 0;
+	aspect = 1.0;
 
 	zNear = 0.1f;
 	zFar = 1000.f;
@@ -64,6 +65,8 @@ Camera::Camera()
 	init = false;
 
 	parent = NULL;
+
+	calcMatrices();
 }
 
 /**
@@ -74,6 +77,19 @@ Camera::Camera()
  * /param h Height of the view.
  **/
 void Camera::setSize(int w, int h)
+{
+	calcSize(w, h);
+
+	setupPerspective();
+}
+
+/**
+ * Calculates the picture's size and aspect like setSize(), without setting
+ * up the OpenGL projection.
+ * /param w Width of the view.
+ * /param h Height of the view.
+ **/
+void Camera::calcSize(int w, int h)
 {
 	width = pictureWidth = w;
 	height = pictureHeight = h;
@@ -117,8 +133,6 @@ void Camera::setSize(int w, int h)
 			pictureHeight = (int)(pictureWidth / aspect);
 		}
 	}
-
-	setupPerspective();
 }
 
 /**
@@ -145,10 +159,10 @@ void Camera::setAspect(int w, int h)
  */
 void Camera::setupPerspective()
 {
-	glMatrixMode(GL_PROJECTION);
+	calcPerspective();
 
-	glLoadIdentity();
-	gluPerspective(fov, aspect, zNear, zFar);
+	glMatrixMode(GL_PROJECTION);
+	glLoadMatrixd(projection);
 
 	setupViewport();
 }
@@ -178,14 +192,10 @@ void Camera::setupOrtho()
  */
 void Camera::setupPickingProjection(int x, int y, int radius)
 {
-	// get the boundaries of actual viewport
-	GLint viewport[4];
-	glGetIntegerv(GL_VIEWPORT, viewport);
-
 	glMatrixMode(GL_PROJECTION);
 	glLoadIdentity();
 
-	gluPickMatrix((GLdouble)x, (GLdouble)(viewport[3] - y), (GLdouble)radius, (GLdouble)radius, viewport);
+	gluPickMatrix((GLdouble)x, (GLdouble)(viewport[3] - y), (GLdouble)radius, (GLdouble)radius, (GLint *)viewport);
 
 //	glOrtho(0, width, 0, height, -1, 1);
 	glOrtho((width - pictureWidth) / 2, width + (width - pictureWidth) / 2, (height - pictureHeight) / 2, height + (height - pictureHeight) / 2, -1, 1);
@@ -197,12 +207,10 @@ void Camera::setupPickingProjection(int x, int y, int radius)
  */
 void Camera::setupModelView()
 {
-	glMatrixMode(GL_MODELVIEW);
-	glLoadIdentity();
+	calcModelView();
 
-	gluLookAt(target.x, target.y, target.z - distance,
-			  target.x, target.y, target.z,
-			  upvector.x, upvector.y, upvector.z);
+	glMatrixMode(GL_MODELVIEW);
+	glLoadMatrixd(modelview);
 }
 
 /**
@@ -210,7 +218,88 @@ void Camera::setupModelView()
  */
 void Camera::setupViewport()
 {
+	calcViewport();
+
 //	glViewport(0, 0, pictureWidth, pictureHeight);
-	glViewport((width - pictureWidth) / 2, (height - pictureHeight) / 2, pictureWidth, pictureHeight);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+/**
+ * Calculates the modelview and perspective projection matrices and the
+ * viewport of the camera on the CPU, without changing the OpenGL state.
+ * Transform::setMatrices() uses them to project between world and screen
+ * coordinates without reading back the OpenGL matrices.
+ */
+void Camera::calcMatrices()
+{
+	calcModelView();
+	calcPerspective();
+	calcViewport();
+}
+
+/**
+ * Calculates the modelview matrix looking at \a target from \a distance,
+ * the same as gluLookAt() would.
+ */
+void Camera::calcModelView()
+{
+	// the eye looks towards +z
+	Vector3D eye(target.x, target.y, target.z - distance);
+	Vector3D f(0.f, 0.f, 1.f);
+
+	// side = forward x up, up = side x forward
+	Vector3D s(f.y * upvector.z - f.z * upvector.y,
+			   f.z * upvector.x - f.x * upvector.z,
+			   f.x * upvector.y - f.y * upvector.x);
+	s.normalize();
+	Vector3D u(s.y * f.z - s.z * f.y,
+			   s.z * f.x - s.x * f.z,
+			   s.x * f.y - s.y * f.x);
+
+	modelview[0] = s.x;
+	modelview[4] = s.y;
+	modelview[8] = s.z;
+	modelview[1] = u.x;
+	modelview[5] = u.y;
+	modelview[9] = u.z;
+	modelview[2] = -f.x;
+	modelview[6] = -f.y;
+	modelview[10] = -f.z;
+	modelview[3] = modelview[7] = modelview[11] = 0;
+
+	modelview[12] = -(s.x * eye.x + s.y * eye.y + s.z * eye.z);
+	modelview[13] = -(u.x * eye.x + u.y * eye.y + u.z * eye.z);
+	modelview[14] = f.x * eye.x + f.y * eye.y + f.z * eye.z;
+	modelview[15] = 1;
+}
+
+/**
+ * Calculates the perspective projection matrix from \a fov, \a aspect and
+ * the clipping planes, the same as gluPerspective() would.
+ */
+void Camera::calcPerspective()
+{
+	double f = 1.0 / tan(fov * M_PI / 360.0);
+
+	for (int i = 0; i < 16; i++)
+		projection[i] = 0;
+
+	projection[0] = f / aspect;
+	projection[5] = f;
+	projection[10] = (zFar + zNear) / (zNear - zFar);
+	projection[11] = -1;
+	projection[14] = 2 * zFar * zNear / (zNear - zFar);
+}
+
+/**
+ * Calculates the viewport to be the exact size as the camera-picture at
+ * \a distance, centered in the window.
+ */
+void Camera::calcViewport()
+{
+	viewport[0] = (width - pictureWidth) / 2;
+	viewport[1] = (height - pictureHeight) / 2;
+	viewport[2] = pictureWidth;
+	viewport[3] = pictureHeight;
 }
 
@@ -56,11 +56,20 @@ class Camera
 
 		bool		init;			///< shows if the camera target has already been set
 
+		double		modelview[16];	///< modelview matrix calculated by the camera
+		double		projection[16];	///< perspective projection matrix calculated by the camera
+		int			viewport[4];	///< viewport calculated by the camera
+
+		void calcModelView();
+		void calcPerspective();
+		void calcViewport();
+
 	public:
 
 		Camera();
 
 		void setSize(int w, int h);
+		void calcSize(int w, int h);
 		void setAspect(int w, int h);
 
 		void setupModelView();
@@ -69,6 +78,27 @@ class Camera
 		void setupPickingProjection(int x, int y, int radius);
 		void setupViewport();
 
+		void calcMatrices();
+
+		/**
+		 * Returns the modelview matrix of the last setupModelView() or
+		 * calcMatrices() call, without reading back OpenGL state.
+		 * \retval	const double*	Column-major modelview matrix.
+		 */
+		inline const double *getModelView() { return modelview; }
+		/**
+		 * Returns the perspective projection matrix of the last
+		 * setupPerspective() or calcMatrices() call.
+		 * \retval	const double*	Column-major projection matrix.
+		 */
+		inline const double *getProjection() { return projection; }
+		/**
+		 * Returns the viewport of the last setupViewport() or calcMatrices()
+		 * call.
+		 * \retval	const int*	Viewport position and size.
+		 */
+		inline const int *getViewport() { return viewport; }
+
 		/**
 		 * Sets the parent camera to a given one.
 		 * This will show the same picture as the parent.
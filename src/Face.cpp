@@ -25,6 +25,8 @@
 
 using namespace Animata;
 
+HandleTable<Face> *Face::handles = new HandleTable<Face>;
+
 void Face::move(float dx, float dy)
 {
 	v[0]->coord.x += dx;
@@ -47,9 +49,6 @@ Vector2D Face::center(void)
 
 void Face::attachTexture(Texture *t)
 {
-	GLint viewport[4];
-	glGetIntegerv(GL_VIEWPORT, viewport);
-
 	float scale = t->getScale();
 
 	float sx = (float)t->width * scale;
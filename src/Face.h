@@ -39,6 +39,10 @@ class Face
 {
 	public:
 		Vertex	*v[3];	///< the vertices that build up the Face
+		unsigned	index;	///< position in the faces of the mesh
+		Handle	handle;	///< stable identity of the Face
+
+		static HandleTable<Face> *handles;	///< handles of all existing faces
 
 		/**
 		 * Default constructor.
@@ -53,7 +57,10 @@ class Face
 		 * \param v3 The third Vertex.
 		 */
 		Face(Vertex	*v1 = NULL, Vertex *v2 = NULL, Vertex *v3 = NULL)
-			{ v[0] = v1; v[1] = v2; v[2] = v3; }
+			{ v[0] = v1; v[1] = v2; v[2] = v3; index = 0; handle = handles->add(this); }
+
+		/// Invalidates the handle of the Face.
+		~Face() { handles->remove(handle); }
 
 		/**
 		 * Moves the Face by the given distance.
@@ -0,0 +1,401 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include <float.h>
+#include <algorithm>
+
+#include "FaceTree.h"
+#include "PickIndex.h"
+
+using namespace Animata;
+
+/**
+ * Orders face indices by the centre of their bounding box along one axis.
+ **/
+struct FaceCentreLess
+{
+	const float *bounds;	///< bounding boxes of the faces
+	int axis;				///< 0 for \e x, 1 for \e y
+
+	bool operator()(unsigned a, unsigned b) const
+	{
+		const float *ba = bounds + a * 4 + axis;
+		const float *bb = bounds + b * 4 + axis;
+		return ba[0] + ba[2] < bb[0] + bb[2];
+	}
+};
+
+/**
+ * Creates an empty tree, it is built by update().
+ **/
+FaceTree::FaceTree()
+{
+	nodes = new vector<FaceTreeNode>;
+	order = new vector<unsigned>;
+	faces = new vector<Face *>;
+	bounds = new vector<float>;
+	stack = new vector<unsigned>;
+}
+
+FaceTree::~FaceTree()
+{
+	delete nodes;
+	delete order;
+	delete faces;
+	delete bounds;
+	delete stack;
+}
+
+/**
+ * Updates the tree to the current view coordinates of the faces. The tree
+ * is refitted if the faces are the same as the last time, otherwise it is
+ * rebuilt.
+ * \param meshFaces faces of the mesh
+ **/
+void FaceTree::update(vector<Face *> *meshFaces)
+{
+	unsigned count = meshFaces->size();
+
+	bounds->resize(count * 4);
+	for (unsigned i = 0; i < count; i++)
+	{
+		Face *face = (*meshFaces)[i];
+		float *b = &(*bounds)[i * 4];
+
+		b[0] = b[2] = face->v[0]->view.x;
+		b[1] = b[3] = face->v[0]->view.y;
+		for (int j = 1; j < 3; j++)
+		{
+			b[0] = min(b[0], face->v[j]->view.x);
+			b[1] = min(b[1], face->v[j]->view.y);
+			b[2] = max(b[2], face->v[j]->view.x);
+			b[3] = max(b[3], face->v[j]->view.y);
+		}
+
+		// faces projected to infinity cannot be found
+		if (!(b[2] - b[0] < PICK_MAX_EXTENT) || !(b[3] - b[1] < PICK_MAX_EXTENT))
+		{
+			b[0] = b[1] = FLT_MAX;
+			b[2] = b[3] = -FLT_MAX;
+		}
+	}
+
+	if ((count == faces->size()) &&
+		equal(meshFaces->begin(), meshFaces->end(), faces->begin()))
+	{
+		refit();
+	}
+	else
+	{
+		*faces = *meshFaces;
+		build();
+	}
+}
+
+/**
+ * Builds the tree from scratch for the faces.
+ **/
+void FaceTree::build(void)
+{
+	unsigned count = faces->size();
+
+	nodes->clear();
+	order->resize(count);
+	for (unsigned i = 0; i < count; i++)
+		(*order)[i] = i;
+
+	if (count == 0)
+		return;
+
+	// a binary tree with at least one face in each leaf
+	nodes->reserve(2 * count);
+	buildNode(0, count);
+}
+
+/**
+ * Builds a subtree by splitting the faces at the median of their centres
+ * along the longer axis.
+ * \param first first face of the subtree in the face order
+ * \param count number of faces in the subtree
+ * \return index of the root node of the subtree
+ **/
+unsigned FaceTree::buildNode(unsigned first, unsigned count)
+{
+	unsigned n = nodes->size();
+	nodes->push_back(FaceTreeNode());
+
+	if (count <= FACETREE_LEAF_SIZE)
+	{
+		(*nodes)[n].first = first;
+		(*nodes)[n].count = count;
+		fitNode(n);
+		return n;
+	}
+
+	float cx0 = FLT_MAX;
+	float cy0 = FLT_MAX;
+	float cx1 = -FLT_MAX;
+	float cy1 = -FLT_MAX;
+	for (unsigned i = first; i < first + count; i++)
+	{
+		float *b = &(*bounds)[(*order)[i] * 4];
+		cx0 = min(cx0, b[0] + b[2]);
+		cy0 = min(cy0, b[1] + b[3]);
+		cx1 = max(cx1, b[0] + b[2]);
+		cy1 = max(cy1, b[1] + b[3]);
+	}
+
+	FaceCentreLess less;
+	less.bounds = &(*bounds)[0];
+	less.axis = (cx1 - cx0 >= cy1 - cy0) ? 0 : 1;
+
+	unsigned mid = first + count / 2;
+	nth_element(order->begin() + first, order->begin() + mid,
+			order->begin() + first + count, less);
+
+	buildNode(first, mid - first);
+	unsigned right = buildNode(mid, first + count - mid);
+
+	(*nodes)[n].first = right;
+	(*nodes)[n].count = 0;
+	fitNode(n);
+	return n;
+}
+
+/**
+ * Recalculates the bounding boxes of all nodes from the faces, keeping the
+ * structure of the tree. The children are stored after their parent, so
+ * the nodes are fitted backwards.
+ **/
+void FaceTree::refit(void)
+{
+	for (int n = (int)nodes->size() - 1; n >= 0; n--)
+		fitNode(n);
+}
+
+/**
+ * Calculates the bounding box of a node from its faces if it is a leaf, or
+ * from its children.
+ * \param n index of the node
+ **/
+void FaceTree::fitNode(unsigned n)
+{
+	FaceTreeNode *node = &(*nodes)[n];
+
+	float x0 = FLT_MAX;
+	float y0 = FLT_MAX;
+	float x1 = -FLT_MAX;
+	float y1 = -FLT_MAX;
+
+	if (node->count)
+	{
+		for (unsigned i = node->first; i < node->first + node->count; i++)
+		{
+			float *b = &(*bounds)[(*order)[i] * 4];
+			x0 = min(x0, b[0]);
+			y0 = min(y0, b[1]);
+			x1 = max(x1, b[2]);
+			y1 = max(y1, b[3]);
+		}
+	}
+	else
+	{
+		FaceTreeNode *left = &(*nodes)[n + 1];
+		FaceTreeNode *right = &(*nodes)[node->first];
+		x0 = min(left->x0, right->x0);
+		y0 = min(left->y0, right->y0);
+		x1 = max(left->x1, right->x1);
+		y1 = max(left->y1, right->y1);
+	}
+
+	node->x0 = x0;
+	node->y0 = y0;
+	node->x1 = x1;
+	node->y1 = y1;
+}
+
+/**
+ * Finds the faces whose bounding box overlaps a rectangle.
+ * \param x0 left edge of the rectangle
+ * \param y0 bottom edge of the rectangle
+ * \param x1 right edge of the rectangle
+ * \param y1 top edge of the rectangle
+ * \param result indices of the found faces are returned here in ascending
+ *	order
+ **/
+void FaceTree::query(float x0, float y0, float x1, float y1,
+		vector<unsigned> *result)
+{
+	result->clear();
+	if (nodes->empty())
+		return;
+
+	stack->clear();
+	stack->push_back(0);
+	while (!stack->empty())
+	{
+		unsigned n = stack->back();
+		FaceTreeNode *node = &(*nodes)[n];
+		stack->pop_back();
+
+		if ((node->x0 > x1) || (node->x1 < x0) ||
+			(node->y0 > y1) || (node->y1 < y0))
+			continue;
+
+		if (node->count == 0)
+		{
+			stack->push_back(node->first);
+			stack->push_back(n + 1);
+			continue;
+		}
+
+		for (unsigned i = node->first; i < node->first + node->count; i++)
+		{
+			unsigned f = (*order)[i];
+			float *b = &(*bounds)[f * 4];
+			if ((b[0] <= x1) && (b[2] >= x0) && (b[1] <= y1) && (b[3] >= y0))
+				result->push_back(f);
+		}
+	}
+
+	// the faces are returned in drawing order
+	sort(result->begin(), result->end());
+}
+
+/**
+ * Finds the faces containing a point, of either winding.
+ * \param x \e x view coordinate of the point
+ * \param y \e y view coordinate of the point
+ * \param result indices of the found faces are returned here in ascending
+ *	order
+ **/
+void FaceTree::pointQuery(float x, float y, vector<unsigned> *result)
+{
+	query(x, y, x, y, result);
+
+	unsigned n = 0;
+	for (unsigned i = 0; i < result->size(); i++)
+	{
+		Face *face = (*faces)[(*result)[i]];
+		Vector2D *p0 = &face->v[0]->view;
+		Vector2D *p1 = &face->v[1]->view;
+		Vector2D *p2 = &face->v[2]->view;
+		float c0 = (p1->x - p0->x) * (y - p0->y) - (p1->y - p0->y) * (x - p0->x);
+		float c1 = (p2->x - p1->x) * (y - p1->y) - (p2->y - p1->y) * (x - p1->x);
+		float c2 = (p0->x - p2->x) * (y - p2->y) - (p0->y - p2->y) * (x - p2->x);
+		if (((c0 >= 0) && (c1 >= 0) && (c2 >= 0)) ||
+			((c0 <= 0) && (c1 <= 0) && (c2 <= 0)))
+			(*result)[n++] = (*result)[i];
+	}
+	result->resize(n);
+}
+
+/// Returns the squared distance of a point from a segment.
+static float segmentDistance2(float x, float y, Vector2D *a, Vector2D *b)
+{
+	float dx = b->x - a->x;
+	float dy = b->y - a->y;
+	float d2 = dx * dx + dy * dy;
+	float t = d2 > 0 ? ((x - a->x) * dx + (y - a->y) * dy) / d2 : 0;
+	t = max(0.0f, min(1.0f, t));
+	float ex = a->x + t * dx - x;
+	float ey = a->y + t * dy - y;
+	return ex * ex + ey * ey;
+}
+
+/// Returns the squared distance of a point from the bounding box of a node.
+static float nodeDistance2(FaceTreeNode *node, float x, float y)
+{
+	float dx = max(max(node->x0 - x, x - node->x1), 0.0f);
+	float dy = max(max(node->y0 - y, y - node->y1), 0.0f);
+	return dx * dx + dy * dy;
+}
+
+/**
+ * Finds the face edge nearest to a point within a distance. The nearer
+ * child of each node is searched first, and the nodes further than the
+ * nearest edge found so far are skipped.
+ * \param x \e x view coordinate of the point
+ * \param y \e y view coordinate of the point
+ * \param r maximum distance of the edge from the point
+ * \param face the index of the face of the edge is returned here
+ * \param edge the edge is returned here, edge \a i connects face vertices
+ *	\a i and \a i + 1
+ * \return true if an edge was found
+ **/
+bool FaceTree::nearestEdge(float x, float y, float r, unsigned *face,
+		int *edge)
+{
+	if (nodes->empty())
+		return false;
+
+	bool found = false;
+	float best = r * r;
+
+	stack->clear();
+	stack->push_back(0);
+	while (!stack->empty())
+	{
+		unsigned n = stack->back();
+		FaceTreeNode *node = &(*nodes)[n];
+		stack->pop_back();
+
+		if (nodeDistance2(node, x, y) > best)
+			continue;
+
+		if (node->count == 0)
+		{
+			unsigned left = n + 1;
+			unsigned right = node->first;
+			if (nodeDistance2(&(*nodes)[left], x, y) <
+				nodeDistance2(&(*nodes)[right], x, y))
+				swap(left, right);
+			stack->push_back(left);
+			stack->push_back(right);
+			continue;
+		}
+
+		for (unsigned i = node->first; i < node->first + node->count; i++)
+		{
+			unsigned f = (*order)[i];
+			Face *fc = (*faces)[f];
+			for (int j = 0; j < 3; j++)
+			{
+				float d = segmentDistance2(x, y, &fc->v[j]->view,
+						&fc->v[(j + 1) % 3]->view);
+				if (d <= best)
+				{
+					best = d;
+					*face = f;
+					*edge = j;
+					found = true;
+				}
+			}
+		}
+	}
+
+	return found;
+}
+
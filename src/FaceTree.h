@@ -0,0 +1,94 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __FACETREE_H__
+#define __FACETREE_H__
+
+#include <vector>
+
+#include "Face.h"
+
+/// maximum number of faces in a leaf of the tree
+#define FACETREE_LEAF_SIZE 4
+
+using namespace std;
+
+namespace Animata
+{
+
+/**
+ * Node of the FaceTree. The left child of an inner node follows it in the
+ * node array, so the children always come after their parent.
+ **/
+struct FaceTreeNode
+{
+	float x0, y0, x1, y1;	///< bounding box of the faces below the node
+	unsigned first;			///< first face of a leaf in the face order, or the right child of an inner node
+	unsigned count;			///< number of faces in a leaf, 0 for inner nodes
+};
+
+/**
+ * Bounding volume hierarchy over the faces of a mesh in view coordinates.
+ *
+ * The tree is built once for the faces of the mesh and refitted when only
+ * the view coordinates of the vertices change, like while the skeleton
+ * moves the mesh or the view is transformed. It is rebuilt when faces are
+ * added, deleted or reordered.
+ *
+ * Faces projected too far to be picked are kept in the tree with an empty
+ * bounding box, so they are never found.
+ **/
+class FaceTree
+{
+	public:
+		FaceTree();
+		~FaceTree();
+
+		void update(vector<Face *> *faces);
+
+		void query(float x0, float y0, float x1, float y1,
+				vector<unsigned> *result);
+		void pointQuery(float x, float y, vector<unsigned> *result);
+		bool nearestEdge(float x, float y, float r, unsigned *face, int *edge);
+
+		/// Returns the number of nodes in the tree.
+		inline unsigned getNodeCount(void) { return nodes->size(); }
+
+	private:
+		void build(void);
+		unsigned buildNode(unsigned first, unsigned count);
+		void refit(void);
+		void fitNode(unsigned n);
+
+		vector<FaceTreeNode> *nodes;	///< nodes of the tree, the root is the first
+		vector<unsigned> *order;		///< face indices in the order of the leaves
+		vector<Face *> *faces;			///< faces the tree was built for
+		vector<float> *bounds;			///< bounding box of each face, four values per face
+		vector<unsigned> *stack;		///< nodes to be visited during a query
+};
+
+} /* namespace Animata */
+
+#endif
+
@@ -0,0 +1,241 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <stdio.h>
+#include <math.h>
+#include <sys/time.h>
+
+#if defined(__APPLE__)
+	#include <OpenGL/OpenGL.h>
+#elif defined(WIN32)
+	#include <windows.h>
+#else
+	#include <GL/glx.h>
+#endif
+
+#include "FrameScheduler.h"
+
+using namespace Animata;
+
+/**
+ * Creates a frame scheduler with the default 30 fps.
+ **/
+FrameScheduler::FrameScheduler()
+{
+	fps = 0;
+	vsync = false;
+
+	start = now();
+	frame = 0;
+	period = gridPeriod = 0;
+
+	lastPresented = 0;
+	presentedFrame = 0;
+	refreshInterval = 0;
+	shortestInterval = 0;
+	refreshFrames = 0;
+
+	reportStart = start;
+	frameCount = 0;
+	frameSum = 0;
+	frameMin = frameMax = 0;
+	missed = 0;
+	missedTotal = 0;
+
+	setRate(30);
+}
+
+/**
+ * Returns the current time.
+ * \return time in seconds
+ **/
+double FrameScheduler::now(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/**
+ * Synchronises the buffer swaps of the current OpenGL context to the
+ * display refresh.
+ * \return true if the swap interval could be set
+ **/
+bool FrameScheduler::enableVSync(void)
+{
+#if defined(__APPLE__)
+	GLint interval = 1;
+	CGLContextObj context = CGLGetCurrentContext();
+	return context && (CGLSetParameter(context, kCGLCPSwapInterval, &interval) ==
+		kCGLNoError);
+#elif defined(WIN32)
+	typedef BOOL (WINAPI *SwapIntervalProc)(int);
+	SwapIntervalProc swapInterval =
+		(SwapIntervalProc)wglGetProcAddress("wglSwapIntervalEXT");
+	return swapInterval && swapInterval(1);
+#else
+	typedef int (*SwapIntervalProc)(int);
+	SwapIntervalProc swapInterval = (SwapIntervalProc)glXGetProcAddressARB(
+			(const GLubyte *)"glXSwapIntervalSGI");
+	return swapInterval && (swapInterval(1) == 0);
+#endif
+}
+
+/**
+ * Sets the frame rate. The frame grid is restarted from its current
+ * deadline if the rate changes.
+ * \param fps frames per second
+ **/
+void FrameScheduler::setRate(float fps)
+{
+	if (fps <= 0)
+		fps = 1;
+
+	if (fps == this->fps)
+		return;
+
+	this->fps = fps;
+	period = 1.0 / fps;
+
+	if (gridPeriod == 0)
+	{
+		start = now();
+		frame = 0;
+		gridPeriod = period;
+	}
+	else
+		reanchor(period);
+}
+
+/**
+ * Restarts the frame grid with a new period from its current deadline.
+ * \param p the new frame period
+ **/
+void FrameScheduler::reanchor(double p)
+{
+	start += frame * gridPeriod;
+	frame = 0;
+	gridPeriod = p;
+}
+
+/**
+ * Advances to the next frame on the grid. Deadlines which have passed by
+ * more than a period are skipped and counted as missed.
+ * \return seconds left until the next frame
+ **/
+double FrameScheduler::next(void)
+{
+	double p = period;
+	// frames are shown on the refresh, a period between two refreshes would
+	// alternate between the shorter and the longer frame time
+	if (vsync && (refreshInterval > 0))
+	{
+		double refreshes = floor(period / refreshInterval + .5);
+		p = refreshInterval * (refreshes > 1 ? refreshes : 1);
+	}
+
+	if (p != gridPeriod)
+		reanchor(p);
+
+	double t = now();
+	frame++;
+
+	double elapsed = (t - start) / p;
+	if (elapsed > frame + 1)
+	{
+		unsigned long skipped = (unsigned long)(elapsed - frame);
+		missed += skipped;
+		missedTotal += skipped;
+		frame += skipped;
+	}
+
+	double deadline = start + frame * p;
+	return deadline > t ? deadline - t : 0;
+}
+
+/**
+ * Measures the time since the previously presented frame, has to be called
+ * after the buffers of a frame are swapped. The time is not measured if a
+ * frame of the grid was skipped since the previous one.
+ **/
+void FrameScheduler::presented(void)
+{
+	double t = now();
+
+	if ((lastPresented > 0) && (frame == presentedFrame + 1))
+	{
+		double d = t - lastPresented;
+
+		if ((frameCount == 0) || (d < frameMin))
+			frameMin = d;
+		if ((frameCount == 0) || (d > frameMax))
+			frameMax = d;
+		frameSum += d;
+		frameCount++;
+
+		// with vsync every frame time is a multiple of the refresh interval
+		if (vsync)
+		{
+			if ((refreshFrames == 0) || (d < shortestInterval))
+				shortestInterval = d;
+			if (++refreshFrames == FRAMESCHEDULER_REFRESH_FRAMES)
+			{
+				// the jitter of the measurement would move the grid
+				if (fabs(shortestInterval - refreshInterval) >
+					refreshInterval * FRAMESCHEDULER_REFRESH_TOLERANCE)
+					refreshInterval = shortestInterval;
+				refreshFrames = 0;
+			}
+		}
+	}
+	lastPresented = t;
+	presentedFrame = frame;
+
+	if (t - reportStart >= FRAMESCHEDULER_REPORT_PERIOD)
+		report(t);
+}
+
+/**
+ * Starts a new statistics period. In debug builds the frame statistics of
+ * the period are printed if frames were missed.
+ * \param t current time
+ **/
+void FrameScheduler::report(double t)
+{
+#ifdef DEBUG
+	if (missed && frameCount)
+	{
+		printf("frames: %d presented, %.2f ms average (%.2f - %.2f ms), "
+				"%d missed of %.1f fps\n",
+				frameCount, frameSum / frameCount * 1000.0,
+				frameMin * 1000.0, frameMax * 1000.0, missed, fps);
+	}
+#endif
+
+	reportStart = t;
+	frameCount = 0;
+	frameSum = 0;
+	missed = 0;
+}
+
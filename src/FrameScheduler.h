@@ -0,0 +1,106 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __FRAMESCHEDULER_H__
+#define __FRAMESCHEDULER_H__
+
+/// length of the statistics period in seconds
+#define FRAMESCHEDULER_REPORT_PERIOD 5.0
+/// number of presented frames the refresh interval is estimated from
+#define FRAMESCHEDULER_REFRESH_FRAMES 120
+/// relative change of the refresh estimate which is taken as a new interval
+#define FRAMESCHEDULER_REFRESH_TOLERANCE 0.02
+
+namespace Animata
+{
+
+/**
+ * Schedules the frames of the windows and the simulation steps on a fixed
+ * time grid.
+ *
+ * The deadlines are multiples of the frame period from a fixed start time,
+ * so timer inaccuracies do not add up. When the period changes, the grid
+ * starts again from the current deadline, so the next deadline does not
+ * jump. A deadline which has already passed
+ * by more than a period is counted as a missed frame and skipped. If vsync
+ * is enabled, the period is rounded to a whole number of display refresh
+ * intervals, which is estimated from the shortest time between the presented
+ * frames. Only the time between frames presented on consecutive points of
+ * the grid is measured, the frames skipped because nothing changed or the
+ * deadline was missed would count as long frame times otherwise. The
+ * missed frames are counted by getMissedFrames(), and debug builds print the
+ * measured frame times periodically.
+ **/
+class FrameScheduler
+{
+	public:
+		FrameScheduler();
+
+		static bool enableVSync(void);
+
+		void setRate(float fps);
+		/// Sets whether buffer swaps are synchronised to the display refresh.
+		inline void setVSync(bool v) { vsync = v; }
+
+		double next(void);
+		void presented(void);
+
+		/// Returns the number of missed frames since the start.
+		inline unsigned getMissedFrames(void) { return missedTotal; }
+		/// Returns the estimated refresh interval in seconds, 0 if unknown.
+		inline double getRefreshInterval(void) { return refreshInterval; }
+
+	private:
+		static double now(void);
+
+		void report(double t);
+		void reanchor(double p);
+
+		float fps;					///< requested frame rate
+		double period;				///< frame period in seconds
+		bool vsync;					///< true if the swaps wait for the refresh
+
+		double start;				///< start time of the frame grid
+		double gridPeriod;			///< period of the frame grid since \a start
+		unsigned long frame;		///< index of the next frame on the grid
+
+		double lastPresented;		///< time of the last presented frame
+		unsigned long presentedFrame;	///< grid frame of the last presented frame
+		double refreshInterval;		///< estimated refresh interval
+		double shortestInterval;	///< shortest frame time of the estimation
+		int refreshFrames;			///< frames measured for the estimation
+
+		double reportStart;			///< start of the statistics period
+		unsigned frameCount;		///< frames presented in the period
+		double frameSum;			///< sum of the frame times in the period
+		double frameMin;			///< shortest frame time in the period
+		double frameMax;			///< longest frame time in the period
+		unsigned missed;			///< missed frames in the period
+		unsigned missedTotal;		///< missed frames since the start
+};
+
+} /* namespace Animata */
+
+#endif
+
@@ -0,0 +1,264 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <math.h>
+
+#include "GlyphBatch.h"
+
+using namespace Animata;
+
+float GlyphBatch::circleCos[GLYPH_CIRCLE_SEGMENTS + 1];
+float GlyphBatch::circleSin[GLYPH_CIRCLE_SEGMENTS + 1];
+bool GlyphBatch::circleTableInited = false;
+
+GlyphBatch *GlyphBatch::current = NULL;
+
+/**
+ * Creates a new glyph batch.
+ **/
+GlyphBatch::GlyphBatch()
+{
+	vertices = new vector<GlyphVertex>;
+
+	initCircleTable();
+}
+
+GlyphBatch::~GlyphBatch()
+{
+	if (current == this)
+		current = NULL;
+
+	delete vertices;
+}
+
+/**
+ * Fills the unit circle table shared by the batched and the immediate mode
+ * circles.
+ **/
+void GlyphBatch::initCircleTable(void)
+{
+	if (circleTableInited)
+		return;
+
+	float inc = 2 * M_PI / GLYPH_CIRCLE_SEGMENTS;
+	for (int i = 0; i < GLYPH_CIRCLE_SEGMENTS; i++)
+	{
+		circleCos[i] = cos(i * inc);
+		circleSin[i] = sin(i * inc);
+	}
+	circleCos[GLYPH_CIRCLE_SEGMENTS] = circleCos[0];
+	circleSin[GLYPH_CIRCLE_SEGMENTS] = circleSin[0];
+
+	circleTableInited = true;
+}
+
+/**
+ * Starts collecting glyphs. The Primitives drawing functions add their
+ * shapes to the batch instead of drawing them until end() is called.
+ **/
+void GlyphBatch::begin(void)
+{
+	vertices->clear();
+	current = this;
+}
+
+/**
+ * Draws the collected glyphs with the current matrices and empties the batch.
+ * Glyphs can be collected further after the flush.
+ **/
+void GlyphBatch::flush(void)
+{
+	if (vertices->empty())
+		return;
+
+	GlyphVertex *v = &(*vertices)[0];
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+
+	glColorPointer(4, GL_FLOAT, sizeof(GlyphVertex), &v->r);
+	glVertexPointer(2, GL_FLOAT, sizeof(GlyphVertex), &v->x);
+	glDrawArrays(GL_TRIANGLES, 0, vertices->size());
+
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glColor3f(1.f, 1.f, 1.f);
+
+	vertices->clear();
+}
+
+/**
+ * Draws the remaining glyphs and stops collecting.
+ **/
+void GlyphBatch::end(void)
+{
+	flush();
+	current = NULL;
+}
+
+void GlyphBatch::addVertex(float x, float y, const float *color)
+{
+	GlyphVertex gv;
+	gv.r = color[0];
+	gv.g = color[1];
+	gv.b = color[2];
+	gv.a = color[3];
+	gv.x = x;
+	gv.y = y;
+	vertices->push_back(gv);
+}
+
+/**
+ * Adds a quad as two triangles, the corners are given in order around the
+ * quad.
+ **/
+void GlyphBatch::addQuad(float x1, float y1, float x2, float y2,
+		float x3, float y3, float x4, float y4, const float *color)
+{
+	addVertex(x1, y1, color);
+	addVertex(x2, y2, color);
+	addVertex(x3, y3, color);
+
+	addVertex(x1, y1, color);
+	addVertex(x3, y3, color);
+	addVertex(x4, y4, color);
+}
+
+/**
+ * Adds a filled triangle.
+ * \param color rgba colour of the glyph
+ **/
+void GlyphBatch::addTriangle(float x1, float y1, float x2, float y2,
+		float x3, float y3, const float *color)
+{
+	addVertex(x1, y1, color);
+	addVertex(x2, y2, color);
+	addVertex(x3, y3, color);
+}
+
+/**
+ * Adds a line as a quad of the given width.
+ * \param w line width in pixels
+ * \param color rgba colour of the glyph
+ **/
+void GlyphBatch::addLine(float x1, float y1, float x2, float y2, float w,
+		const float *color)
+{
+	float dx = x2 - x1;
+	float dy = y2 - y1;
+	float d = sqrt(dx*dx + dy*dy);
+
+	if (d <= 0)
+		return;
+
+	// half width normal of the line
+	float nx = -dy / d * w * .5f;
+	float ny = dx / d * w * .5f;
+
+	addQuad(x1 + nx, y1 + ny, x2 + nx, y2 + ny,
+			x2 - nx, y2 - ny, x1 - nx, y1 - ny, color);
+}
+
+/**
+ * Adds a filled circle as a triangle fan of the unit circle table.
+ * \param color rgba colour of the glyph
+ **/
+void GlyphBatch::addCircle(float x, float y, float r, const float *color)
+{
+	for (int i = 0; i < GLYPH_CIRCLE_SEGMENTS; i++)
+	{
+		addTriangle(x, y,
+				x + r * circleCos[i], y + r * circleSin[i],
+				x + r * circleCos[i + 1], y + r * circleSin[i + 1], color);
+	}
+}
+
+/**
+ * Adds the outline of a circle as a ring of the given width.
+ * \param w width of the outline in pixels
+ * \param color rgba colour of the glyph
+ **/
+void GlyphBatch::addCircleOutline(float x, float y, float r, float w,
+		const float *color)
+{
+	float r0 = r - w * .5f;
+	float r1 = r + w * .5f;
+	if (r0 < 0)
+		r0 = 0;
+
+	for (int i = 0; i < GLYPH_CIRCLE_SEGMENTS; i++)
+	{
+		addQuad(x + r0 * circleCos[i], y + r0 * circleSin[i],
+				x + r1 * circleCos[i], y + r1 * circleSin[i],
+				x + r1 * circleCos[i + 1], y + r1 * circleSin[i + 1],
+				x + r0 * circleCos[i + 1], y + r0 * circleSin[i + 1], color);
+	}
+}
+
+/**
+ * Adds a filled axis aligned rectangle.
+ * \param color rgba colour of the glyph
+ **/
+void GlyphBatch::addRect(float x1, float y1, float x2, float y2,
+		const float *color)
+{
+	addQuad(x1, y1, x2, y1, x2, y2, x1, y2, color);
+}
+
+/**
+ * Adds the outline of an axis aligned rectangle as a frame of the given
+ * width centered on the edges.
+ * \param w width of the outline in pixels
+ * \param color rgba colour of the glyph
+ **/
+void GlyphBatch::addRectOutline(float x1, float y1, float x2, float y2,
+		float w, const float *color)
+{
+	float cx = (x1 + x2) * .5f;
+	float cy = (y1 + y2) * .5f;
+	float hw = fabs(x2 - x1) * .5f;
+	float hh = fabs(y2 - y1) * .5f;
+
+	float w0 = hw - w * .5f;
+	float h0 = hh - w * .5f;
+	float w1 = hw + w * .5f;
+	float h1 = hh + w * .5f;
+	if (w0 < 0)
+		w0 = 0;
+	if (h0 < 0)
+		h0 = 0;
+
+	// corners of the frame in order around the rectangle
+	static const float sx[5] = { -1, 1, 1, -1, -1 };
+	static const float sy[5] = { -1, -1, 1, 1, -1 };
+
+	for (int i = 0; i < 4; i++)
+	{
+		addQuad(cx + sx[i] * w0, cy + sy[i] * h0,
+				cx + sx[i] * w1, cy + sy[i] * h1,
+				cx + sx[i + 1] * w1, cy + sy[i + 1] * h1,
+				cx + sx[i + 1] * w0, cy + sy[i + 1] * h0, color);
+	}
+}
+
@@ -0,0 +1,110 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __GLYPHBATCH_H__
+#define __GLYPHBATCH_H__
+
+#if defined(__APPLE__)
+	#include <OPENGL/gl.h>
+#else
+	#include <GL/gl.h>
+#endif
+
+#include <vector>
+
+using namespace std;
+
+/// number of segments of the circle glyphs
+#define GLYPH_CIRCLE_SEGMENTS 8
+
+namespace Animata
+{
+
+/// Interleaved vertex of the glyph batch.
+struct GlyphVertex
+{
+	float r, g, b, a;	///< colour of the glyph
+	float x, y;			///< view coordinates
+};
+
+/**
+ * Collects the editor glyphs of a layer, the circles of the joints, the
+ * squares of the vertices, the bone and triangle edges, and draws them with
+ * one call.
+ *
+ * Every glyph is converted to coloured triangles, filled shapes are fans,
+ * outlines and lines are quads of the stroke weight. Glyphs are kept in the
+ * order they were added, so overlapping glyphs blend the same way as with
+ * immediate mode drawing.
+ **/
+class GlyphBatch
+{
+	public:
+		GlyphBatch();
+		~GlyphBatch();
+
+		void begin(void);
+		void flush(void);
+		void end(void);
+
+		void addTriangle(float x1, float y1, float x2, float y2,
+				float x3, float y3, const float *color);
+		void addLine(float x1, float y1, float x2, float y2, float w,
+				const float *color);
+		void addCircle(float x, float y, float r, const float *color);
+		void addCircleOutline(float x, float y, float r, float w,
+				const float *color);
+		void addRect(float x1, float y1, float x2, float y2,
+				const float *color);
+		void addRectOutline(float x1, float y1, float x2, float y2, float w,
+				const float *color);
+
+		/**
+		 * Returns the batch collecting glyphs between begin() and end().
+		 * \retval GlyphBatch* The collecting batch or NULL.
+		 **/
+		static inline GlyphBatch *getCurrent(void) { return current; }
+
+		/// cosinus values of the unit circle, the first point is repeated
+		static float circleCos[GLYPH_CIRCLE_SEGMENTS + 1];
+		/// sinus values of the unit circle, the first point is repeated
+		static float circleSin[GLYPH_CIRCLE_SEGMENTS + 1];
+
+		static void initCircleTable(void);
+
+	private:
+		vector<GlyphVertex> *vertices;	///< triangles of the glyphs
+
+		static bool circleTableInited;	///< set if the circle table is filled
+		static GlyphBatch *current;		///< the collecting batch
+
+		void addVertex(float x, float y, const float *color);
+		void addQuad(float x1, float y1, float x2, float y2,
+				float x3, float y3, float x4, float y4, const float *color);
+};
+
+} /* namespace Animata */
+
+#endif
+
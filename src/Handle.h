@@ -0,0 +1,171 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __HANDLE_H__
+#define __HANDLE_H__
+
+#include <vector>
+#include <pthread.h>
+
+using namespace std;
+
+namespace Animata
+{
+
+/**
+ * Identifies an element of a HandleTable. A handle stays valid while its
+ * element exists, and never refers to another element after it has been
+ * deleted, even if its slot is reused.
+ **/
+struct Handle
+{
+	unsigned index;			///< slot of the element in the table
+	unsigned generation;	///< generation of the slot when the handle was given
+
+	/// Creates a null handle, which refers to no element.
+	Handle() { index = ~0u; generation = 0; }
+
+	inline bool operator==(const Handle &h) const
+		{ return (index == h.index) && (generation == h.generation); }
+	inline bool operator!=(const Handle &h) const
+		{ return !(*this == h); }
+};
+
+/**
+ * Slot map giving out generational handles to elements.
+ *
+ * Each slot holds an element and a generation counter. Removing an element
+ * frees its slot and increases its generation, so the handles of the removed
+ * element do not resolve anymore, while the handles of the other elements
+ * are not affected. Freed slots are reused by new elements.
+ *
+ * The table can be used from any thread. To use an element found by get()
+ * on another thread than the one deleting it, hold lock() until done with
+ * it, elements are removed from the table before they are freed.
+ **/
+template <class T>
+class HandleTable
+{
+	public:
+		HandleTable()
+		{
+			elements = new vector<T *>;
+			generations = new vector<unsigned>;
+			freeSlots = new vector<unsigned>;
+
+			pthread_mutexattr_t attr;
+			pthread_mutexattr_init(&attr);
+			pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+			pthread_mutex_init(&mutex, &attr);
+			pthread_mutexattr_destroy(&attr);
+		}
+
+		~HandleTable()
+		{
+			pthread_mutex_destroy(&mutex);
+			delete elements;
+			delete generations;
+			delete freeSlots;
+		}
+
+		/**
+		 * Adds an element to the table.
+		 * \param e the element
+		 * \return the handle of the element
+		 **/
+		Handle add(T *e)
+		{
+			Handle h;
+			lock();
+			if (freeSlots->empty())
+			{
+				h.index = elements->size();
+				elements->push_back(e);
+				generations->push_back(0);
+			}
+			else
+			{
+				h.index = freeSlots->back();
+				freeSlots->pop_back();
+				(*elements)[h.index] = e;
+			}
+			h.generation = (*generations)[h.index];
+			unlock();
+			return h;
+		}
+
+		/**
+		 * Removes an element from the table, its handles become invalid.
+		 * \param h the handle of the element
+		 **/
+		void remove(Handle h)
+		{
+			lock();
+			if ((h.index < elements->size()) &&
+				((*generations)[h.index] == h.generation))
+			{
+				(*elements)[h.index] = NULL;
+				(*generations)[h.index]++;
+				freeSlots->push_back(h.index);
+			}
+			unlock();
+		}
+
+		/**
+		 * Returns the element of a handle.
+		 * \param h the handle
+		 * \return the element, or NULL if it has been removed
+		 **/
+		T *get(Handle h)
+		{
+			T *e = NULL;
+			lock();
+			if ((h.index < elements->size()) &&
+				((*generations)[h.index] == h.generation))
+				e = (*elements)[h.index];
+			unlock();
+			return e;
+		}
+
+		/// Returns the number of elements in the table.
+		inline unsigned size(void)
+			{ return elements->size() - freeSlots->size(); }
+
+		/// Locks the table, elements are not removed while it is held.
+		inline void lock(void) { pthread_mutex_lock(&mutex); }
+		/// Unlocks the table.
+		inline void unlock(void) { pthread_mutex_unlock(&mutex); }
+
+	private:
+		vector<T *> *elements;			///< element of each slot, NULL if free
+		vector<unsigned> *generations;	///< generation of each slot
+		vector<unsigned> *freeSlots;	///< slots to be reused
+
+		pthread_mutex_t mutex;			///< held while the table is used
+};
+
+} /* namespace Animata */
+
+#endif
+
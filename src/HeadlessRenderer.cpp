@@ -0,0 +1,422 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <algorithm>
+#include <png.h>
+
+#include "animata.h"
+#include "animataUI.h"
+#include "HeadlessRenderer.h"
+
+using namespace Animata;
+
+/**
+ * Creates a renderer, the options are set by parseArguments().
+ **/
+HeadlessRenderer::HeadlessRenderer()
+{
+	pattern = NULL;
+	sceneFile = NULL;
+	oscFile = NULL;
+	outputName = NULL;
+	frames = 1;
+	fps = 30;
+	width = HEADLESS_DEFAULT_WIDTH;
+	height = HEADLESS_DEFAULT_HEIGHT;
+	threads = 0;
+	argumentError = false;
+
+	camera = NULL;
+	viewTransform = NULL;
+	rasterizer = NULL;
+	frameOutput = NULL;
+
+	oscEvents = new vector<OSCEvent *>;
+	nextEvent = 0;
+	steps = 0;
+}
+
+HeadlessRenderer::~HeadlessRenderer()
+{
+	vector<OSCEvent *>::iterator e = oscEvents->begin();
+	for (; e < oscEvents->end(); e++)
+	{
+		delete [] (*e)->data;
+		delete *e;
+	}
+	delete oscEvents;
+
+	delete frameOutput;
+	delete rasterizer;
+	delete viewTransform;
+	delete camera;
+}
+
+void HeadlessRenderer::usage(void)
+{
+	fprintf(stderr, "usage: animata --render out_%%05d.png [--frames N] "
+			"[--fps F] [--size WxH] [--threads T] [--osc recording.txt] "
+			"[--shm name] scene.nmt\n"
+			"       animata [--shm name] [scene.nmt]\n");
+}
+
+/**
+ * Reads the rendering options from the command line. An unknown option, or
+ * an option missing its value, prints the usage and sets the argument error.
+ * \param argc number of arguments
+ * \param argv the arguments
+ * \return true if rendering into files is requested
+ **/
+bool HeadlessRenderer::parseArguments(int argc, char **argv)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = (i + 1 < argc);
+
+		if (!strcmp(argv[i], "--render") && hasValue)
+			pattern = argv[++i];
+		else if (!strcmp(argv[i], "--frames") && hasValue)
+			frames = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--fps") && hasValue)
+			fps = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--size") && hasValue)
+			sscanf(argv[++i], "%dx%d", &width, &height);
+		else if (!strcmp(argv[i], "--threads") && hasValue)
+			threads = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--osc") && hasValue)
+			oscFile = argv[++i];
+		else if (!strcmp(argv[i], "--shm") && hasValue)
+			outputName = argv[++i];
+#if defined(__APPLE__)
+		// process serial number added by the finder
+		else if (!strncmp(argv[i], "-psn_", 5))
+			continue;
+#endif
+		else if (argv[i][0] == '-')
+		{
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			usage();
+			argumentError = true;
+			return false;
+		}
+		else
+			sceneFile = argv[i];
+	}
+
+	return pattern != NULL;
+}
+
+/**
+ * Renders the image sequence.
+ * \return 0 on success, 1 on error
+ **/
+int HeadlessRenderer::run(void)
+{
+	if ((sceneFile == NULL) || (frames < 1) || (fps <= 0) ||
+		(width < 1) || (height < 1))
+	{
+		usage();
+		return 1;
+	}
+
+	// there is no OpenGL context
+	Texture::setOffline(true);
+
+	if (!ui->editorBox->loadScene(sceneFile))
+	{
+		fprintf(stderr, "error loading %s\n", sceneFile);
+		return 1;
+	}
+
+	if (oscFile && !loadOSCRecording(oscFile))
+	{
+		fprintf(stderr, "error loading %s\n", oscFile);
+		return 1;
+	}
+
+	camera = new Camera();
+	camera->calcSize(width, height);
+	camera->calcMatrices();
+	viewTransform = new ViewTransform(camera);
+	rasterizer = new SoftwareRasterizer(width, height, threads);
+	if (outputName)
+		frameOutput = new SharedFrameOutput(outputName, width, height);
+
+	for (int i = 0; i < frames; i++)
+	{
+		advance(i / fps);
+		renderFrame();
+
+		if (frameOutput)
+		{
+			unsigned char *pixels = frameOutput->beginFrame(width, height);
+			if (pixels)
+			{
+				memcpy(pixels, rasterizer->getPixels(), width * height * 4);
+				frameOutput->endFrame();
+			}
+		}
+
+		char filename[PATH_MAX];
+		snprintf(filename, PATH_MAX, pattern, i);
+		if (!writeImage(filename))
+		{
+			fprintf(stderr, "error writing %s\n", filename);
+			return 1;
+		}
+	}
+
+	printf("rendered %d frames of %dx%d at %.2f fps with %d threads\n",
+			frames, width, height, fps, rasterizer->getThreadCount());
+
+	return 0;
+}
+
+/// Orders the OSC messages by their time.
+static bool earlierEvent(OSCEvent *a, OSCEvent *b)
+{
+	return a->time < b->time;
+}
+
+/**
+ * Reads and encodes the messages of an OSC recording.
+ * \param filename the recording to read
+ * \return true if the recording could be read
+ **/
+bool HeadlessRenderer::loadOSCRecording(const char *filename)
+{
+	FILE *f = fopen(filename, "r");
+	if (f == NULL)
+		return false;
+
+	char line[1024];
+	char buffer[IP_MTU_SIZE];
+	int lineNumber = 0;
+
+	while (fgets(line, sizeof(line), f))
+	{
+		lineNumber++;
+
+		double time;
+		char address[256];
+		int n;
+		if ((line[0] == '#') ||
+			(sscanf(line, "%lf %255s%n", &time, address, &n) != 2))
+			continue;
+
+		try
+		{
+			osc::OutboundPacketStream p(buffer, IP_MTU_SIZE);
+			p << osc::BeginMessage(address);
+
+			char *arg = strtok(line + n, " \t\r\n");
+			for (; arg; arg = strtok(NULL, " \t\r\n"))
+			{
+				char *end;
+				long i = strtol(arg, &end, 10);
+				if (*end == 0)
+				{
+					p << (osc::int32)i;
+					continue;
+				}
+				float v = strtod(arg, &end);
+				if (*end == 0)
+					p << v;
+				else
+					p << (const char *)arg;
+			}
+
+			p << osc::EndMessage;
+
+			OSCEvent *e = new OSCEvent;
+			e->time = time;
+			e->size = p.Size();
+			e->data = new char[e->size];
+			memcpy(e->data, p.Data(), e->size);
+			oscEvents->push_back(e);
+		}
+		catch (osc::Exception& e)
+		{
+			fprintf(stderr, "%s:%d: %s\n", filename, lineNumber, e.what());
+		}
+	}
+
+	fclose(f);
+
+	// messages of the same time keep their order
+	stable_sort(oscEvents->begin(), oscEvents->end(), earlierEvent);
+	return true;
+}
+
+/**
+ * Advances the scene to the given time. The simulation steps and the OSC
+ * messages are applied in the order of their time.
+ * \param time time from the start in seconds
+ **/
+void HeadlessRenderer::advance(double time)
+{
+	AnimataSettings *settings = &ui->settings;
+	Layer *rootLayer = ui->editorBox->getRootLayer();
+	OSCListener *listener = ui->editorBox->getOSCListener();
+
+	while (true)
+	{
+		double stepTime = (double)steps / settings->fps;
+		bool hasEvent = nextEvent < oscEvents->size();
+
+		if (hasEvent && ((*oscEvents)[nextEvent]->time <= stepTime) &&
+			((*oscEvents)[nextEvent]->time <= time))
+		{
+			OSCEvent *e = (*oscEvents)[nextEvent++];
+			listener->ProcessPacket(e->data, e->size, IpEndpointName());
+			// there is no simulation thread, the message is applied at once
+			ui->editorBox->lock();
+			listener->applyCommands();
+			ui->editorBox->unlock();
+		}
+		else if (stepTime <= time)
+		{
+			/* run the spring model simulation on all bones of the skeleton */
+			if (settings->playSimulation == 1)
+				rootLayer->simulate(settings->iteration);
+			steps++;
+		}
+		else
+			break;
+	}
+}
+
+/**
+ * Draws the textured meshes of the visible layers like the output window.
+ **/
+void HeadlessRenderer::renderFrame(void)
+{
+	vector<Layer *> *layers = ui->editorBox->getAllLayers();
+
+	vector<Layer *>::iterator l = layers->begin();
+	for (; l < layers->end(); l++)
+		(*l)->calcTransformationMatrix();
+
+	viewTransform->update(layers);
+
+	rasterizer->begin();
+
+	if (!(ui->settings.display_elements & DISPLAY_OUTPUT_TEXTURE))
+	{
+		rasterizer->end();
+		return;
+	}
+
+	float camZ = camera->getTarget()->z - camera->getDistance();
+
+	for (l = layers->begin(); l < layers->end(); l++)
+	{
+		Layer *layer = *l;
+		Mesh *mesh = layer->getMesh();
+		Texture *texture = mesh->getAttachedTexture();
+
+		/* layers behind the camera are not drawn */
+		if (!layer->getVisibility() || (texture == NULL) ||
+			(layer->getTotalDepth() <= camZ))
+			continue;
+
+		float alpha = layer->getAccumulatedAlpha();
+
+		vector<Face *> *faces = mesh->getFaces();
+		for (unsigned i = 0; i < faces->size(); i++)
+		{
+			Face *face = (*faces)[i];
+			RasterVertex v[3];
+			for (int j = 0; j < 3; j++)
+			{
+				v[j].x = face->v[j]->view.x;
+				v[j].y = face->v[j]->view.y;
+				v[j].s = face->v[j]->texCoord.x;
+				v[j].t = face->v[j]->texCoord.y;
+			}
+			rasterizer->addTriangle(&v[0], &v[1], &v[2], texture, alpha);
+		}
+	}
+
+	// the tiles are rasterized in parallel
+	rasterizer->end();
+}
+
+/**
+ * Writes the rendered frame into a PNG file, or into a binary PPM file
+ * without alpha if the filename ends with .ppm.
+ * \param filename the file to write
+ * \return true on success
+ **/
+bool HeadlessRenderer::writeImage(const char *filename)
+{
+	FILE *f = fopen(filename, "wb");
+	if (f == NULL)
+		return false;
+
+	unsigned char *pixels = rasterizer->getPixels();
+	const char *ext = strrchr(filename, '.');
+
+	// the rows of the image are stored from the bottom
+	if (ext && !strcmp(ext, ".ppm"))
+	{
+		fprintf(f, "P6\n%d %d\n255\n", width, height);
+		for (int y = height - 1; y >= 0; y--)
+		{
+			unsigned char *p = pixels + y * width * 4;
+			for (int x = 0; x < width; x++, p += 4)
+				fwrite(p, 1, 3, f);
+		}
+		fclose(f);
+		return true;
+	}
+
+	png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING,
+			NULL, NULL, NULL);
+	png_infop info = png ? png_create_info_struct(png) : NULL;
+	if ((info == NULL) || setjmp(png_jmpbuf(png)))
+	{
+		png_destroy_write_struct(&png, &info);
+		fclose(f);
+		return false;
+	}
+
+	png_init_io(png, f);
+	png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGB_ALPHA,
+			PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT,
+			PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(png, info);
+	for (int y = height - 1; y >= 0; y--)
+		png_write_row(png, pixels + y * width * 4);
+	png_write_end(png, NULL);
+
+	png_destroy_write_struct(&png, &info);
+	fclose(f);
+	return true;
+}
+
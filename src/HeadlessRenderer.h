@@ -0,0 +1,122 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __HEADLESSRENDERER_H__
+#define __HEADLESSRENDERER_H__
+
+#include <vector>
+
+#include "Camera.h"
+#include "ViewTransform.h"
+#include "SoftwareRasterizer.h"
+#include "SharedFrameOutput.h"
+
+#define HEADLESS_DEFAULT_WIDTH 640
+#define HEADLESS_DEFAULT_HEIGHT 480
+
+using namespace std;
+
+namespace Animata
+{
+
+/// OSC message of a recording, sent to the scene at a given time.
+struct OSCEvent
+{
+	double time;	///< time of the message in seconds from the start
+	char *data;		///< the encoded OSC packet
+	int size;		///< size of the packet in bytes
+};
+
+/**
+ * Renders a scene into an image sequence without opening any window.
+ *
+ * The simulation is stepped with the fixed rate of the editor in simulated
+ * time, and the frames are sampled from it with the requested frame rate, so
+ * the result is the same on every run and on every machine. The textured
+ * meshes of the output are drawn by the SoftwareRasterizer on all
+ * processors, no OpenGL context is needed.
+ *
+ * A recording of OSC messages can be replayed during the rendering. It is a
+ * text file with one message per line, the time in seconds, the address and
+ * the arguments separated by whitespace, for example:
+ * \verbatim
+ 0.5 /joint hand 120 200.5
+ 1.0 /layeralpha background 0.5
+ \endverbatim
+ * Arguments are sent as integers, floats or strings according to their
+ * format. Lines starting with # are skipped.
+ *
+ * With the --shm option the frames are also published in a
+ * SharedFrameOutput. The option is read in the windowed mode too, where the
+ * playback window is published.
+ **/
+class HeadlessRenderer
+{
+	public:
+		HeadlessRenderer();
+		~HeadlessRenderer();
+
+		bool parseArguments(int argc, char **argv);
+		int run(void);
+
+		/// Returns true if the command line had an unknown option.
+		inline bool hasArgumentError(void) { return argumentError; }
+		/// Returns the scene given on the command line or NULL.
+		inline const char *getSceneFile(void) { return sceneFile; }
+		/// Returns the name of the shared frame output or NULL.
+		inline const char *getFrameOutputName(void) { return outputName; }
+
+	private:
+		bool loadOSCRecording(const char *filename);
+		void advance(double time);
+		void renderFrame(void);
+		bool writeImage(const char *filename);
+
+		static void usage(void);
+
+		const char *pattern;		///< printf pattern of the image filenames
+		const char *sceneFile;		///< the scene to render
+		const char *oscFile;		///< the OSC recording or NULL
+		const char *outputName;		///< name of the shared frame output or NULL
+		int frames;					///< number of frames to render
+		float fps;					///< frame rate of the image sequence
+		int width;					///< width of the images
+		int height;					///< height of the images
+		int threads;				///< number of rasterizer threads, 0 for all processors
+		bool argumentError;			///< true if an unknown option was given
+
+		Camera *camera;						///< camera looking at the scene
+		ViewTransform *viewTransform;		///< projects the layers with the camera
+		SoftwareRasterizer *rasterizer;		///< draws the frames
+		SharedFrameOutput *frameOutput;		///< publishes the frames or NULL
+
+		vector<OSCEvent *> *oscEvents;		///< the OSC recording in time order
+		unsigned nextEvent;					///< index of the next OSC message
+		unsigned steps;						///< simulation steps done
+};
+
+} /* namespace Animata */
+
+#endif
+
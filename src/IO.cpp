@@ -28,6 +28,7 @@
 #include "animata.h"
 #include "animataUI.h"
 #include "IO.h"
+#include "MeshOptimizer.h"
 
 using namespace Animata;
 
@@ -340,7 +341,7 @@ void IO::loadSkeleton(TiXmlNode *parent, Skeleton *skeleton, Mesh *m)
 		QUERY_ATTR(j, "fixed", fixed, 0);
 		name = j->Attribute("name"); // can be NULL
 		Joint *joint = skeleton->addJoint(x, y);
-		joint->selected = selected;
+		skeleton->selectJoint(joint, selected);
 		joint->osc = osc;
 		joint->fixed = fixed;
 		if (name)
@@ -401,7 +402,7 @@ void IO::loadSkeleton(TiXmlNode *parent, Skeleton *skeleton, Mesh *m)
 		bone->setLengthMultMax(lengthMultMax);
 		bone->setTempo(tempo);
 		bone->setTime(time);
-		bone->selected = selected;
+		skeleton->selectBone(bone, selected);
 		bone->setRadiusMult(radius);
 
 		// load attached vertices
@@ -501,7 +502,7 @@ void IO::loadMesh(TiXmlNode *parent, Mesh *mesh)
 		Vertex *vertex = mesh->addVertex(x, y);
 		vertex->texCoord.x = u;
 		vertex->texCoord.y = v;
-		vertex->selected = selected;
+		mesh->selectVertex(vertex, selected);
 	}
 
 	// skip the loading of faces if there was an error during vertex loading
@@ -634,6 +635,9 @@ Layer *IO::loadLayer(TiXmlNode *layerNode, Layer *layerParent /* = NULL */)
 	TiXmlNode *skeletonNode = layerNode->FirstChild("skeleton");
 	loadSkeleton(skeletonNode, layer->getSkeleton(), layer->getMesh());
 
+	// reorder faces and vertices for vertex cache reuse
+	MeshOptimizer::optimize(mesh);
+
 	// load sublayers
 	if (layerNode->FirstChild("layer"))
 	{
@@ -0,0 +1,367 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <stdio.h>
+#include <float.h>
+#include <math.h>
+
+#include "ImpostorCache.h"
+
+using namespace Animata;
+
+/**
+ * Creates an empty impostor cache.
+ * \param camera the camera the view coordinates are computed for
+ * \param view the stage computing the view coordinates of the meshes
+ **/
+ImpostorCache::ImpostorCache(Camera *camera, ViewTransform *view)
+{
+	this->camera = camera;
+	this->view = view;
+
+	impostors = new map<Mesh *, Impostor *>;
+
+	memoryUsage = 0;
+	frame = 0;
+
+	prevValidCount = 0;
+	prevMemoryUsage = 0;
+}
+
+ImpostorCache::~ImpostorCache()
+{
+	clear();
+	delete impostors;
+}
+
+/**
+ * Releases every impostor. Has to be called when the textures change
+ * without changing the revision of the meshes, like rebuilding the atlas.
+ **/
+void ImpostorCache::clear(void)
+{
+	map<Mesh *, Impostor *>::iterator i = impostors->begin();
+	for (; i != impostors->end(); i++)
+	{
+		release(i->second);
+		delete i->second;
+	}
+	impostors->clear();
+}
+
+/**
+ * Frees the texture of an impostor.
+ * \param impostor the impostor to release
+ **/
+void ImpostorCache::release(Impostor *impostor)
+{
+	if (impostor->texture)
+	{
+		glDeleteTextures(1, &impostor->texture);
+		memoryUsage -= impostor->textureWidth * impostor->textureHeight * 4;
+		impostor->texture = 0;
+	}
+	impostor->valid = false;
+}
+
+/**
+ * Releases the least recently drawn impostors until the given amount of
+ * texture memory is available.
+ * \param bytes the required texture memory
+ * \param keep impostor which must not be evicted
+ * \return true if enough memory is available
+ **/
+bool ImpostorCache::evict(int bytes, Impostor *keep)
+{
+	while (memoryUsage + bytes > IMPOSTOR_MAX_BYTES)
+	{
+		Impostor *lru = NULL;
+
+		map<Mesh *, Impostor *>::iterator i = impostors->begin();
+		for (; i != impostors->end(); i++)
+		{
+			Impostor *impostor = i->second;
+			if ((impostor == keep) || (impostor->texture == 0))
+				continue;
+			if ((lru == NULL) || (impostor->lastUsed < lru->lastUsed))
+				lru = impostor;
+		}
+
+		if (lru == NULL)
+			return false;
+
+		release(lru);
+		// wait for a full static period before capturing it again
+		lru->staticFrames = 0;
+	}
+
+	return true;
+}
+
+/**
+ * Updates the impostors of the visible layers. The view coordinates of the
+ * layers have to be computed by the ViewTransform before calling this.
+ * Meshes unchanged for IMPOSTOR_STATIC_FRAMES frames are captured, so this
+ * has to be called before the scene is drawn, as the capture uses the back
+ * buffer.
+ * \param layers all layers of the scene
+ **/
+void ImpostorCache::update(vector<Layer *> *layers)
+{
+	frame++;
+
+	float camZ = camera->getTarget()->z - camera->getDistance();
+
+	vector<Layer *>::iterator l = layers->begin();
+	for (; l < layers->end(); l++)
+	{
+		Layer *layer = *l;
+		Mesh *mesh = layer->getMesh();
+
+		/* the same layers are visible as in the view transform */
+		if (!layer->getVisibility() || (layer->getTotalDepth() <= camZ))
+			continue;
+
+		if ((mesh->getAttachedTexture() == NULL) ||
+			(mesh->getFaces()->size() < IMPOSTOR_MIN_FACES))
+			continue;
+
+		Impostor *impostor;
+		map<Mesh *, Impostor *>::iterator i = impostors->find(mesh);
+		if (i == impostors->end())
+		{
+			impostor = new Impostor;
+			impostor->texture = 0;
+			impostor->textureWidth = impostor->textureHeight = 0;
+			impostor->revision = mesh->getRevision();
+			impostor->staticFrames = 0;
+			impostor->valid = false;
+			impostor->lastUsed = frame;
+			(*impostors)[mesh] = impostor;
+		}
+		else
+		{
+			impostor = i->second;
+		}
+
+		impostor->lastSeen = frame;
+
+		if (impostor->revision != mesh->getRevision())
+		{
+			impostor->revision = mesh->getRevision();
+			impostor->staticFrames = 0;
+			impostor->valid = false;
+			continue;
+		}
+
+		impostor->staticFrames++;
+		if (!impostor->valid && (impostor->staticFrames >= IMPOSTOR_STATIC_FRAMES))
+		{
+			impostor->valid = capture(mesh, impostor);
+			if (!impostor->valid)
+				impostor->staticFrames = 0;
+		}
+	}
+
+	// forget the meshes which are not visible anymore or have been deleted
+	int validCount = 0;
+	map<Mesh *, Impostor *>::iterator i = impostors->begin();
+	while (i != impostors->end())
+	{
+		if (i->second->lastSeen != frame)
+		{
+			release(i->second);
+			delete i->second;
+			impostors->erase(i++);
+		}
+		else
+		{
+			if (i->second->valid)
+				validCount++;
+			i++;
+		}
+	}
+
+#ifdef DEBUG
+	if ((validCount != prevValidCount) || (memoryUsage != prevMemoryUsage))
+	{
+		printf("impostors: %d layers cached in %d kB\n", validCount,
+				memoryUsage / 1024);
+		prevValidCount = validCount;
+		prevMemoryUsage = memoryUsage;
+	}
+#endif
+}
+
+/**
+ * Renders the textured triangles of a mesh into the texture of its impostor.
+ * The mesh is drawn into the back buffer without blending over a cleared
+ * rectangle, which is copied into the texture and cleared again.
+ * \param mesh the mesh with an attached texture and up to date view
+ *	coordinates
+ * \param impostor the impostor of the mesh
+ * \return true if the image has been captured, false if the mesh is not
+ *	completely inside the viewport or too large
+ **/
+bool ImpostorCache::capture(Mesh *mesh, Impostor *impostor)
+{
+	vector<Vertex *> *vertices = mesh->getVertices();
+	vector<Face *> *faces = mesh->getFaces();
+	Texture *texture = mesh->getAttachedTexture();
+
+	float minX = FLT_MAX;
+	float minY = FLT_MAX;
+	float maxX = -FLT_MAX;
+	float maxY = -FLT_MAX;
+
+	for (unsigned i = 0; i < vertices->size(); i++)
+	{
+		Vector2D *v = &(*vertices)[i]->view;
+		if (v->x < minX)
+			minX = v->x;
+		if (v->y < minY)
+			minY = v->y;
+		if (v->x > maxX)
+			maxX = v->x;
+		if (v->y > maxY)
+			maxY = v->y;
+	}
+
+	// only the part inside the viewport can be read back, a mesh reaching
+	// out of it would be cut off, so it is not cached
+	const int *viewport = view->getViewport();
+	int x0 = (int)floorf(minX);
+	int y0 = (int)floorf(minY);
+	int x1 = (int)ceilf(maxX);
+	int y1 = (int)ceilf(maxY);
+	if ((x0 < viewport[0]) || (y0 < viewport[1]) ||
+		(x1 > viewport[0] + viewport[2]) || (y1 > viewport[1] + viewport[3]))
+		return false;
+
+	int w = x1 - x0;
+	int h = y1 - y0;
+	if ((w <= 0) || (h <= 0) || (w > IMPOSTOR_MAX_SIZE) ||
+		(h > IMPOSTOR_MAX_SIZE))
+		return false;
+
+	int tw = 1;
+	while (tw < w)
+		tw <<= 1;
+	int th = 1;
+	while (th < h)
+		th <<= 1;
+
+	if ((impostor->textureWidth != tw) || (impostor->textureHeight != th))
+		release(impostor);
+
+	if (impostor->texture == 0)
+	{
+		if (!evict(tw * th * 4, impostor))
+			return false;
+
+		glGenTextures(1, &impostor->texture);
+		glBindTexture(GL_TEXTURE_2D, impostor->texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tw, th, 0, GL_RGBA,
+				GL_UNSIGNED_BYTE, NULL);
+
+		impostor->textureWidth = tw;
+		impostor->textureHeight = th;
+		memoryUsage += tw * th * 4;
+	}
+
+	view->setupOrtho();
+
+	glPushAttrib(GL_SCISSOR_BIT | GL_ENABLE_BIT);
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(x0, y0, w, h);
+
+	// the texels are written as they are, the alpha of the texture is kept
+	// in the destination alpha
+	glPushAttrib(GL_COLOR_BUFFER_BIT);
+	glDisable(GL_BLEND);
+	glClearColor(0, 0, 0, 0);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	glEnable(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, texture->getGlResource());
+	glColor4f(1.f, 1.f, 1.f, 1.f);
+	glBegin(GL_TRIANGLES);
+	for (unsigned i = 0; i < faces->size(); i++)
+	{
+		Face *face = (*faces)[i];
+		for (int j = 0; j < 3; j++)
+		{
+			glTexCoord2f(texture->mapS(face->v[j]->texCoord.x),
+					texture->mapT(face->v[j]->texCoord.y));
+			glVertex2f(face->v[j]->view.x, face->v[j]->view.y);
+		}
+	}
+	glEnd();
+	glDisable(GL_TEXTURE_2D);
+
+	glBindTexture(GL_TEXTURE_2D, impostor->texture);
+	glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, x0, y0, w, h);
+
+	// restore the background below the captured rectangle
+	glPopAttrib();
+	glClear(GL_COLOR_BUFFER_BIT);
+	glPopAttrib();
+
+	glMatrixMode(GL_MODELVIEW);
+	glPopMatrix();
+
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+
+	glMatrixMode(GL_MODELVIEW);
+
+	impostor->minX = x0;
+	impostor->minY = y0;
+	impostor->maxX = x1;
+	impostor->maxY = y1;
+	impostor->s = (float)w / tw;
+	impostor->t = (float)h / th;
+
+	return true;
+}
+
+/**
+ * Returns the up to date impostor of a mesh and marks it as used.
+ * \param mesh the mesh to draw
+ * \return the impostor or NULL if the mesh has to be drawn by its triangles
+ **/
+Impostor *ImpostorCache::use(Mesh *mesh)
+{
+	map<Mesh *, Impostor *>::iterator i = impostors->find(mesh);
+	if ((i == impostors->end()) || !i->second->valid)
+		return NULL;
+
+	i->second->lastUsed = frame;
+	return i->second;
+}
+
@@ -0,0 +1,120 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __IMPOSTORCACHE_H__
+#define __IMPOSTORCACHE_H__
+
+#if defined(__APPLE__)
+	#include <OPENGL/gl.h>
+#else
+	#include <GL/gl.h>
+#endif
+
+#include <vector>
+#include <map>
+
+#include "Camera.h"
+#include "Layer.h"
+#include "Mesh.h"
+#include "ViewTransform.h"
+
+/// number of frames a mesh has to be unchanged before it gets cached
+#define IMPOSTOR_STATIC_FRAMES 30
+/// meshes with less faces are cheaper to draw than to cache
+#define IMPOSTOR_MIN_FACES 64
+/// maximum size of the impostor textures in bytes
+#define IMPOSTOR_MAX_BYTES (64 * 1024 * 1024)
+/// maximum width and height of an impostor texture
+#define IMPOSTOR_MAX_SIZE 2048
+
+using namespace std;
+
+namespace Animata
+{
+
+/// Cached image of a mesh in view coordinates.
+struct Impostor
+{
+	GLuint texture;					///< GL texture holding the image, 0 if not allocated
+	int textureWidth;				///< power of two width of the texture
+	int textureHeight;				///< power of two height of the texture
+
+	float minX, minY, maxX, maxY;	///< view rectangle covered by the image
+	float s, t;						///< texture coordinates of the top right corner of the image
+
+	unsigned revision;				///< mesh revision the image belongs to
+	int staticFrames;				///< number of frames the mesh has not changed
+	bool valid;						///< set if the image is up to date
+
+	unsigned lastUsed;				///< frame the impostor was last drawn in
+	unsigned lastSeen;				///< frame the mesh was last visible in
+};
+
+/**
+ * Caches the textured image of meshes which have not changed for
+ * IMPOSTOR_STATIC_FRAMES frames, so they can be drawn as a single quad.
+ *
+ * The image is rendered in the view coordinates of the editor camera, so
+ * any change of the view coordinates, like joint motion or camera movement,
+ * increases the revision of the mesh and invalidates its impostor. The mesh
+ * is captured with full opacity, the layer alpha is applied when the quad
+ * is drawn. When the textures exceed IMPOSTOR_MAX_BYTES, the least recently
+ * drawn impostors are evicted. Meshes reaching out of the viewport are not
+ * cached. The impostors have the resolution of the editor, so only the
+ * editor draws them, the playback window draws the triangles.
+ **/
+class ImpostorCache
+{
+	public:
+		ImpostorCache(Camera *camera, ViewTransform *view);
+		~ImpostorCache();
+
+		void update(vector<Layer *> *layers);
+		Impostor *use(Mesh *mesh);
+		void clear(void);
+
+		/// Returns the memory used by the impostor textures in bytes.
+		inline int getMemoryUsage(void) { return memoryUsage; }
+
+	private:
+		Camera *camera;							///< camera the view coordinates are computed for
+		ViewTransform *view;					///< stage computing the view coordinates
+
+		map<Mesh *, Impostor *> *impostors;		///< impostors of the visible meshes
+
+		int memoryUsage;						///< bytes used by the textures
+		unsigned frame;							///< number of updates
+
+		int prevValidCount;						///< reported impostor count
+		int prevMemoryUsage;					///< reported memory usage
+
+		bool capture(Mesh *mesh, Impostor *impostor);
+		bool evict(int bytes, Impostor *keep);
+		void release(Impostor *impostor);
+};
+
+} /* namespace Animata */
+
+#endif
+
@@ -31,6 +31,8 @@
 
 using namespace Animata;
 
+HandleTable<Joint> *Joint::handles = new HandleTable<Joint>;
+
 /**
  * Creates a joint at the (x, y) coordinate.
  **/
@@ -41,10 +43,23 @@ Joint::Joint(float x, float y)
 	fixed = false;
 	dragged = false;
 	selected = false;
+	selectionIndex = 0;
+	index = 0;
+	inNameIndex = false;
 	dragTS = -1;
 	osc = false;
 
 	setName("");
+
+	handle = handles->add(this);
+}
+
+/**
+ * Invalidates the handle of the joint.
+ **/
+Joint::~Joint()
+{
+	handles->remove(handle);
 }
 
 /**
@@ -63,8 +78,18 @@ const char *Joint::getName(void)
  **/
 void Joint::setName(const char *str)
 {
+	// the name index is keyed by the name, the joint is added again if it
+	// was in the index, also when it was unnamed
+	NameIndex<Joint> *index = ui ? ui->editorBox->getJointNames() : NULL;
+	bool indexed = index && index->remove(this);
+
 	strncpy(name, str, 15);
 	name[15] = 0;
+
+	if (indexed)
+		index->add(this);
+	if (ui)
+		ui->editorBox->namesChanged();
 }
 
 /**
@@ -89,14 +114,6 @@ void Joint::draw(int mouseOver, int active)
 	Primitives::drawJoint(this, mouseOver, active);
 }
 
-/**
- * Inverts the joint's state of selection.
- **/
-void Joint::flipSelection(void)
-{
-	selected = !selected;
-}
-
 /**
  * Moves joint by the given vector.
  * \param dx x distance
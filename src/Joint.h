@@ -24,9 +24,17 @@
 #ifndef __JOINT_H__
 #define __JOINT_H__
 
+#include <vector>
+
+#include "Handle.h"
+
+using namespace std;
+
 namespace Animata
 {
 
+class Bone;
+
 /// Endpoints of Bone.
 class Joint
 {
@@ -37,9 +45,17 @@ class Joint
 		float vy; ///< y view coordinate
 
 		bool fixed; ///< fixed state
-		bool selected; ///< selection state
+		bool selected; ///< selection state, changed through Skeleton::selectJoint()
+		unsigned selectionIndex; ///< position in the selection set of the skeleton while selected
 		bool dragged; ///< set to true if the joint is dragged
 
+		unsigned index; ///< position in the joints of the skeleton
+		vector<Bone *> bones; ///< bones connected to the joint, maintained by the Skeleton
+		Handle handle; ///< stable identity of the joint
+		bool inNameIndex; ///< true while in the name index of the editor, changed by NameIndex
+
+		static HandleTable<Joint> *handles; ///< handles of all existing joints
+
 		bool osc; ///< joint parameters are transmitted via osc if true
 
 		/** timestamp of last drag, needed when joints are moved as part of a
@@ -48,13 +64,13 @@ class Joint
 		int dragTS;
 
 		Joint(float x, float y);
+		~Joint();
 
 		const char *getName(void);
 		void setName(const char *str);
 
 		void simulate(void);
 		void draw(int dragged = 0, int active = 1);
-		void flipSelection(void);
 
 		void drag(float dx, float dy, int timeStamp = 0);
 
@@ -29,6 +29,7 @@
 #include "animata.h"
 #include "animataUI.h"
 #include "Transform.h"
+#include "PickIndex.h"
 
 #define MIN_SCALE 0.1f
 
@@ -47,6 +48,7 @@ Layer::Layer(Layer *p)
 
 	mesh = new Mesh();
 	skeleton = new Skeleton();
+	pickIndex = new PickIndex();
 
 	sprintf(name, "layer_%04d", Layer::layerCount);
 	Layer::layerCount++;
@@ -56,6 +58,7 @@ Layer::Layer(Layer *p)
 	scale = 1.0;
 
 	visible = true;
+	inNameIndex = false;
 
 	calcTransformationMatrix();
 
@@ -69,18 +72,23 @@ Layer::Layer(Layer *p)
  **/
 Layer::~Layer()
 {
-	/* remove from all layers */
+	/* remove from all layers, the scene stays locked until the layer is
+	 * freed, so the simulation does not step a half deleted layer */
 	if (ui)
 	{
 		ui->editorBox->lock();
 		ui->editorBox->deleteFromAllLayers(this);
-		ui->editorBox->unlock();
 	}
 
-	delete mesh;
+	// the bones disattach the vertices of the mesh when they are deleted
 	delete skeleton;
+	delete mesh;
+	delete pickIndex;
 
 	eraseLayers();
+
+	if (ui)
+		ui->editorBox->unlock();
 }
 
 /**
@@ -129,8 +137,18 @@ const char *Layer::getName(void)
  **/
 void Layer::setName(const char *str)
 {
+	// the name index is keyed by the name, the layer is added again if it
+	// was in the index, also when it was unnamed
+	NameIndex<Layer> *index = ui ? ui->editorBox->getLayerNames() : NULL;
+	bool indexed = index && index->remove(this);
+
 	strncpy(name, str, 15);
 	name[15] = 0;
+
+	if (indexed)
+		index->add(this);
+	if (ui)
+		ui->editorBox->namesChanged();
 }
 
 /**
@@ -180,14 +198,6 @@ void Layer::drawWithoutRecursion(int mode)
 	if (!visible)
 		return;
 
-	// get the boundaries of actual viewport
-	GLint viewport[4];
-	glGetIntegerv(GL_VIEWPORT, viewport);
-
-	glMatrixMode(GL_MODELVIEW);
-	glPushMatrix();
-	glMultMatrixf(transformation.f);
-
 	Camera *cam = ui->editorBox->getCamera();
 	float camZ = cam->getTarget()->z - cam->getDistance();
 
@@ -212,35 +222,24 @@ void Layer::drawWithoutRecursion(int mode)
 	{
 		mesh->setTextureAlpha(getAccumulatedAlpha());
 
-		if (mode & RENDER_FEEDBACK)
-		{
-			// set the transformation matrices for setVertexViewCoords() and setJointViewCoords() in doFeedback
-			Transform::setMatrices();
+		// the view coordinates are computed by the view transform stage
+		ui->editorBox->getViewTransform()->setupOrtho();
 
-			selector->doFeedback(this);
-		}
+		mesh->draw(mode, this == ui->editorBox->getCurrentLayer());
+		skeleton->draw(mode, this == ui->editorBox->getCurrentLayer());
 
-		glMatrixMode(GL_PROJECTION);
-		glPushMatrix();
-		glLoadIdentity();
-		glOrtho(viewport[0], viewport[2] + viewport[0], viewport[1], viewport[3] + viewport[1], 0, 1);
-
-		glMatrixMode(GL_MODELVIEW);
-		glPushMatrix();
-		glLoadIdentity();
-
-		mesh->draw(mode & ~RENDER_FEEDBACK, this == ui->editorBox->getCurrentLayer());
-		skeleton->draw(mode & ~RENDER_FEEDBACK, this == ui->editorBox->getCurrentLayer());
+		// the glyphs of the layer are drawn with its ortho projection
+		if (GlyphBatch::getCurrent())
+			GlyphBatch::getCurrent()->flush();
 
 		glMatrixMode(GL_MODELVIEW);
 		glPopMatrix();
 
 		glMatrixMode(GL_PROJECTION);
 		glPopMatrix();
-	}
 
-	glMatrixMode(GL_MODELVIEW);
-	glPopMatrix();
+		glMatrixMode(GL_MODELVIEW);
+	}
 }
 
 /**
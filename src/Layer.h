@@ -33,6 +33,8 @@ using namespace std;
 namespace Animata
 {
 
+class PickIndex;
+
 /**
  * Layer holding Skeleton and Mesh data
  **/
@@ -44,6 +46,7 @@ class Layer
 
 		Mesh		*mesh;				///< the mesh belonging to this layer
 		Skeleton	*skeleton;			///< the skeleton belonging to this layer
+		PickIndex	*pickIndex;			///< finds the primitives below the cursor
 
 		char name[16];					///< name of layer
 		float x, y, z;					///< position of the layer
@@ -59,6 +62,7 @@ class Layer
 		Matrix transformation;
 
 	public:
+		bool inNameIndex;	///< true while in the name index of the editor, changed by NameIndex
 
 		Layer(Layer *p = NULL);
 		~Layer();
@@ -107,6 +111,8 @@ class Layer
 		inline Mesh *getMesh() { return mesh; }
 		/// Returns skeleton.
 		inline Skeleton *getSkeleton() { return skeleton; }
+		/// Returns the spatial index of the primitives in view coordinates.
+		inline PickIndex *getPickIndex() { return pickIndex; }
 
 		/// Returns parent of layer.
 		inline Layer *getParent() { return parent; }
@@ -31,6 +31,7 @@
 #include "Mesh.h"
 #include "Subdiv.h"
 #include "Transform.h"
+#include "RenderQueue.h"
 
 #if defined(__APPLE__)
 	#include <OPENGL/gl.h>
@@ -40,6 +41,8 @@
 
 using namespace Animata;
 
+unsigned Mesh::lastRevision = 0;
+
 /**
  * Creates a new default mesh without an attached texture.
  */
@@ -47,12 +50,15 @@ Mesh::Mesh()
 {
 	vertices = new vector<Vertex*>;
 	faces = new vector<Face*>;
+	selection = new SelectionSet<Vertex>;
 
 	attachedTexture = NULL;
 	pVertex = NULL;
 	pFace = NULL;
 
 	textureAlpha = 1.0f;
+
+	changed();
 }
 
 /**
@@ -74,6 +80,8 @@ Mesh::~Mesh()
 		clearFaces();
 		delete faces;
 	}
+
+	delete selection;
 }
 
 /**
@@ -86,6 +94,7 @@ Vertex *Mesh::addVertex(float x, float y)
 {
 	Vector2D vector(x, y);
 	Vertex *v = new Vertex(vector);
+	v->index = vertices->size();
 	vertices->push_back(v);
 	return v;
 }
@@ -103,10 +112,11 @@ void Mesh::addFace(Vertex *v0, Vertex *v1, Vertex *v2)
 	// check if there are same vertices
 	if (v0 == v1 || v1 == v2 || v2 == v0)
 		return;
-	// check if a previous face exists between these vertices
-	for (unsigned i = 0; i < faces->size(); i++)
+	// check if a previous face exists between these vertices, it would be
+	// one of the faces of the first vertex
+	for (unsigned i = 0; i < v0->faces.size(); i++)
 	{
-		Face *face = (*faces)[i];
+		Face *face = v0->faces[i];
 		if (((face->v[0] == v0) && (face->v[1] == v1) && (face->v[2] == v2)) ||
 			((face->v[0] == v0) && (face->v[1] == v2) && (face->v[2] == v1)) ||
 			((face->v[0] == v1) && (face->v[1] == v2) && (face->v[2] == v0)) ||
@@ -118,17 +128,50 @@ void Mesh::addFace(Vertex *v0, Vertex *v1, Vertex *v2)
 		}
 	}
 
-	faces->push_back(new Face(v0, v1, v2));
+	Face *face = new Face(v0, v1, v2);
+	face->index = faces->size();
+	faces->push_back(face);
+	v0->faces.push_back(face);
+	v1->faces.push_back(face);
+	v2->faces.push_back(face);
+	changed();
 
 	/* if there's a texture attached add texture coordinates also */
 	if (attachedTexture)
 	{
-		Face *face = faces->back();
-
 		face->attachTexture(attachedTexture);
 	}
 }
 
+/**
+ * Removes a face from the mesh and deletes it. The last face is moved to its
+ * place, so only the faces of its vertices are searched.
+ * \param face The face to remove.
+ */
+void Mesh::removeFace(Face *face)
+{
+	for (int j = 0; j < 3; j++)
+	{
+		vector<Face *> *vertexFaces = &face->v[j]->faces;
+		for (unsigned i = 0; i < vertexFaces->size(); i++)
+		{
+			if ((*vertexFaces)[i] == face)
+			{
+				(*vertexFaces)[i] = vertexFaces->back();
+				vertexFaces->pop_back();
+				break;
+			}
+		}
+	}
+
+	Face *last = faces->back();
+	(*faces)[face->index] = last;
+	last->index = face->index;
+	faces->pop_back();
+
+	delete face;
+}
+
 /**
  * Deletes every face belonging to the mesh.
  */
@@ -138,27 +181,29 @@ void Mesh::clearFaces(void)
 	for (; f < faces->end(); f++)
 		delete *f;				// free faces from memory
 	faces->clear();				// clear all vector elements
+
+	for (unsigned i = 0; i < vertices->size(); i++)
+		(*vertices)[i]->faces.clear();
+	changed();
 }
 
 /**
- * Returns the number of selected vertices.
- * \retval int The number of selected vertices.
+ * Updates the positions stored in the vertices and faces after they have
+ * been reordered.
+ * \sa MeshOptimizer::optimize()
  */
-int Mesh::getSelectedVerticesCount(void)
+void Mesh::renumber(void)
 {
-	int s = 0;
 	for (unsigned i = 0; i < vertices->size(); i++)
-	{
-		if ((*vertices)[i]->selected)
-			s++;
-	}
-	return s;
+		(*vertices)[i]->index = i;
+	for (unsigned i = 0; i < faces->size(); i++)
+		(*faces)[i]->index = i;
 }
 
 /**
- * Turns selected to true on the i.th vertex.
- * \param	i		The number of the vertex to select.
- * \param	type	Should be Selection::SELECT_VERTEX.
+ * Turns selected to true on the i.th vertex, or on the vertices of the i.th face.
+ * \param	i		The number of the vertex or face to select.
+ * \param	type	Selection::SELECT_VERTEX or Selection::SELECT_TRIANGLE.
  */
 void Mesh::select(unsigned i, int type)
 {
@@ -167,32 +212,14 @@ void Mesh::select(unsigned i, int type)
 		case Selection::SELECT_VERTEX:
 			if(i < vertices->size())
 			{
-				(*vertices)[i]->selected = true;
+				selection->add((*vertices)[i]);
 			}
 			break;
-	}
-}
-
-/**
- * Turns selected to true on the i.th vertex if its in the given circle.
- * \param	i		The number of the vertex to select.
- * \param	type	Should be Selection::SELECT_VERTEX.
- * \param	xc		\e x coordinate of the circle's center.
- * \param	yc		\e y coordinate of the circle's center.
- * \param	r		Radius of the circle.
- */
-void Mesh::circleSelect(unsigned i, int type, int xc, int yc, float r)
-{
-	switch (type)
-	{
-		case Selection::SELECT_VERTEX:
-			if (i < vertices->size())
+		case Selection::SELECT_TRIANGLE:
+			if(i < faces->size())
 			{
-				Vertex *v = (*vertices)[i];
-				float dx = v->view.x - xc;
-				float dy = v->view.y - yc;
-				if (dx*dx + dy*dy <= r*r)
-					v->selected = true;
+				for(int j = 0; j < 3; j++)
+					selection->add((*faces)[i]->v[j]);
 			}
 			break;
 	}
@@ -200,41 +227,25 @@ void Mesh::circleSelect(unsigned i, int type, int xc, int yc, float r)
 
 void Mesh::triangulateSelected(void)
 {
-	int selectedCount = getSelectedVerticesCount();
+	vector<Vertex *> *selectedVertices = selection->getList();
+	int selectedCount = selectedVertices->size();
 
 	/* create an array of the selected points */
 	Vector2D *points = new Vector2D[selectedCount + 3];
-	selectedPointIndices = new int[selectedCount + 3];
 
-	int pCount = vertices->size();
-	int j = 0;
-	for (int i = 0; i < pCount; i++)
+	for (int i = 0; i < selectedCount; i++)
 	{
-		Vertex *v = (*vertices)[i];
-
-		if (v->selected)
-		{
-			points[j].x = v->coord.x;
-			points[j].y = v->coord.y;
-			selectedPointIndices[j] = i; /* store the original point index */
-			j++;
-		}
+		Vertex *v = (*selectedVertices)[i];
+		points[i].x = v->coord.x;
+		points[i].y = v->coord.y;
 	}
 
 	/* delete faces of selected vertices */
 	for (int s = 0; s < selectedCount; s++)
 	{
-		Vertex *v = (*vertices)[selectedPointIndices[s]];
-		for (int i = faces->size() - 1; i >= 0; i--)
-		{
-			Face *face = (*faces)[i];
-			if ((face->v[0] == v) || (face->v[1] == v) || (face->v[2] == v))
-			{
-				vector<Face *>::iterator faceIter = faces->begin() + i;
-				delete face;
-				faces->erase(faceIter);
-			}
-		}
+		Vertex *v = (*selectedVertices)[s];
+		while (!v->faces.empty())
+			removeFace(v->faces.back());
 	}
 
 	/* store number of old faces to sort only new ones */
@@ -252,7 +263,6 @@ void Mesh::triangulateSelected(void)
 
 	delete s;
 	delete [] points;
-	delete [] selectedPointIndices;
 
 	/* sort the new faces only */
 	sortFaces(faces->begin() + oldFaceCount, faces->end());
@@ -357,13 +367,11 @@ void Mesh::triangulateFaceProc(int p0, int p1, int p2)
  **/
 void Mesh::triangulateFaceProcSelected(int p0, int p1, int p2)
 {
-	/* translate selected point indices to original point indices */
-	int i0 = selectedPointIndices[p0];
-	int i1 = selectedPointIndices[p1];
-	int i2 = selectedPointIndices[p2];
-	Vertex *v0 = (*vertices)[i0];
-	Vertex *v1 = (*vertices)[i1];
-	Vertex *v2 = (*vertices)[i2];
+	/* the points were given in the order of the selected vertices */
+	vector<Vertex *> *selectedVertices = selection->getList();
+	Vertex *v0 = (*selectedVertices)[p0];
+	Vertex *v1 = (*selectedVertices)[p1];
+	Vertex *v2 = (*selectedVertices)[p2];
 
 	if (attachedTexture)
 	{
@@ -405,7 +413,7 @@ static bool triangleSortPredicate(Face *a, Face *b)
 
 	if (ac.y < bc.y)
 		return true;
-	else if ((ac.y == bc.y) && (ac.x < ac.x))
+	else if ((ac.y == bc.y) && (ac.x < bc.x))
 		return true;
 	else
 		return false;
@@ -414,11 +422,13 @@ static bool triangleSortPredicate(Face *a, Face *b)
 void Mesh::sortFaces(void)
 {
 	sort(faces->begin(), faces->end(), triangleSortPredicate);
+	renumber();
 }
 
 void Mesh::sortFaces(vector<Face *>::iterator begin, vector<Face *>::iterator end)
 {
 	sort(begin, end, triangleSortPredicate);
+	renumber();
 }
 
 /**
@@ -428,7 +438,7 @@ void Mesh::sortFaces(vector<Face *>::iterator begin, vector<Face *>::iterator en
  */
 vector<Vertex *>::iterator Mesh::getSelectedVertex(Vertex **ppv /* = NULL */)
 {
-	unsigned char hit = selector->getHitCount();
+	unsigned hit = selector->getHitCount();
 	SelectItem *selected = selector->getSelected();
 
 	Vertex *selVertex = NULL;
@@ -454,34 +464,29 @@ vector<Vertex *>::iterator Mesh::getSelectedVertex(Vertex **ppv /* = NULL */)
  */
 void Mesh::deleteSelectedVertex(void)
 {
-	vector<Vertex *>::iterator iter;
 	Vertex *selVertex = NULL;
 
-	iter = getSelectedVertex(&selVertex);
+	getSelectedVertex(&selVertex);
 
 	if (selVertex == NULL) /* no vertex below the cursor */
 		return;
 
-	// checking vector elements backwards to be able to iterate and erase at
-	// the same time
-	for (int i = faces->size() - 1; i >= 0; i--)
-	{
-		Face *face = (*faces)[i];
-
-		if ((face->v[0] == selVertex) ||
-			(face->v[1] == selVertex) ||
-			(face->v[2] == selVertex))
-		{
-			vector<Face *>::iterator faceIter = faces->begin() + i;
-			delete face;
-			faces->erase(faceIter);
-		}
-	}
+	// the faces of the vertex are deleted with it
+	while (!selVertex->faces.empty())
+		removeFace(selVertex->faces.back());
 
 	//if (hit && selected->type == Selection::SELECT_VERTEX)
 	{
-		delete *iter;			// delete object
-		vertices->erase(iter);	// remove it from the vector
+		selection->remove(selVertex);
+
+		// move the last vertex to the place of the deleted one
+		Vertex *last = vertices->back();
+		(*vertices)[selVertex->index] = last;
+		last->index = selVertex->index;
+		vertices->pop_back();
+
+		delete selVertex;		// delete object
+		changed();
 
 		// current selection points to the next joint after the deleted one
 		selector->clearSelection();
@@ -494,18 +499,11 @@ void Mesh::deleteSelectedVertex(void)
  */
 void Mesh::deleteSelectedFace(Face *f)
 {
-	/* delete the face */
-	vector<Face *>::iterator iter = faces->begin();
-	for (unsigned i = 0; i < faces->size(); i++)
+	/* delete the face if it belongs to the mesh */
+	if ((f->index < faces->size()) && ((*faces)[f->index] == f))
 	{
-		Face *face = (*faces)[i];
-		if (face == f)
-		{
-			vector<Face *>::iterator faceIter = faces->begin() + i;
-			delete face;
-			faces->erase(faceIter);
-			break;
-		}
+		removeFace(f);
+		changed();
 	}
 	/* clear selection, because it contains a non-existing object */
 	selector->clearSelection();
@@ -524,6 +522,7 @@ void Mesh::attachTexture(Texture *t)
 	{
 		(*faces)[i]->attachTexture(attachedTexture);
 	}
+	changed();
 }
 
 /**
@@ -535,75 +534,44 @@ void Mesh::attachTexture(Texture *t)
  */
 int Mesh::moveSelectedVertices(float dx, float dy)
 {
-	int movedVertices = 0;
+	vector<Vertex *> *selectedVertices = selection->getList();
 
-	for (unsigned i = 0; i < vertices->size(); i++)
+	for (unsigned i = 0; i < selectedVertices->size(); i++)
 	{
-		Vertex *v = (*vertices)[i];
-
-		if (v->selected)
-		{
-			v->coord.x += dx;
-			v->coord.y += dy;
-			movedVertices++;
-		}
+		Vertex *v = (*selectedVertices)[i];
+		v->coord.x += dx;
+		v->coord.y += dy;
 	}
 
 	/* return the number of vertices moved */
-	return movedVertices;
+	return selectedVertices->size();
 }
 
 /**
- * Returns every selected vertex of the mesh in a newly allocated std::vector.
- * \retval	std::vector<Vertex *>	Vector of the selected vertices.
- */
-vector<Vertex *> *Mesh::getSelectedVertices()
+ * Sets the view coordinates of the vertices of this mesh.
+ * \param	vx	Array of the \e x screen coordinates, one for every vertex in order.
+ * \param	vy	Array of the \e y screen coordinates, one for every vertex in order.
+ * The revision of the mesh changes if any of the coordinates differ.
+ * \sa Selection::doFeedback()
+ **/
+void Mesh::setVertexViewCoords(float *vx, float *vy)
 {
-	vector<Vertex *> *selectedVertices = new vector<Vertex *>;
+	bool moved = false;
 
-	for (unsigned i = 0; i < vertices->size(); i++)
+	for(unsigned i = 0; i < vertices->size(); i++)
 	{
 		Vertex *v = (*vertices)[i];
 
-		if (v->selected)
+		if ((v->view.x != vx[i]) || (v->view.y != vy[i]))
 		{
-			selectedVertices->push_back(v);
+			v->view.x = vx[i];
+			v->view.y = vy[i];
+			moved = true;
 		}
 	}
 
-	return selectedVertices;
-}
-
-/**
- * Sets the view coordinates of the vertices of this mesh.
- * Setting the transformation matrices by Transform::setMatrices() is neccesary before calling this,
- * because Transform::project() is used for non visible primitives. If any coordinate's value is Selection::OUT_OF_SCREEN,
- * Transform::project() tries to calculate the vertex's screen coordinate.
- * \param	coords	An array which holds the screen coordinates of the vertices. Three elements in a row will represent a vertex's
-					screen coordinate. First one is the vertex's number, second and third is the \e x and \e y screen coordinate.
- * \param	size	Size of the \c coords array.
- **/
-void Mesh::setVertexViewCoords(float *coords, unsigned int size)
-{
-	for(unsigned i = 0; i < size; i+=3)
-	{
-		unsigned n = (unsigned)coords[i];
-		Vertex *v = (*vertices)[n];
-
-		// vertex is out of screen lets do projection here
-		if(i + 1 < size && coords[i + 1] == Selection::OUT_OF_SCREEN)
-		{
-			Vector3D view = Transform::project(v->coord.x, v->coord.y, 0);
-
-			v->view.x = view.x;
-			v->view.y = view.y;
-		}
-		else
-		{
-			v->view.x = coords[i + 1];
-			v->view.y = coords[i + 2];
-		}
-	}
+	if (moved)
+		changed();
 }
 
 /**
@@ -611,10 +579,7 @@ void Mesh::setVertexViewCoords(float *coords, unsigned int size)
  */
 void Mesh::clearSelection(void)
 {
-	for (unsigned i = 0; i < vertices->size(); i++)
-	{
-		(*vertices)[i]->selected = false;
-	}
+	selection->clear();
 }
 
 /**
@@ -622,11 +587,9 @@ void Mesh::clearSelection(void)
  * Vertices, faces and faces with textures attached to the mesh get drawn
  * based on the actual AnimataSettings::display_elements.
  *
- * There are four drawing modes at this time, which can be combined by
- * bitwise or.
- *	- RENDER_FEEDBACK\n
- *		Only draws a point to every vertex of the mesh, to get their exact
- *		position that can be used to set their screen coordinates.
+ * There are three drawing modes at this time, which can be combined by
+ * bitwise or. The screen coordinates of the vertices are computed by
+ * Selection::doFeedback() before drawing.
  *	- RENDER_WIREFRAME\n
  *		Draws vertex and face outlines.
  *	- RENDER_TEXTURE\n
@@ -677,9 +640,16 @@ void Mesh::draw(int mode, int active)
 		selected++;
 	}
 
-	if (attachedTexture && (mode & RENDER_TEXTURE) &&
+	bool drawTexture = attachedTexture && (mode & RENDER_TEXTURE) &&
 		((!(mode & RENDER_OUTPUT) && ui->settings.display_elements & DISPLAY_EDITOR_TEXTURE) ||
-		((mode & RENDER_OUTPUT) && ui->settings.display_elements & DISPLAY_OUTPUT_TEXTURE)))
+		((mode & RENDER_OUTPUT) && ui->settings.display_elements & DISPLAY_OUTPUT_TEXTURE));
+
+	if (drawTexture && RenderQueue::getCurrent())
+	{
+		// the triangles are drawn batched by texture when the queue is flushed
+		RenderQueue::getCurrent()->addMesh(this, textureAlpha);
+	}
+	else if (drawTexture)
 	{
 		glColor3f(1.f, 1.f, 1.f);
 		glEnable(GL_TEXTURE_2D);
@@ -691,11 +661,14 @@ void Mesh::draw(int mode, int active)
 
 			glColor4f(1.f, 1.f, 1.f, textureAlpha);
 			glBegin(GL_TRIANGLES);
-				glTexCoord2f(face->v[0]->texCoord.x, face->v[0]->texCoord.y);
+				glTexCoord2f(attachedTexture->mapS(face->v[0]->texCoord.x),
+						attachedTexture->mapT(face->v[0]->texCoord.y));
 				glVertex2f(face->v[0]->view.x, face->v[0]->view.y);
-				glTexCoord2f(face->v[1]->texCoord.x, face->v[1]->texCoord.y);
+				glTexCoord2f(attachedTexture->mapS(face->v[1]->texCoord.x),
+						attachedTexture->mapT(face->v[1]->texCoord.y));
 				glVertex2f(face->v[1]->view.x, face->v[1]->view.y);
-				glTexCoord2f(face->v[2]->texCoord.x, face->v[2]->texCoord.y);
+				glTexCoord2f(attachedTexture->mapS(face->v[2]->texCoord.x),
+						attachedTexture->mapT(face->v[2]->texCoord.y));
 				glVertex2f(face->v[2]->view.x, face->v[2]->view.y);
 			glEnd();
 			glColor3f(1.f, 1.f, 1.f);
@@ -725,19 +698,7 @@ void Mesh::draw(int mode, int active)
 		glPopName();
 	}
 
-	if(mode & RENDER_FEEDBACK)
-	{
-		for(unsigned int i = 0; i < vertices->size(); i++)
-		{
-			Vertex *vertex = (*vertices)[i];
-
-			glPassThrough(i);
-			glBegin(GL_POINTS);
-				glVertex2f(vertex->coord.x, vertex->coord.y);
-			glEnd();
-		}
-	}
-	else if ((mode & RENDER_WIREFRAME) &&
+	if ((mode & RENDER_WIREFRAME) &&
 			 ((!(mode & RENDER_OUTPUT) && ui->settings.display_elements & DISPLAY_EDITOR_VERTEX) ||
 			 ((mode & RENDER_OUTPUT) && ui->settings.display_elements & DISPLAY_OUTPUT_VERTEX)))
 	{
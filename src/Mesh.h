@@ -28,6 +28,7 @@
 
 #include "Vertex.h"
 #include "Face.h"
+#include "SelectionSet.h"
 #include "Joint.h"
 #include "Texture.h"
 #include "ADrawable.h"
@@ -45,18 +46,28 @@ class Mesh : public ADrawable
 		vector<Vertex*>	*vertices;					///< vertices building up the mesh
 		vector<Face*>		*faces;						///< faces formed from vertices, representing the texture
 
+		SelectionSet<Vertex>	*selection;					///< selected vertices
+
 		Texture					*attachedTexture;			///< texture attached to the mesh
 
 		Vertex					*pVertex;					///< vertex below the mouse cursor
 		Face					*pFace;						///< face below the mouse cursor
 
 		float					textureAlpha;				///< texture alpha for drawing
-		int						*selectedPointIndices;		///< helper array for triangulateSelected()
 
-		int getSelectedVerticesCount(void);
+		unsigned				revision;					///< changes whenever the drawn image of the mesh may change
+		static unsigned			lastRevision;				///< last revision given to any mesh, revisions are unique
+
+		/// Gives the mesh a new revision.
+		inline void changed(void) { revision = ++lastRevision; }
+
+		/// Returns the number of selected vertices.
+		inline int getSelectedVerticesCount(void) { return selection->size(); }
 		void triangulateSelected(void);
 		void triangulateAll(void);
 
+		void removeFace(Face *face);
+
 		void sortFaces(void);
 		void sortFaces(vector<Face *>::iterator begin,
 						vector<Face *>::iterator end);
@@ -72,9 +83,26 @@ class Mesh : public ADrawable
 
 		int moveSelectedVertices(float dx, float dy);
 		void clearSelection(void);
-		vector<Vertex *> *getSelectedVertices();
 
-		void setVertexViewCoords(float *coords, unsigned int size);
+		/**
+		 * Returns the selected vertices. The vector belongs to the mesh and
+		 * follows the changes of the selection.
+		 * \retval std::vector<Vertex *> The selected vertices in no particular order.
+		 */
+		inline vector<Vertex *> *getSelectedVertices() { return selection->getList(); }
+		/**
+		 * Selects or deselects a vertex of the mesh.
+		 * \param	v	The vertex.
+		 * \param	s	True to select, false to deselect.
+		 */
+		inline void selectVertex(Vertex *v, bool s = true) { selection->set(v, s); }
+		/**
+		 * Inverts the selection state of a vertex of the mesh.
+		 * \param	v	The vertex.
+		 */
+		inline void flipVertexSelection(Vertex *v) { selection->flip(v); }
+
+		void setVertexViewCoords(float *vx, float *vy);
 
 		/**
 		 * Returns the vertex below the mouse cursor.
@@ -103,6 +131,8 @@ class Mesh : public ADrawable
 		void addFace(Vertex *v0, Vertex *v1, Vertex *v2);
 		void clearFaces(void);
 
+		void renumber(void);
+
 		void triangulate(void);
 		void triangulateFaceProc(int p0, int p1, int p2);
 		void triangulateFaceProcSelected(int p0, int p1, int p2);
@@ -116,7 +146,7 @@ class Mesh : public ADrawable
 		 * \param	t	The new texture to attach.
 		 * \sa attachTexture()
 		 */
-		inline void setAttachedTexture(Texture *t) { attachedTexture = t; }
+		inline void setAttachedTexture(Texture *t) { attachedTexture = t; changed(); }
 		/**
 		 * Returns the texture attached to the mesh.
 		 * \retval	Texture*	The attached texture.
@@ -129,9 +159,21 @@ class Mesh : public ADrawable
 		 */
 		inline void setTextureAlpha(float alpha) { textureAlpha = alpha; }
 
+		/**
+		 * Returns the revision of the mesh. The revision changes when the
+		 * view coordinates, the faces or the texture of the mesh change.
+		 * \retval	unsigned	The revision of the mesh.
+		 */
+		inline unsigned getRevision(void) { return revision; }
+		/**
+		 * Returns the last revision given to any mesh. It changes whenever
+		 * the image of any of the meshes changes.
+		 * \retval	unsigned	The last mesh revision.
+		 */
+		static inline unsigned getLastRevision(void) { return lastRevision; }
+
 		virtual void draw(int mode, int active = 1);
 		virtual void select(unsigned i, int type);
-		virtual void circleSelect(unsigned i, int type, int xc, int yc, float r);
 };
 
 } /* namespace Animata */
@@ -0,0 +1,330 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <stdio.h>
+#include <math.h>
+#include <map>
+#include <algorithm>
+
+#include "MeshOptimizer.h"
+
+using namespace Animata;
+
+/**
+ * Optimizes the face and vertex order of the mesh.
+ * Faces are reordered for vertex cache reuse, vertices are put in the order
+ * of their first reference.
+ * \param mesh the mesh to optimize
+ * \param verbose prints the ACMR before and after the optimization if true
+ **/
+void MeshOptimizer::optimize(Mesh *mesh, bool verbose /* = false */)
+{
+	vector<Vertex *> *vertices = mesh->getVertices();
+	vector<Face *> *faces = mesh->getFaces();
+
+	if (faces->empty())
+		return;
+
+	float acmrBefore = verbose ? calcACMR(faces) : 0;
+
+	reorderFaces(vertices, faces);
+	reorderVertices(vertices, faces);
+	mesh->renumber();
+
+	if (verbose)
+	{
+		printf("mesh optimized: %d vertices, %d faces, ACMR %.3f -> %.3f\n",
+				(int)vertices->size(), (int)faces->size(),
+				acmrBefore, calcACMR(faces));
+	}
+}
+
+/**
+ * Calculates the average cache miss ratio of the faces, the number of
+ * vertex transformations per triangle with a FIFO post-transform cache.
+ * \param faces faces in drawing order
+ * \param cacheSize size of the simulated FIFO cache
+ * \return the ACMR, between 0.5 at best and 3 at worst
+ **/
+float MeshOptimizer::calcACMR(vector<Face *> *faces,
+		int cacheSize /* = MESHOPT_FIFO_SIZE */)
+{
+	if (faces->empty())
+		return 0;
+
+	vector<Vertex *> cache(cacheSize, (Vertex *)NULL);
+	int head = 0;
+	int misses = 0;
+
+	for (unsigned i = 0; i < faces->size(); i++)
+	{
+		Face *f = (*faces)[i];
+		for (int j = 0; j < 3; j++)
+		{
+			if (find(cache.begin(), cache.end(), f->v[j]) == cache.end())
+			{
+				cache[head] = f->v[j];
+				head = (head + 1) % cacheSize;
+				misses++;
+			}
+		}
+	}
+
+	return (float)misses / faces->size();
+}
+
+/**
+ * Calculates the score of a vertex in the Forsyth optimization.
+ * \param cachePosition position of the vertex in the LRU cache, -1 if the
+ *	vertex is not in the cache
+ * \param remainingFaces number of not yet emitted faces using the vertex
+ * \return the vertex score, -1 if the vertex has no remaining faces
+ **/
+float MeshOptimizer::vertexScore(int cachePosition, int remainingFaces)
+{
+	if (remainingFaces == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		// the vertices of the last triangle get a fixed score, so the next
+		// triangle is not necessarily sharing an edge with it
+		if (cachePosition < 3)
+			score = 0.75f;
+		else
+		{
+			float s = 1.0f - (float)(cachePosition - 3) /
+				(MESHOPT_CACHE_SIZE - 3);
+			score = powf(s, 1.5f);
+		}
+	}
+
+	// boost vertices with few remaining faces to get rid of lone triangles
+	score += 2.0f * powf((float)remainingFaces, -0.5f);
+
+	return score;
+}
+
+/**
+ * Reorders faces to improve the vertex cache hit rate.
+ * \param vertices the mesh vertices
+ * \param faces the mesh faces, reordered in place
+ **/
+void MeshOptimizer::reorderFaces(vector<Vertex *> *vertices,
+		vector<Face *> *faces)
+{
+	int vertexCount = vertices->size();
+	int faceCount = faces->size();
+
+	map<Vertex *, int> vertexIndex;
+	for (int i = 0; i < vertexCount; i++)
+		vertexIndex[(*vertices)[i]] = i;
+
+	int *indices = new int[faceCount * 3];
+	for (int i = 0; i < faceCount; i++)
+	{
+		for (int j = 0; j < 3; j++)
+			indices[i * 3 + j] = vertexIndex[(*faces)[i]->v[j]];
+	}
+
+	// faces of each vertex, the first remaining[v] entries are not emitted
+	int *remaining = new int[vertexCount];
+	int *offset = new int[vertexCount + 1];
+	int *vertexFaces = new int[faceCount * 3];
+	int *cachePos = new int[vertexCount];
+	float *score = new float[vertexCount];
+
+	for (int i = 0; i < vertexCount; i++)
+		remaining[i] = 0;
+	for (int i = 0; i < faceCount * 3; i++)
+		remaining[indices[i]]++;
+	offset[0] = 0;
+	for (int i = 0; i < vertexCount; i++)
+		offset[i + 1] = offset[i] + remaining[i];
+	for (int i = 0; i < vertexCount; i++)
+		remaining[i] = 0;
+	for (int i = 0; i < faceCount * 3; i++)
+	{
+		int v = indices[i];
+		vertexFaces[offset[v] + remaining[v]++] = i / 3;
+	}
+	for (int i = 0; i < vertexCount; i++)
+	{
+		cachePos[i] = -1;
+		score[i] = vertexScore(-1, remaining[i]);
+	}
+
+	float *faceScore = new float[faceCount];
+	bool *emitted = new bool[faceCount];
+	for (int i = 0; i < faceCount; i++)
+	{
+		faceScore[i] = score[indices[i * 3]] + score[indices[i * 3 + 1]] +
+			score[indices[i * 3 + 2]];
+		emitted[i] = false;
+	}
+
+	// LRU cache, it holds 3 extra entries while a new face is inserted
+	int cache[MESHOPT_CACHE_SIZE + 3];
+	int cacheCount = 0;
+
+	vector<Face *> newFaces;
+	newFaces.reserve(faceCount);
+
+	int best = -1;
+	for (int n = 0; n < faceCount; n++)
+	{
+		if (best < 0)
+		{
+			// no candidate in the cache, search the whole mesh
+			float bestScore = -1.0f;
+			for (int i = 0; i < faceCount; i++)
+			{
+				if (!emitted[i] && (faceScore[i] > bestScore))
+				{
+					bestScore = faceScore[i];
+					best = i;
+				}
+			}
+		}
+
+		emitted[best] = true;
+		newFaces.push_back((*faces)[best]);
+
+		// remove the face from the remaining faces of its vertices
+		int *tri = indices + best * 3;
+		for (int j = 0; j < 3; j++)
+		{
+			int v = tri[j];
+			int *vf = vertexFaces + offset[v];
+			for (int k = 0; k < remaining[v]; k++)
+			{
+				if (vf[k] == best)
+				{
+					vf[k] = vf[remaining[v] - 1];
+					vf[remaining[v] - 1] = best;
+					break;
+				}
+			}
+			remaining[v]--;
+		}
+
+		// move the face vertices to the front of the cache
+		int newCache[MESHOPT_CACHE_SIZE + 3];
+		int newCount = 0;
+		for (int j = 0; j < 3; j++)
+		{
+			if (find(newCache, newCache + newCount, tri[j]) ==
+					newCache + newCount)
+				newCache[newCount++] = tri[j];
+		}
+		for (int j = 0; j < cacheCount; j++)
+		{
+			int v = cache[j];
+			if ((v != tri[0]) && (v != tri[1]) && (v != tri[2]))
+				newCache[newCount++] = v;
+		}
+
+		// update the scores of the vertices in the cache and of the ones
+		// which have just dropped out of it
+		for (int j = 0; j < newCount; j++)
+		{
+			int v = newCache[j];
+			cachePos[v] = (j < MESHOPT_CACHE_SIZE) ? j : -1;
+			score[v] = vertexScore(cachePos[v], remaining[v]);
+		}
+
+		// rescore the faces around the cached vertices and pick the best
+		best = -1;
+		float bestScore = -1.0f;
+		for (int j = 0; j < newCount; j++)
+		{
+			int v = newCache[j];
+			int *vf = vertexFaces + offset[v];
+			for (int k = 0; k < remaining[v]; k++)
+			{
+				int f = vf[k];
+				int *t = indices + f * 3;
+				faceScore[f] = score[t[0]] + score[t[1]] + score[t[2]];
+				if (faceScore[f] > bestScore)
+				{
+					bestScore = faceScore[f];
+					best = f;
+				}
+			}
+		}
+
+		cacheCount = min(newCount, MESHOPT_CACHE_SIZE);
+		for (int j = 0; j < cacheCount; j++)
+			cache[j] = newCache[j];
+	}
+
+	*faces = newFaces;
+
+	delete [] emitted;
+	delete [] faceScore;
+	delete [] score;
+	delete [] cachePos;
+	delete [] vertexFaces;
+	delete [] offset;
+	delete [] remaining;
+	delete [] indices;
+}
+
+/**
+ * Reorders vertices in the order of their first use by the faces. Vertices
+ * not referenced by any face are moved to the end keeping their order.
+ * \param vertices the mesh vertices, reordered in place
+ * \param faces the mesh faces
+ **/
+void MeshOptimizer::reorderVertices(vector<Vertex *> *vertices,
+		vector<Face *> *faces)
+{
+	map<Vertex *, bool> used;
+	vector<Vertex *> newVertices;
+	newVertices.reserve(vertices->size());
+
+	for (unsigned i = 0; i < faces->size(); i++)
+	{
+		Face *f = (*faces)[i];
+		for (int j = 0; j < 3; j++)
+		{
+			if (!used[f->v[j]])
+			{
+				used[f->v[j]] = true;
+				newVertices.push_back(f->v[j]);
+			}
+		}
+	}
+
+	for (unsigned i = 0; i < vertices->size(); i++)
+	{
+		Vertex *v = (*vertices)[i];
+		if (!used[v])
+			newVertices.push_back(v);
+	}
+
+	*vertices = newVertices;
+}
+
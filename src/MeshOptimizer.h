@@ -0,0 +1,71 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __MESHOPTIMIZER_H__
+#define __MESHOPTIMIZER_H__
+
+#include <vector>
+
+#include "Mesh.h"
+
+/// size of the simulated post-transform vertex cache used for reordering
+#define MESHOPT_CACHE_SIZE 32
+/// size of the FIFO cache used when measuring the ACMR
+#define MESHOPT_FIFO_SIZE 16
+
+using namespace std;
+
+namespace Animata
+{
+
+/**
+ * Reorders mesh faces and vertices for post-transform vertex cache reuse
+ * and memory locality.
+ *
+ * Faces are reordered with Tom Forsyth's linear-speed vertex cache
+ * optimisation, then vertices are sorted to the order of their first use by
+ * the faces. Bones reference their attached vertices by pointer, so the
+ * attachments stay valid without remapping.
+ **/
+class MeshOptimizer
+{
+	public:
+		static void optimize(Mesh *mesh, bool verbose = false);
+
+		static float calcACMR(vector<Face *> *faces,
+				int cacheSize = MESHOPT_FIFO_SIZE);
+
+	private:
+		static void reorderFaces(vector<Vertex *> *vertices,
+				vector<Face *> *faces);
+		static void reorderVertices(vector<Vertex *> *vertices,
+				vector<Face *> *faces);
+
+		static float vertexScore(int cachePosition, int remainingFaces);
+};
+
+} /* namespace Animata */
+
+#endif
+
@@ -0,0 +1,181 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __NAMEINDEX_H__
+#define __NAMEINDEX_H__
+
+#include <string.h>
+#include <vector>
+
+using namespace std;
+
+#define NAMEINDEX_MIN_BUCKETS 64
+
+namespace Animata
+{
+
+/**
+ * Hash index of named elements, finds the elements with a given name in
+ * constant time.
+ *
+ * The elements are hashed by the name returned by their getName() method.
+ * Unnamed elements can be added too, they are not stored in the hash table,
+ * but their \a inNameIndex flag records that they belong to the index, so
+ * they are hashed when they get a name. The name of an element must not
+ * change without removing it before and adding it again after the change,
+ * remove() tells whether it has to be added again.
+ **/
+template <class T>
+class NameIndex
+{
+	public:
+		NameIndex()
+		{
+			buckets = new vector<vector<T *> >(NAMEINDEX_MIN_BUCKETS);
+			count = 0;
+		}
+
+		~NameIndex()
+		{
+			delete buckets;
+		}
+
+		/**
+		 * Adds an element to the index.
+		 * \param e the element, it is only hashed if it has a name
+		 **/
+		void add(T *e)
+		{
+			if (e->inNameIndex)
+				return;
+			e->inNameIndex = true;
+
+			const char *name = e->getName();
+			if (name[0] == 0)
+				return;
+
+			if (count >= buckets->size())
+				rehash(buckets->size() * 2);
+
+			(*buckets)[hash(name) % buckets->size()].push_back(e);
+			count++;
+		}
+
+		/**
+		 * Removes an element from the index.
+		 * \param e the element
+		 * \return true if the element was in the index, named or not
+		 **/
+		bool remove(T *e)
+		{
+			if (!e->inNameIndex)
+				return false;
+			e->inNameIndex = false;
+
+			const char *name = e->getName();
+			if (name[0] == 0)
+				return true;
+
+			vector<T *> &bucket = (*buckets)[hash(name) % buckets->size()];
+			for (unsigned i = 0; i < bucket.size(); i++)
+			{
+				if (bucket[i] == e)
+				{
+					bucket[i] = bucket.back();
+					bucket.pop_back();
+					count--;
+					return true;
+				}
+			}
+			return true;
+		}
+
+		/**
+		 * Collects the elements having the given name.
+		 * \param name the name to look for
+		 * \param found the elements are appended to this vector
+		 * \return the number of elements found
+		 **/
+		unsigned find(const char *name, vector<T *> *found)
+		{
+			unsigned n = 0;
+			if (name[0] == 0)
+				return 0;
+			vector<T *> &bucket = (*buckets)[hash(name) % buckets->size()];
+			for (unsigned i = 0; i < bucket.size(); i++)
+			{
+				if (strcmp(bucket[i]->getName(), name) == 0)
+				{
+					found->push_back(bucket[i]);
+					n++;
+				}
+			}
+			return n;
+		}
+
+		/// Returns the number of named elements in the index.
+		inline unsigned size(void) { return count; }
+
+	private:
+		/**
+		 * Calculates the FNV-1a hash of a name.
+		 * \param name the name
+		 * \return the hash value
+		 **/
+		static unsigned hash(const char *name)
+		{
+			unsigned h = 2166136261u;
+			for (; *name; name++)
+			{
+				h ^= (unsigned char)*name;
+				h *= 16777619u;
+			}
+			return h;
+		}
+
+		/**
+		 * Redistributes the elements into a new number of buckets.
+		 * \param n the number of buckets
+		 **/
+		void rehash(unsigned n)
+		{
+			vector<vector<T *> > *old = buckets;
+			buckets = new vector<vector<T *> >(n);
+			for (unsigned i = 0; i < old->size(); i++)
+			{
+				vector<T *> &bucket = (*old)[i];
+				for (unsigned j = 0; j < bucket.size(); j++)
+					(*buckets)[hash(bucket[j]->getName()) % n].push_back(bucket[j]);
+			}
+			delete old;
+		}
+
+		vector<vector<T *> > *buckets;	///< elements by the hash of their name
+		unsigned count;					///< number of named elements in the index
+};
+
+} /* namespace Animata */
+
+#endif
+
@@ -0,0 +1,85 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "OSCCommandQueue.h"
+
+using namespace Animata;
+
+/**
+ * Creates an empty queue.
+ **/
+OSCCommandQueue::OSCCommandQueue()
+{
+	commands = new OSCCommand[OSC_COMMAND_QUEUE_SIZE];
+	head = tail = 0;
+	dropped = 0;
+}
+
+OSCCommandQueue::~OSCCommandQueue()
+{
+	delete [] commands;
+}
+
+/**
+ * Adds a command to the end of the queue. Called by the producer thread.
+ * \param command the command to copy into the queue
+ * \return false if the queue is full and the command is dropped
+ **/
+bool OSCCommandQueue::push(const OSCCommand &command)
+{
+	unsigned t = tail;
+	// the indices are wrapping counters, their difference is the fill level
+	if (t - head >= OSC_COMMAND_QUEUE_SIZE)
+	{
+		dropped++;
+		return false;
+	}
+
+	commands[t & (OSC_COMMAND_QUEUE_SIZE - 1)] = command;
+	// the command has to be complete before the consumer can see it
+	__sync_synchronize();
+	tail = t + 1;
+	return true;
+}
+
+/**
+ * Removes the first command of the queue. Called by the consumer thread.
+ * \param command the command is copied here
+ * \return false if the queue is empty
+ **/
+bool OSCCommandQueue::pop(OSCCommand *command)
+{
+	unsigned h = head;
+	if (h == tail)
+		return false;
+
+	// the command is read after the tail showing it
+	__sync_synchronize();
+	*command = commands[h & (OSC_COMMAND_QUEUE_SIZE - 1)];
+	// the slot is read before the producer can reuse it
+	__sync_synchronize();
+	head = h + 1;
+	return true;
+}
+
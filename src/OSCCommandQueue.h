@@ -0,0 +1,93 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __OSCCOMMANDQUEUE_H__
+#define __OSCCOMMANDQUEUE_H__
+
+/// number of commands the queue can hold, has to be a power of two
+#define OSC_COMMAND_QUEUE_SIZE 4096
+/// size of the name pattern buffer of a command
+#define OSC_COMMAND_NAME_SIZE 64
+
+namespace Animata
+{
+
+/// Types of the OSC commands.
+enum OSC_COMMAND_TYPE
+{
+	OSC_COMMAND_ANIBONE = 0,	///< /anibone name value
+	OSC_COMMAND_JOINT,			///< /joint name x y
+	OSC_COMMAND_LAYERVIS,		///< /layervis name visible
+	OSC_COMMAND_LAYERALPHA,		///< /layeralpha name alpha
+	OSC_COMMAND_LAYERPOS,		///< /layerpos name x y [z]
+	OSC_COMMAND_LAYERDELTAPOS,	///< /layerdeltapos name dx dy
+	OSC_COMMAND_UPDATE_TEXTURES	///< /updateTextures
+};
+
+/// Decoded OSC message waiting to be applied to the scene.
+struct OSCCommand
+{
+	int type;						///< one of OSC_COMMAND_TYPE
+	char name[OSC_COMMAND_NAME_SIZE];	///< name or pattern of the elements
+	float x;						///< x-coordinate, bone value or layer alpha
+	float y;						///< y-coordinate
+	float z;						///< z-coordinate, used if hasZ is set
+	bool hasZ;						///< true if z is given
+	bool visible;					///< layer visibility
+};
+
+/**
+ * Bounded lock-free queue of OSC commands between one producer and one
+ * consumer thread.
+ *
+ * The producer writes the command into the slot at the tail and advances
+ * the tail after it, the consumer reads the slot at the head and advances
+ * the head after it. Each index is written by one thread only, so the two
+ * sides never wait for each other. Several producers have to be serialized
+ * by the caller. Commands pushed while the queue is full are dropped.
+ **/
+class OSCCommandQueue
+{
+	public:
+		OSCCommandQueue();
+		~OSCCommandQueue();
+
+		bool push(const OSCCommand &command);
+		bool pop(OSCCommand *command);
+
+		/// Returns the number of commands dropped because the queue was full.
+		inline unsigned getDropped(void) { return dropped; }
+
+	private:
+		OSCCommand *commands;		///< ring of OSC_COMMAND_QUEUE_SIZE commands
+
+		volatile unsigned head;		///< next command to pop, written by the consumer
+		volatile unsigned tail;		///< next free slot, written by the producer
+		volatile unsigned dropped;	///< number of dropped commands, written by the producer
+};
+
+} /* namespace Animata */
+
+#endif
+
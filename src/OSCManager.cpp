@@ -23,6 +23,7 @@
 
 #include <iostream>
 #include <unistd.h>
+#include <string.h>
 
 #include "animata.h"
 #include "animataUI.h"
@@ -35,417 +36,265 @@ OSCListener::OSCListener()
 {
 	thread = 0;
 	rootLayer = NULL;
+	bonePatterns = new PatternCache<Bone>(patternMatch);
+	jointPatterns = new PatternCache<Joint>(patternMatch);
+	layerPatterns = new PatternCache<Layer>(patternMatch);
+	namedBones = new vector<Bone *>;
+	namedJoints = new vector<Joint *>;
+	namedLayers = new vector<Layer *>;
+	commands = new OSCCommandQueue();
+	reportedDrops = 0;
+	// the messages can also be processed without the listener thread
+	pthread_mutex_init(&mutex, NULL);
 }
 
 OSCListener::~OSCListener()
 {
 	stop();
+	pthread_mutex_destroy(&mutex);
+	delete bonePatterns;
+	delete jointPatterns;
+	delete layerPatterns;
+	delete namedBones;
+	delete namedJoints;
+	delete namedLayers;
+	delete commands;
 }
 
+/**
+ * Reads a numeric argument, which can be float or int.
+ * \param arg the argument, it is advanced to the next one
+ * \return the value of the argument
+ **/
+static float numberArgument(osc::ReceivedMessage::const_iterator &arg)
+{
+	if (arg->IsInt32())
+		return (arg++)->AsInt32();
+	else
+		return (arg++)->AsFloat();
+}
+
+/**
+ * Parses an OSC message and queues it as a command for the next simulation
+ * step. The scene is not touched from the network thread.
+ **/
 void OSCListener::ProcessMessage(const osc::ReceivedMessage& m,
 		const IpEndpointName& remoteEndpoint)
 {
+	OSCCommand c;
+	const char *namePattern = "";
 
-
-//	if (!rootLayer)
-//	{
-//	    cout << "OSCManager - Not rootLayer, ABORTING" << endl;
-//		return;
-//	}
-//
-//	if (!ui) // FIXME: this should not happen but it does
-//    {
-//         cout << "OSCManager - Not UI, ABORTING" << endl;
-//		return;
-//    }
+	c.x = c.y = c.z = 0;
+	c.hasZ = false;
+	c.visible = false;
 
 	try
 	{
-		// TODO: write one function for each object type and call it
-		// with a function pointer on each message
 		if (strcmp(m.AddressPattern(), "/anibone") == 0)
 		{
 			osc::ReceivedMessageArgumentStream args = m.ArgumentStream();
-			const char *namePattern;
-			float val;
-			args >> namePattern >> val >> osc::EndMessage;
-
-			// FIXME: locking?, bones should not be deleted while this is
-			// running
-			lock();
-			vector<Bone *> *bones = ui->editorBox->getAllBones();
-
-			int found = 0;
-			// try to find exact match for bone names first
-			vector<Bone *>::iterator b = bones->begin();
-			for (; b < bones->end(); b++)
-			{
-				const char *boneName = (*b)->getName();
-				// skip unnamed bones
-				if (boneName[0] == 0)
-					continue;
-				if (strcmp(boneName, namePattern) == 0)
-				{
-					(*b)->animateBone(val);
-					found = 1;
-				}
-			}
-
-			// if exact match is not found try regular expression match
-			if (!found)
-			{
-				vector<Bone *>::iterator b = bones->begin();
-				for (; b < bones->end(); b++)
-				{
-					const char *boneName = (*b)->getName();
-					// skip unnamed bones
-					if (boneName[0] == 0)
-						continue;
-					if (patternMatch(boneName, namePattern))
-					{
-						(*b)->animateBone(val);
-					}
-				}
-			}
-
-			unlock();
+			args >> namePattern >> c.x >> osc::EndMessage;
+			c.type = OSC_COMMAND_ANIBONE;
 		}
 		else if (strcmp(m.AddressPattern(), "/joint") == 0)
 		{
-			osc::ReceivedMessageArgumentStream args = m.ArgumentStream();
-			const char *namePattern;
-			float x, y;
-			//args >> namePattern >> x >> y >> osc::EndMessage;
 			osc::ReceivedMessage::const_iterator arg = m.ArgumentsBegin();
 			namePattern = (arg++)->AsString();
-
 			/* parameters can be float or int */
-			if (arg->IsInt32())
-				x = (arg++)->AsInt32();
-			else
-				x = (arg++)->AsFloat();
-			if (arg->IsInt32())
-				y = (arg++)->AsInt32();
-			else
-				y = (arg++)->AsFloat();
-			if (arg != m.ArgumentsEnd()) {
-                    cout << "Excess Argument Exception" << endl;
+			c.x = numberArgument(arg);
+			c.y = numberArgument(arg);
+			if (arg != m.ArgumentsEnd())
 				throw osc::ExcessArgumentException();
-			}
-
-			lock();
-
-			vector<Joint *> *joints = ui->editorBox->getAllJoints();
-
-			int found = 0;
-			// try to find exact match for joint names first
-			vector<Joint *>::iterator j = joints->begin();
-			for (; j < joints->end(); j++)
-			{
-				const char *jointName = (*j)->getName();
-				// skip unnamed joints
-				if (jointName[0] == 0)
-					continue;
-				if (strcmp(jointName, namePattern) == 0)
-				{
-					(*j)->x = x;
-					(*j)->y = y;
-					found = 1;
-				}
-			}
-
-			// if exact match is not found try regular expression match
-			if (!found)
-			{
-				vector<Joint *>::iterator j = joints->begin();
-				for (; j < joints->end(); j++)
-				{
-					const char *jointName = (*j)->getName();
-					// skip unnamed joints
-					if (jointName[0] == 0)
-						continue;
-					if (patternMatch(jointName, namePattern))
-					{
-						(*j)->x = x;
-						(*j)->y = y;
-					}
-				}
-			}
-			unlock();
+			c.type = OSC_COMMAND_JOINT;
 		}
 		else if (strcmp(m.AddressPattern(), "/layervis") == 0)
 		{
-			osc::ReceivedMessageArgumentStream args = m.ArgumentStream();
-			const char *namePattern;
-			bool val;
-
 			osc::ReceivedMessage::const_iterator arg = m.ArgumentsBegin();
 			namePattern = (arg++)->AsString();
 			/* parameter can be boolean or int */
 			if (arg->IsBool())
-				val = (arg++)->AsBool();
+				c.visible = (arg++)->AsBool();
 			else
-				val = (1 == (arg++)->AsInt32());
+				c.visible = (1 == (arg++)->AsInt32());
 			if (arg != m.ArgumentsEnd())
 				throw osc::ExcessArgumentException();
-
-			// get all layers
-			lock();
-			vector<Layer *> *layers = ui->editorBox->getAllLayers();
-
-			int found = 0;
-			// try to find exact match for layer names first
-			vector<Layer *>::iterator l = layers->begin();
-			for (; l < layers->end(); l++)
-			{
-				const char *layerName = (*l)->getName();
-				// skip unnamed layers
-				if (layerName[0] == 0)
-					continue;
-
-				if (strcmp(layerName, namePattern) == 0)
-				{
-					(*l)->setVisibility(val);
-					found = 1;
-				}
-			}
-
-			// if exact match is not found try regular expression match
-			if (!found)
-			{
-				vector<Layer *>::iterator l = layers->begin();
-				for (; l < layers->end(); l++)
-				{
-					const char *layerName = (*l)->getName();
-					// skip unnamed layers
-					if (layerName[0] == 0)
-						continue;
-					if (patternMatch(layerName, namePattern))
-					{
-						(*l)->setVisibility(val);
-						found = 1;
-					}
-				}
-			}
-
-			if (!found)
-			{
-				cerr << "OSC error: " << m.AddressPattern() << ": "
-					<< "layer is not found" << "\n";
-			}
-			unlock();
+			c.type = OSC_COMMAND_LAYERVIS;
 		}
 		else if (strcmp(m.AddressPattern(), "/layeralpha") == 0)
 		{
 			osc::ReceivedMessageArgumentStream args = m.ArgumentStream();
-			const char *namePattern;
-			float val;
-			args >> namePattern >> val >> osc::EndMessage;
-
-			// get all layers
-			lock();
-			vector<Layer *> *layers = ui->editorBox->getAllLayers();
-
-			int found = 0;
-			// try to find exact match for layer names first
-			vector<Layer *>::iterator l = layers->begin();
-			for (; l < layers->end(); l++)
-			{
-				const char *layerName = (*l)->getName();
-				// skip unnamed layers
-				if (layerName[0] == 0)
-					continue;
-				if (strcmp(layerName, namePattern) == 0)
-				{
-					(*l)->setAlpha(val);
-					found = 1;
-				}
-			}
-
-			// if exact match is not found try regular expression match
-			if (!found)
-			{
-				vector<Layer *>::iterator l = layers->begin();
-				for (; l < layers->end(); l++)
-				{
-					const char *layerName = (*l)->getName();
-					// skip unnamed layers
-					if (layerName[0] == 0)
-						continue;
-					if (patternMatch(layerName, namePattern))
-					{
-						(*l)->setAlpha(val);
-						found = 1;
-					}
-				}
-			}
-
-			if (!found)
-			{
-				cerr << "OSC error: " << m.AddressPattern() << ": "
-					<< "layer is not found" << "\n";
-			}
-			unlock();
+			args >> namePattern >> c.x >> osc::EndMessage;
+			c.type = OSC_COMMAND_LAYERALPHA;
 		}
 		else if (strcmp(m.AddressPattern(), "/layerpos") == 0)
 		{
-			osc::ReceivedMessageArgumentStream args = m.ArgumentStream();
-			const char *namePattern;
-			float x;
-			float y;
-			float z=0;
-			//args >> namePattern >> x >> y >> osc::EndMessage;
 			osc::ReceivedMessage::const_iterator arg = m.ArgumentsBegin();
 			namePattern = (arg++)->AsString();
 			/* parameters can be float or int */
-			if (arg->IsInt32())
-				x = (arg++)->AsInt32();
-			else
-				x = (arg++)->AsFloat();
-			if (arg->IsInt32())
-				y = (arg++)->AsInt32();
-			else
-				y = (arg++)->AsFloat();
+			c.x = numberArgument(arg);
+			c.y = numberArgument(arg);
 			if (m.ArgumentCount() == 4)
 			{
-				if (arg->IsInt32())
-					z = (arg++)->AsInt32();
-				else
-					z = (arg++)->AsFloat();
+				c.z = numberArgument(arg);
+				c.hasZ = true;
 			}
 			if (arg != m.ArgumentsEnd())
 				throw osc::ExcessArgumentException();
-
-			// get all layers
-			lock();
-			vector<Layer *> *layers = ui->editorBox->getAllLayers();
-
-			int found = 0;
-			// try to find exact match for layer names first
-			vector<Layer *>::iterator l = layers->begin();
-			for (; l < layers->end(); l++)
-			{
-				const char *layerName = (*l)->getName();
-				// skip unnamed layers
-				if (layerName[0] == 0)
-					continue;
-				if (strcmp(layerName, namePattern) == 0)
-				{
-					(*l)->setX(x);
-					(*l)->setY(y);
-					if (m.ArgumentCount() == 4)
-						(*l)->setZ(z);
-					found = 1;
-				}
-			}
-
-			// if exact match is not found try regular expression match
-			if (!found)
-			{
-				vector<Layer *>::iterator l = layers->begin();
-				for (; l < layers->end(); l++)
-				{
-					const char *layerName = (*l)->getName();
-					// skip unnamed layers
-					if (layerName[0] == 0)
-						continue;
-					if (patternMatch(layerName, namePattern))
-					{
-						(*l)->setX(x);
-						(*l)->setY(y);
-						found = 1;
-					}
-				}
-			}
-
-			if (!found)
-			{
-				cerr << "OSC error: " << m.AddressPattern() << ": "
-					<< "layer " << namePattern << " is not found" << "\n";
-			}
-			unlock();
+			c.type = OSC_COMMAND_LAYERPOS;
 		}
 		else if (strcmp(m.AddressPattern(), "/layerdeltapos") == 0)
 		{
-			osc::ReceivedMessageArgumentStream args = m.ArgumentStream();
-			const char *namePattern;
-			float x;
-			float y;
-			//args >> namePattern >> x >> y >> osc::EndMessage;
 			osc::ReceivedMessage::const_iterator arg = m.ArgumentsBegin();
 			namePattern = (arg++)->AsString();
 			/* parameters can be float or int */
-			if (arg->IsInt32())
-				x = (arg++)->AsInt32();
-			else
-				x = (arg++)->AsFloat();
-			if (arg->IsInt32())
-				y = (arg++)->AsInt32();
-			else
-				y = (arg++)->AsFloat();
+			c.x = numberArgument(arg);
+			c.y = numberArgument(arg);
 			if (arg != m.ArgumentsEnd())
 				throw osc::ExcessArgumentException();
+			c.type = OSC_COMMAND_LAYERDELTAPOS;
+		}
+		else if (strcmp(m.AddressPattern(), "/updateTextures") == 0)
+		{
+			c.type = OSC_COMMAND_UPDATE_TEXTURES;
+		}
+		else
+			return;
+	}
+	catch (osc::Exception& e)
+	{
+		// any parsing errors get thrown as exceptions
+		cerr << "OSC error: " << m.AddressPattern() << ": "
+			<< e.what() << "\n";
+		return;
+	}
 
-			// get all layers
-			lock();
-			vector<Layer *> *layers = ui->editorBox->getAllLayers();
+	if (strlen(namePattern) >= OSC_COMMAND_NAME_SIZE)
+	{
+		cerr << "OSC error: " << m.AddressPattern() << ": "
+			<< "name is too long" << "\n";
+		return;
+	}
+	strcpy(c.name, namePattern);
 
-			int found = 0;
-			// try to find exact match for layer names first
-			vector<Layer *>::iterator l = layers->begin();
-			for (; l < layers->end(); l++)
+	// only the producers are serialized, the simulation thread takes the
+	// commands without locking
+	lock();
+	commands->push(c);
+	unlock();
+}
+
+/**
+ * Finds the elements addressed by an OSC command, the ones having the exact
+ * name if there are any, the ones matching it as a pattern otherwise.
+ * \param name name or pattern
+ * \param elements all the elements
+ * \param index name index of the elements
+ * \param patterns pattern cache of the elements
+ * \param named vector for the elements found by name
+ * \return the elements found, valid until the next call
+ **/
+template <class T>
+static vector<T *> *resolveName(const char *name, vector<T *> *elements,
+		NameIndex<T> *index, PatternCache<T> *patterns, vector<T *> *named)
+{
+	named->clear();
+	if (index->find(name, named))
+		return named;
+	return patterns->find(name, elements, ui->editorBox->getNameVersion());
+}
+
+/**
+ * Applies the queued OSC commands to the scene in the order they arrived.
+ * Has to be called with the scene locked, the simulation thread calls it at
+ * the beginning of each step.
+ **/
+void OSCListener::applyCommands(void)
+{
+	AnimataWindow *editor = ui->editorBox;
+	// the commands wait until there is a scene
+	if (editor->getAllLayers() == NULL)
+		return;
+
+	unsigned applied = 0;
+	OSCCommand c;
+	while (commands->pop(&c))
+	{
+		applied++;
+
+		if (c.type == OSC_COMMAND_ANIBONE)
+		{
+			vector<Bone *> *bones = resolveName(c.name,
+					editor->getAllBones(), editor->getBoneNames(),
+					bonePatterns, namedBones);
+			vector<Bone *>::iterator b = bones->begin();
+			for (; b < bones->end(); b++)
+				(*b)->animateBone(c.x);
+		}
+		else if (c.type == OSC_COMMAND_JOINT)
+		{
+			vector<Joint *> *joints = resolveName(c.name,
+					editor->getAllJoints(), editor->getJointNames(),
+					jointPatterns, namedJoints);
+			vector<Joint *>::iterator j = joints->begin();
+			for (; j < joints->end(); j++)
 			{
-				const char *layerName = (*l)->getName();
-				// skip unnamed layers
-				if (layerName[0] == 0)
-					continue;
-				if (strcmp(layerName, namePattern) == 0)
-				{
-					(*l)->move(x, y);
-					found = 1;
-				}
+				(*j)->x = c.x;
+				(*j)->y = c.y;
 			}
-
-			// if exact match is not found try regular expression match
-			if (!found)
+		}
+		else if (c.type == OSC_COMMAND_UPDATE_TEXTURES)
+		{
+			editor->flagUpdateTextures();
+		}
+		else
+		{
+			vector<Layer *> *layers = resolveName(c.name,
+					editor->getAllLayers(), editor->getLayerNames(),
+					layerPatterns, namedLayers);
+			if (layers->empty())
 			{
-				vector<Layer *>::iterator l = layers->begin();
-				for (; l < layers->end(); l++)
-				{
-					const char *layerName = (*l)->getName();
-					// skip unnamed layers
-					if (layerName[0] == 0)
-						continue;
-					if (patternMatch(layerName, namePattern))
-					{
-						(*l)->move(x, y);
-						found = 1;
-					}
-				}
+				cerr << "OSC error: " << "layer " << c.name
+					<< " is not found" << "\n";
 			}
 
-			if (!found)
+			vector<Layer *>::iterator l = layers->begin();
+			for (; l < layers->end(); l++)
 			{
-				cerr << "OSC error: " << m.AddressPattern() << ": "
-					<< "layer is not found" << "\n";
+				switch (c.type)
+				{
+					case OSC_COMMAND_LAYERVIS:
+						(*l)->setVisibility(c.visible);
+						break;
+					case OSC_COMMAND_LAYERALPHA:
+						(*l)->setAlpha(c.x);
+						break;
+					case OSC_COMMAND_LAYERPOS:
+						(*l)->setX(c.x);
+						(*l)->setY(c.y);
+						if (c.hasZ)
+							(*l)->setZ(c.z);
+						break;
+					case OSC_COMMAND_LAYERDELTAPOS:
+						(*l)->move(c.x, c.y);
+						break;
+					default:
+						break;
+				}
 			}
-			unlock();
 		}
-        else if (strcmp(m.AddressPattern(), "/updateTextures") == 0)
-        {
-            cout << "Updating Textures...";
-            lock();
-            ui->editorBox->flagUpdateTextures();
-            unlock();
-            cout << "Done!" << endl;
-        }
 	}
-	catch (osc::Exception& e)
+
+	unsigned dropped = commands->getDropped();
+	if (dropped != reportedDrops)
 	{
-		// any parsing errors get thrown as exceptions
-		cerr << "OSC error: " << m.AddressPattern() << ": "
-			<< e.what() << "\n";
+		cerr << "OSC error: " << dropped - reportedDrops
+			<< " messages dropped, the command queue is full" << "\n";
+		reportedDrops = dropped;
 	}
+
+	// the scene has been changed by the messages
+	if (applied)
+		editor->requestRedraw();
 }
 
 void *OSCListener::threadFunc(void *p)
@@ -460,7 +309,6 @@ void OSCListener::start(void)
 	{
 		pthread_create(&thread, NULL, &threadFunc, this);
 		pthread_setname_np(thread, "OSCListener");
-		pthread_mutex_init(&mutex, NULL);
 	}
 }
 
@@ -471,7 +319,6 @@ void OSCListener::stop(void)
 		// send a break to make the listener exit from its Run() state
 		ulrs->AsynchronousBreak();
 		pthread_join(thread, NULL);	// wait until the thread is complete
-		pthread_mutex_destroy(&mutex);
 		delete ulrs;
 		thread = 0;
 	}
@@ -788,26 +635,52 @@ void OSCSender::stop(void)
 	}
 }
 
+/// Joint data copied by the sender while the scene is locked.
+struct OSCJointMessage
+{
+	char name[16];	///< name of the joint
+	float x;		///< x-coordinate
+	float y;		///< y-coordinate
+};
+
 void OSCSender::threadTask(void)
 {
+	vector<OSCJointMessage> messages;
+
 	while (threadRunning && (ui != NULL))
 	{
-		vector<Joint *> *oscJoints = ui->editorBox->getOSCJoints();
+		// joints can be deleted and the vector recreated by the editor,
+		// copy the data under the scene lock and send it after
+		messages.clear();
+		ui->editorBox->lock();
+		vector<Handle> *oscJoints = ui->editorBox->getOSCJoints();
 		if (oscJoints != NULL)
 		{
-			vector<Joint *>::iterator ji = oscJoints->begin();
-			for (; ji < oscJoints->end(); ji++)
+			vector<Handle>::iterator hi = oscJoints->begin();
+			for (; hi < oscJoints->end(); hi++)
 			{
-				Joint *j = *ji;
-				ops->Clear();
-				(*ops) << osc::BeginBundleImmediate <<
-					osc::BeginMessage("/joint") <<
-					j->getName() <<
-					j->x << j->y << osc::EndMessage <<
-					osc::EndBundle;
-				socket->Send(ops->Data(), ops->Size());
+				Joint *j = Joint::handles->get(*hi);
+				if (j == NULL) // deleted joint
+					continue;
+				OSCJointMessage m;
+				strcpy(m.name, j->getName());
+				m.x = j->x;
+				m.y = j->y;
+				messages.push_back(m);
 			}
 		}
+		ui->editorBox->unlock();
+
+		for (unsigned i = 0; i < messages.size(); i++)
+		{
+			ops->Clear();
+			(*ops) << osc::BeginBundleImmediate <<
+				osc::BeginMessage("/joint") <<
+				messages[i].name <<
+				messages[i].x << messages[i].y << osc::EndMessage <<
+				osc::EndBundle;
+			socket->Send(ops->Data(), ops->Size());
+		}
 
 		// send messages 25 times per second approximately
 		usleep(40000);
@@ -35,6 +35,8 @@
 #include "ip/IpEndpointName.h"
 
 #include "Layer.h"
+#include "PatternCache.h"
+#include "OSCCommandQueue.h"
 
 #define OSC_HOST "localhost"
 #define OSC_RECEIVE_PORT 7110
@@ -50,7 +52,7 @@ class OSCListener : public osc::OscPacketListener
 {
 	protected:
 
-		/// Processes OSC messages.
+		/// Queues OSC messages for the simulation thread.
 		virtual void ProcessMessage(const osc::ReceivedMessage& m,
 				const IpEndpointName& remoteEndpoint);
 	private:
@@ -67,7 +69,20 @@ class OSCListener : public osc::OscPacketListener
 
 		Layer *rootLayer;	///< root of the layers
 
-		int patternMatch(const char *str, const char *p);
+		/* elements matched by the patterns of the recent messages */
+		PatternCache<Bone> *bonePatterns;	///< bones by pattern
+		PatternCache<Joint> *jointPatterns;	///< joints by pattern
+		PatternCache<Layer> *layerPatterns;	///< layers by pattern
+
+		/* elements found by exact name, reused by the commands */
+		vector<Bone *> *namedBones;		///< bones found by name
+		vector<Joint *> *namedJoints;	///< joints found by name
+		vector<Layer *> *namedLayers;	///< layers found by name
+
+		OSCCommandQueue *commands;	///< messages waiting for the next simulation step
+		unsigned reportedDrops;		///< number of dropped messages already reported
+
+		static int patternMatch(const char *str, const char *p);
 
 	public:
 
@@ -79,11 +94,13 @@ class OSCListener : public osc::OscPacketListener
 		/// Stops OSC listener.
 		void stop(void);
 
-		/// Protects access to a shared data resources.
+		/// Serializes the threads queueing OSC messages.
 		void lock(void);
 		/// Unlocks mutex, allowing access to shared data.
 		void unlock(void);
 
+		void applyCommands(void);
+
 		/// Sets root layers to be able to control the behaviour of layer data.
 		void setRootLayer(Layer *root);
 
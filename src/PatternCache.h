@@ -0,0 +1,121 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __PATTERNCACHE_H__
+#define __PATTERNCACHE_H__
+
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/** the cache is emptied when this many patterns are stored, so patterns
+ * sent only once do not pile up */
+#define PATTERNCACHE_MAX_PATTERNS 256
+
+namespace Animata
+{
+
+/**
+ * Remembers the elements matched by name patterns.
+ *
+ * The names are matched against a pattern only the first time the pattern
+ * is used, the matching elements are returned from the cache after that.
+ * The cache is emptied when the version of the names passed to find()
+ * changes, the editor changes it whenever an element is added, deleted or
+ * renamed, so the cached sets never hold deleted elements.
+ **/
+template <class T>
+class PatternCache
+{
+	public:
+		/// Function telling if a name matches a pattern.
+		typedef int (*MatchFunction)(const char *str, const char *pattern);
+
+		/**
+		 * Creates an empty cache.
+		 * \param match the function to match the names with
+		 **/
+		PatternCache(MatchFunction match)
+		{
+			this->match = match;
+			sets = new map<string, vector<T *> >;
+			version = 0;
+		}
+
+		~PatternCache()
+		{
+			delete sets;
+		}
+
+		/**
+		 * Returns the named elements matching a pattern.
+		 * \param pattern the pattern
+		 * \param elements all the elements, searched if the pattern is not
+		 *	in the cache
+		 * \param names version of the element names, the cache is emptied
+		 *	when it differs from the one of the last call
+		 * \return the matching elements, valid until the next call
+		 **/
+		vector<T *> *find(const char *pattern, vector<T *> *elements,
+				unsigned names)
+		{
+			if (names != version)
+			{
+				sets->clear();
+				version = names;
+			}
+
+			typename map<string, vector<T *> >::iterator i = sets->find(pattern);
+			if (i != sets->end())
+				return &i->second;
+
+			if (sets->size() >= PATTERNCACHE_MAX_PATTERNS)
+				sets->clear();
+
+			vector<T *> *matched = &(*sets)[pattern];
+			typename vector<T *>::iterator e = elements->begin();
+			for (; e < elements->end(); e++)
+			{
+				const char *name = (*e)->getName();
+				// skip unnamed elements
+				if (name[0] == 0)
+					continue;
+				if (match(name, pattern))
+					matched->push_back(*e);
+			}
+			return matched;
+		}
+
+	private:
+		MatchFunction match;			///< name matching function
+		map<string, vector<T *> > *sets;	///< matching elements by pattern
+		unsigned version;				///< version of the names the sets are valid for
+};
+
+} /* namespace Animata */
+
+#endif
+
@@ -0,0 +1,642 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+
+#include "PickIndex.h"
+#include "Selection.h"
+#include "Primitives.h"
+
+using namespace Animata;
+
+/**
+ * Creates an empty index, it is filled by update().
+ **/
+PickIndex::PickIndex()
+{
+	items = new vector<PickItem>;
+	cellStart = new vector<unsigned>;
+	cellItems = new vector<unsigned>;
+	candidates = new vector<unsigned>;
+
+	faceTree = new FaceTree();
+	faceItems = new vector<unsigned>;
+	faceHits = new vector<unsigned>;
+	gridFirst = 0;
+
+	originX = originY = 0;
+	cellSize = PICK_CELL_SIZE;
+	cols = rows = 0;
+	skipped = 0;
+
+	built = false;
+	builtFrame = 0;
+	builtRevision = 0;
+	builtVertices = builtFaces = builtJoints = builtBones = 0;
+
+	pthread_mutex_init(&mutex, NULL);
+}
+
+PickIndex::~PickIndex()
+{
+	pthread_mutex_destroy(&mutex);
+
+	delete items;
+	delete cellStart;
+	delete cellItems;
+	delete candidates;
+
+	delete faceTree;
+	delete faceItems;
+	delete faceHits;
+}
+
+/**
+ * Rebuilds the index if the view coordinates or the primitives of the layer
+ * have changed since the last update.
+ * \param mesh mesh of the layer
+ * \param skeleton skeleton of the layer
+ * \param frame frame number of the ViewTransform computing the view
+ *	coordinates
+ **/
+void PickIndex::update(Mesh *mesh, Skeleton *skeleton, unsigned frame)
+{
+	if (built && (frame == builtFrame) &&
+		(mesh->getRevision() == builtRevision) &&
+		(mesh->getVertices()->size() == builtVertices) &&
+		(mesh->getFaces()->size() == builtFaces) &&
+		(skeleton->getJoints()->size() == builtJoints) &&
+		(skeleton->getBones()->size() == builtBones))
+		return;
+
+	build(mesh, skeleton);
+
+	built = true;
+	builtFrame = frame;
+	builtRevision = mesh->getRevision();
+	builtVertices = mesh->getVertices()->size();
+	builtFaces = mesh->getFaces()->size();
+	builtJoints = skeleton->getJoints()->size();
+	builtBones = skeleton->getBones()->size();
+}
+
+/**
+ * Returns the number of points of a primitive, which depends on its type.
+ * \param item the primitive
+ * \return 1 for vertices and joints, 2 for bones, 3 for faces
+ **/
+int PickIndex::pointCount(PickItem *item)
+{
+	if (item->type == Selection::SELECT_BONE)
+		return 2;
+	else if (item->type == Selection::SELECT_TRIANGLE)
+		return 3;
+	return 1;
+}
+
+/**
+ * Adds a primitive, its bounding box is calculated from its points and
+ * size.
+ * \param item the primitive with its points, the number of points is given
+ *	by its type
+ * \return false if the primitive is too large to be indexed
+ **/
+bool PickIndex::addItem(PickItem *item)
+{
+	int n = pointCount(item);
+
+	item->x0 = item->x1 = item->x[0];
+	item->y0 = item->y1 = item->y[0];
+	for (int i = 1; i < n; i++)
+	{
+		item->x0 = min(item->x0, item->x[i]);
+		item->x1 = max(item->x1, item->x[i]);
+		item->y0 = min(item->y0, item->y[i]);
+		item->y1 = max(item->y1, item->y[i]);
+	}
+	item->x0 -= item->size;
+	item->y0 -= item->size;
+	item->x1 += item->size;
+	item->y1 += item->size;
+
+	// primitives projected to infinity cannot be picked
+	if (!(item->x1 - item->x0 < PICK_MAX_EXTENT) ||
+		!(item->y1 - item->y0 < PICK_MAX_EXTENT))
+	{
+		skipped++;
+		return false;
+	}
+
+	items->push_back(*item);
+	return true;
+}
+
+/**
+ * Collects the primitives of the layer and sorts them into the grid. The
+ * faces are put in the FaceTree instead, which is only refitted if the
+ * faces of the mesh are unchanged.
+ * \param mesh mesh of the layer
+ * \param skeleton skeleton of the layer
+ **/
+void PickIndex::build(Mesh *mesh, Skeleton *skeleton)
+{
+	vector<Vertex *> *vertices = mesh->getVertices();
+	vector<Face *> *faces = mesh->getFaces();
+	vector<Joint *> *joints = skeleton->getJoints();
+	vector<Bone *> *bones = skeleton->getBones();
+
+	unsigned lastSkipped = skipped;
+	skipped = 0;
+
+	items->clear();
+	items->reserve(vertices->size() + faces->size() + joints->size() +
+			bones->size());
+
+	PickItem item;
+
+	// the primitives are added in the order of drawing
+	item.type = Selection::SELECT_TRIANGLE;
+	item.size = 0.5f; // outline
+	faceItems->assign(faces->size(), ~0u);
+	for (unsigned i = 0; i < faces->size(); i++)
+	{
+		Face *face = (*faces)[i];
+		item.name = i;
+		for (int j = 0; j < 3; j++)
+		{
+			item.x[j] = face->v[j]->view.x;
+			item.y[j] = face->v[j]->view.y;
+		}
+		if (addItem(&item))
+			(*faceItems)[i] = items->size() - 1;
+	}
+	gridFirst = items->size();
+	faceTree->update(faces);
+
+	item.type = Selection::SELECT_VERTEX;
+	item.size = (Primitives::getVertexSize() + Primitives::getBorder()) / 2;
+	for (unsigned i = 0; i < vertices->size(); i++)
+	{
+		item.name = i;
+		item.x[0] = (*vertices)[i]->view.x;
+		item.y[0] = (*vertices)[i]->view.y;
+		addItem(&item);
+	}
+
+	// bones are drawn between the joint circles with their widest line
+	item.type = Selection::SELECT_BONE;
+	for (unsigned i = 0; i < bones->size(); i++)
+	{
+		Bone *bone = (*bones)[i];
+		float dx = bone->j1->vx - bone->j0->vx;
+		float dy = bone->j1->vy - bone->j0->vy;
+		float d = sqrt(dx * dx + dy * dy);
+		if (d == 0)
+			continue;
+		dx *= Primitives::getBoneSize() / d;
+		dy *= Primitives::getBoneSize() / d;
+
+		item.name = i;
+		item.x[0] = bone->j0->vx + dx;
+		item.y[0] = bone->j0->vy + dy;
+		item.x[1] = bone->j1->vx - dx;
+		item.y[1] = bone->j1->vy - dy;
+		item.size = max(Primitives::getBoneSize() + Primitives::getBorder(),
+				Primitives::getBoneSize() * bone->damp * 3) / 2;
+		addItem(&item);
+	}
+
+	item.type = Selection::SELECT_JOINT;
+	item.size = Primitives::getJointSize() + Primitives::getBorder();
+	for (unsigned i = 0; i < joints->size(); i++)
+	{
+		item.name = i;
+		item.x[0] = (*joints)[i]->vx;
+		item.y[0] = (*joints)[i]->vy;
+		addItem(&item);
+	}
+
+	// the primitives which cannot be picked are reported as an error, not
+	// silently dropped
+	if (skipped && (skipped != lastSkipped))
+	{
+		fprintf(stderr, "pick index: %u of %u primitives are projected too far to "
+				"be picked\n", skipped, skipped + (unsigned)items->size());
+	}
+
+	cellStart->clear();
+	cellItems->clear();
+	cols = rows = 0;
+	if (gridFirst == items->size())
+		return;
+
+	float x0 = (*items)[gridFirst].x0;
+	float y0 = (*items)[gridFirst].y0;
+	float x1 = (*items)[gridFirst].x1;
+	float y1 = (*items)[gridFirst].y1;
+	for (unsigned i = gridFirst + 1; i < items->size(); i++)
+	{
+		PickItem *p = &(*items)[i];
+		x0 = min(x0, p->x0);
+		y0 = min(y0, p->y0);
+		x1 = max(x1, p->x1);
+		y1 = max(y1, p->y1);
+	}
+
+	// the cells are enlarged if the primitives are scattered far apart
+	cellSize = PICK_CELL_SIZE;
+	while (((x1 - x0) / cellSize + 1) * ((y1 - y0) / cellSize + 1) >
+			PICK_MAX_CELLS)
+		cellSize *= 2;
+
+	originX = x0;
+	originY = y0;
+	cols = (int)((x1 - x0) / cellSize) + 1;
+	rows = (int)((y1 - y0) / cellSize) + 1;
+
+	// the items of the cells are stored continuously, the cells are
+	// counted first, then filled
+	int cellCount = cols * rows;
+	cellStart->assign(cellCount + 1, 0);
+	for (unsigned i = gridFirst; i < items->size(); i++)
+	{
+		PickItem *p = &(*items)[i];
+		int cx0 = (int)((p->x0 - originX) / cellSize);
+		int cy0 = (int)((p->y0 - originY) / cellSize);
+		int cx1 = (int)((p->x1 - originX) / cellSize);
+		int cy1 = (int)((p->y1 - originY) / cellSize);
+		for (int cy = cy0; cy <= cy1; cy++)
+			for (int cx = cx0; cx <= cx1; cx++)
+				(*cellStart)[cy * cols + cx + 1]++;
+	}
+	for (int c = 0; c < cellCount; c++)
+		(*cellStart)[c + 1] += (*cellStart)[c];
+	cellItems->resize((*cellStart)[cellCount]);
+
+	// the candidates are used as the fill position of the cells
+	candidates->assign(cellStart->begin(), cellStart->end() - 1);
+	for (unsigned i = gridFirst; i < items->size(); i++)
+	{
+		PickItem *p = &(*items)[i];
+		int cx0 = (int)((p->x0 - originX) / cellSize);
+		int cy0 = (int)((p->y0 - originY) / cellSize);
+		int cx1 = (int)((p->x1 - originX) / cellSize);
+		int cy1 = (int)((p->y1 - originY) / cellSize);
+		for (int cy = cy0; cy <= cy1; cy++)
+			for (int cx = cx0; cx <= cx1; cx++)
+				(*cellItems)[(*candidates)[cy * cols + cx]++] = i;
+	}
+}
+
+/**
+ * Tests whether a segment crosses a rectangle by clipping it.
+ * \return true if a part of the segment is inside the rectangle
+ **/
+static bool segmentInRect(float x0, float y0, float x1, float y1,
+		float cx, float cy, float rx, float ry)
+{
+	float t0 = 0;
+	float t1 = 1;
+	float d[2] = { x1 - x0, y1 - y0 };
+	float p[2] = { x0 - cx, y0 - cy };
+	float r[2] = { rx, ry };
+
+	for (int i = 0; i < 2; i++)
+	{
+		if (d[i] == 0)
+		{
+			if (fabs(p[i]) > r[i])
+				return false;
+			continue;
+		}
+		float ta = (-r[i] - p[i]) / d[i];
+		float tb = (r[i] - p[i]) / d[i];
+		t0 = max(t0, min(ta, tb));
+		t1 = min(t1, max(ta, tb));
+		if (t0 > t1)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Tests whether a primitive is drawn in a rectangle.
+ * \param item the primitive
+ * \param x \e x view coordinate of the rectangle centre
+ * \param y \e y view coordinate of the rectangle centre
+ * \param rx half width of the rectangle
+ * \param ry half height of the rectangle
+ * \return true if the primitive is in the rectangle
+ **/
+bool PickIndex::hit(PickItem *item, float x, float y, float rx, float ry)
+{
+	switch (item->type)
+	{
+		case Selection::SELECT_VERTEX:
+			// the rectangle of the vertex overlaps the rectangle
+			return (fabs(item->x[0] - x) <= item->size + rx) &&
+				(fabs(item->y[0] - y) <= item->size + ry);
+
+		case Selection::SELECT_JOINT:
+		{
+			// the circle of the joint overlaps the rectangle
+			float dx = max(fabs(item->x[0] - x) - rx, 0.0f);
+			float dy = max(fabs(item->y[0] - y) - ry, 0.0f);
+			return dx * dx + dy * dy <= item->size * item->size;
+		}
+
+		case Selection::SELECT_BONE:
+			// the wide line crosses the rectangle
+			return segmentInRect(item->x[0], item->y[0], item->x[1], item->y[1],
+					x, y, rx + item->size, ry + item->size);
+
+		case Selection::SELECT_TRIANGLE:
+		{
+			// the centre is inside the triangle of either winding
+			float *px = item->x;
+			float *py = item->y;
+			float c0 = (px[1] - px[0]) * (y - py[0]) - (py[1] - py[0]) * (x - px[0]);
+			float c1 = (px[2] - px[1]) * (y - py[1]) - (py[2] - py[1]) * (x - px[1]);
+			float c2 = (px[0] - px[2]) * (y - py[2]) - (py[0] - py[2]) * (x - px[2]);
+			if (((c0 >= 0) && (c1 >= 0) && (c2 >= 0)) ||
+				((c0 <= 0) && (c1 <= 0) && (c2 <= 0)))
+				return true;
+
+			// or its outline crosses the rectangle
+			for (int i = 0; i < 3; i++)
+			{
+				int j = (i + 1) % 3;
+				if (segmentInRect(px[i], py[i], px[j], py[j], x, y,
+							rx + item->size, ry + item->size))
+					return true;
+			}
+			return false;
+		}
+
+		default:
+			return false;
+	}
+}
+
+/**
+ * Collects the primitives of the given types whose bounding box overlaps a
+ * rectangle into \a candidates, in drawing order. The faces are searched
+ * in the FaceTree, the others in the cells of the grid.
+ * \param x0 left edge of the rectangle
+ * \param y0 bottom edge of the rectangle
+ * \param x1 right edge of the rectangle
+ * \param y1 top edge of the rectangle
+ * \param types bitmask of the searched primitive types, (1 << type)
+ **/
+void PickIndex::gather(float x0, float y0, float x1, float y1, unsigned types)
+{
+	candidates->clear();
+
+	if (types & (1 << Selection::SELECT_TRIANGLE))
+	{
+		// the tree holds the triangles, their outline is added to the
+		// rectangle
+		faceTree->query(x0 - 1, y0 - 1, x1 + 1, y1 + 1, faceHits);
+		for (unsigned i = 0; i < faceHits->size(); i++)
+		{
+			unsigned n = (*faceItems)[(*faceHits)[i]];
+			if (n == ~0u)
+				continue;
+			PickItem *p = &(*items)[n];
+			if ((p->x0 <= x1) && (p->x1 >= x0) &&
+				(p->y0 <= y1) && (p->y1 >= y0))
+				candidates->push_back(n);
+		}
+	}
+
+	if (cols == 0)
+		return;
+
+	int cx0 = max((int)floor((x0 - originX) / cellSize), 0);
+	int cy0 = max((int)floor((y0 - originY) / cellSize), 0);
+	int cx1 = min((int)floor((x1 - originX) / cellSize), cols - 1);
+	int cy1 = min((int)floor((y1 - originY) / cellSize), rows - 1);
+
+	for (int cy = cy0; cy <= cy1; cy++)
+	{
+		for (int cx = cx0; cx <= cx1; cx++)
+		{
+			unsigned c = cy * cols + cx;
+			for (unsigned i = (*cellStart)[c]; i < (*cellStart)[c + 1]; i++)
+			{
+				unsigned n = (*cellItems)[i];
+				PickItem *p = &(*items)[n];
+				if ((types & (1 << p->type)) &&
+					(p->x0 <= x1) && (p->x1 >= x0) &&
+					(p->y0 <= y1) && (p->y1 >= y0))
+					candidates->push_back(n);
+			}
+		}
+	}
+
+	// the items are stored in drawing order, large ones are found in more
+	// cells
+	sort(candidates->begin(), candidates->end());
+	candidates->erase(unique(candidates->begin(), candidates->end()),
+			candidates->end());
+}
+
+/**
+ * Finds the primitives drawn in the square around a point.
+ * \param x \e x view coordinate of the square centre
+ * \param y \e y view coordinate of the square centre
+ * \param r half size of the square
+ * \param types bitmask of the searched primitive types, (1 << type)
+ * \param hits the picked primitives are returned here in drawing order
+ **/
+void PickIndex::pick(float x, float y, float r, unsigned types,
+		vector<SelectItem> *hits)
+{
+	hits->clear();
+	gather(x - r, y - r, x + r, y + r, types);
+
+	for (unsigned i = 0; i < candidates->size(); i++)
+	{
+		PickItem *p = &(*items)[(*candidates)[i]];
+		if (hit(p, x, y, r, r))
+		{
+			SelectItem s;
+			s.type = p->type;
+			s.name = p->name;
+			hits->push_back(s);
+		}
+	}
+}
+
+/**
+ * Finds the primitives drawn in a rectangle. The corners can be given in
+ * any order.
+ * \param x0 \e x view coordinate of a corner
+ * \param y0 \e y view coordinate of a corner
+ * \param x1 \e x view coordinate of the opposite corner
+ * \param y1 \e y view coordinate of the opposite corner
+ * \param types bitmask of the searched primitive types, (1 << type)
+ * \param hits the found primitives are returned here in drawing order
+ **/
+void PickIndex::rectQuery(float x0, float y0, float x1, float y1,
+		unsigned types, vector<SelectItem> *hits)
+{
+	float cx = (x0 + x1) / 2;
+	float cy = (y0 + y1) / 2;
+	float rx = fabs(x1 - x0) / 2;
+	float ry = fabs(y1 - y0) / 2;
+
+	hits->clear();
+	gather(cx - rx, cy - ry, cx + rx, cy + ry, types);
+
+	for (unsigned i = 0; i < candidates->size(); i++)
+	{
+		PickItem *p = &(*items)[(*candidates)[i]];
+		if (hit(p, cx, cy, rx, ry))
+		{
+			SelectItem s;
+			s.type = p->type;
+			s.name = p->name;
+			hits->push_back(s);
+		}
+	}
+}
+
+/**
+ * Finds the primitives inside a circle.
+ * \param x \e x view coordinate of the centre
+ * \param y \e y view coordinate of the centre
+ * \param r radius of the circle
+ * \param types bitmask of the searched primitive types, (1 << type)
+ * \param hits the found primitives are returned here in drawing order
+ **/
+void PickIndex::circleQuery(float x, float y, float r, unsigned types,
+		vector<SelectItem> *hits)
+{
+	hits->clear();
+	gather(x - r, y - r, x + r, y + r, types);
+
+	for (unsigned i = 0; i < candidates->size(); i++)
+	{
+		PickItem *p = &(*items)[(*candidates)[i]];
+
+		bool inside = true;
+		for (int j = 0; inside && (j < pointCount(p)); j++)
+		{
+			float dx = p->x[j] - x;
+			float dy = p->y[j] - y;
+			inside = dx * dx + dy * dy <= r * r;
+		}
+
+		if (inside)
+		{
+			SelectItem s;
+			s.type = p->type;
+			s.name = p->name;
+			hits->push_back(s);
+		}
+	}
+}
+
+/// Returns true if a point is inside a polygon by the even-odd rule.
+static bool insidePolygon(vector<Vector2D> *polygon, float x, float y)
+{
+	bool inside = false;
+	unsigned n = polygon->size();
+	for (unsigned i = 0, j = n - 1; i < n; j = i++)
+	{
+		Vector2D *a = &(*polygon)[i];
+		Vector2D *b = &(*polygon)[j];
+		if (((a->y > y) != (b->y > y)) &&
+			(x < (b->x - a->x) * (y - a->y) / (b->y - a->y) + a->x))
+			inside = !inside;
+	}
+	return inside;
+}
+
+/**
+ * Finds the primitives inside a polygon, like the area drawn by a lasso.
+ * \param polygon the points of the polygon in view coordinates, the last
+ *	point is connected to the first one
+ * \param types bitmask of the searched primitive types, (1 << type)
+ * \param hits the found primitives are returned here in drawing order
+ **/
+void PickIndex::lassoQuery(vector<Vector2D> *polygon, unsigned types,
+		vector<SelectItem> *hits)
+{
+	hits->clear();
+	if (polygon->size() < 3)
+		return;
+
+	float x0 = (*polygon)[0].x;
+	float y0 = (*polygon)[0].y;
+	float x1 = x0;
+	float y1 = y0;
+	for (unsigned i = 1; i < polygon->size(); i++)
+	{
+		x0 = min(x0, (*polygon)[i].x);
+		y0 = min(y0, (*polygon)[i].y);
+		x1 = max(x1, (*polygon)[i].x);
+		y1 = max(y1, (*polygon)[i].y);
+	}
+
+	gather(x0, y0, x1, y1, types);
+
+	for (unsigned i = 0; i < candidates->size(); i++)
+	{
+		PickItem *p = &(*items)[(*candidates)[i]];
+
+		bool inside = true;
+		for (int j = 0; inside && (j < pointCount(p)); j++)
+			inside = insidePolygon(polygon, p->x[j], p->y[j]);
+
+		if (inside)
+		{
+			SelectItem s;
+			s.type = p->type;
+			s.name = p->name;
+			hits->push_back(s);
+		}
+	}
+}
+
+/**
+ * Finds the face edge nearest to a point.
+ * \param x \e x view coordinate of the point
+ * \param y \e y view coordinate of the point
+ * \param r maximum distance of the edge from the point
+ * \param face the index of the face of the edge is returned here
+ * \param edge the edge is returned here, edge \a i connects face vertices
+ *	\a i and \a i + 1
+ * \return true if an edge was found
+ * \sa FaceTree::nearestEdge()
+ **/
+bool PickIndex::nearestEdge(float x, float y, float r, unsigned *face,
+		int *edge)
+{
+	return faceTree->nearestEdge(x, y, r, face, edge);
+}
+
@@ -0,0 +1,148 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __PICKINDEX_H__
+#define __PICKINDEX_H__
+
+#include <vector>
+#include <pthread.h>
+
+#include "Vector2D.h"
+#include "Mesh.h"
+#include "Skeleton.h"
+#include "FaceTree.h"
+
+/// default size of the grid cells in view coordinates
+#define PICK_CELL_SIZE 32
+/// the cells are made larger if the grid would have more of them
+#define PICK_MAX_CELLS 16384
+/// primitives larger than this in view coordinates are not indexed
+#define PICK_MAX_EXTENT 1e9f
+
+using namespace std;
+
+namespace Animata
+{
+
+struct SelectItem;
+
+/**
+ * Primitive of a layer in view coordinates, with the area where it can be
+ * picked.
+ **/
+struct PickItem
+{
+	unsigned type;			///< type of the primitive, Selection::SELECT_VERTEX...
+	unsigned name;			///< index of the primitive in its vector
+	float x[3];				///< x coordinates of the points of the primitive
+	float y[3];				///< y coordinates of the points of the primitive
+	float size;				///< half size of the vertex rectangle, joint radius or half bone width
+	float x0, y0, x1, y1;	///< bounding box of the pickable area
+};
+
+/**
+ * Uniform grid over the view coordinates of the vertices, joints and bones
+ * of a layer, and a FaceTree over its faces, answering which primitives
+ * are below the cursor without drawing them.
+ *
+ * The pickable area of each primitive matches its size drawn by Primitives
+ * in the editor. The primitives are stored in the order the layer draws
+ * them, faces, vertices, bones, then joints, each by their index, and
+ * pick() returns them in this order, so the priority rules of Mesh::draw()
+ * and Skeleton::draw() work unchanged.
+ *
+ * The range queries used for multiple selection return the primitives in
+ * the same order. The rectangle query finds the primitives drawn in the
+ * rectangle, like picking does. The circle and lasso queries find the
+ * vertices and joints with their centre inside the area, the bones and
+ * faces with all their points inside.
+ *
+ * The caller has to hold lock() while updating and querying the index.
+ **/
+class PickIndex
+{
+	public:
+		PickIndex();
+		~PickIndex();
+
+		void update(Mesh *mesh, Skeleton *skeleton, unsigned frame);
+		void pick(float x, float y, float r, unsigned types,
+				vector<SelectItem> *hits);
+
+		void rectQuery(float x0, float y0, float x1, float y1, unsigned types,
+				vector<SelectItem> *hits);
+		void circleQuery(float x, float y, float r, unsigned types,
+				vector<SelectItem> *hits);
+		void lassoQuery(vector<Vector2D> *polygon, unsigned types,
+				vector<SelectItem> *hits);
+
+		bool nearestEdge(float x, float y, float r, unsigned *face, int *edge);
+
+		/// Locks the index while it is updated and queried.
+		inline void lock(void) { pthread_mutex_lock(&mutex); }
+		/// Unlocks the index.
+		inline void unlock(void) { pthread_mutex_unlock(&mutex); }
+
+		/// Returns the number of indexed primitives.
+		inline unsigned getItemCount(void) { return items->size(); }
+		/// Returns the number of primitives left out of the index.
+		inline unsigned getSkippedCount(void) { return skipped; }
+
+	private:
+		void build(Mesh *mesh, Skeleton *skeleton);
+		bool addItem(PickItem *item);
+		bool hit(PickItem *item, float x, float y, float rx, float ry);
+		void gather(float x0, float y0, float x1, float y1, unsigned types);
+		static int pointCount(PickItem *item);
+
+		vector<PickItem> *items;	///< the primitives in drawing order
+		vector<unsigned> *cellStart;	///< first entry of each cell in \a cellItems, one more than the cells
+		vector<unsigned> *cellItems;	///< indices of the items overlapping the cells
+		vector<unsigned> *candidates;	///< items found in the cells during a query
+
+		FaceTree *faceTree;			///< the faces of the mesh
+		vector<unsigned> *faceItems;	///< item of each face, ~0 if it is not indexed
+		vector<unsigned> *faceHits;	///< faces found in the tree during a query
+		unsigned gridFirst;			///< first item in the grid, the faces before it are in the tree
+
+		float originX, originY;		///< view coordinates of the grid corner
+		float cellSize;				///< size of a cell
+		int cols, rows;				///< number of cells
+		unsigned skipped;			///< primitives projected too far to be indexed
+
+		bool built;					///< false until the first update()
+		unsigned builtFrame;		///< frame of the view coordinates indexed
+		unsigned builtRevision;		///< mesh revision indexed
+		unsigned builtVertices;		///< number of vertices indexed
+		unsigned builtFaces;		///< number of faces indexed
+		unsigned builtJoints;		///< number of joints indexed
+		unsigned builtBones;		///< number of bones indexed
+
+		pthread_mutex_t mutex;		///< held while the index is used
+};
+
+} /* namespace Animata */
+
+#endif
+
@@ -38,6 +38,8 @@ Playback::Playback(int x, int y, int w, int h, const char* l) :
 	Fl_Gl_Window(x, y, w, h, l)
 {
 	camera = new Camera();
+	renderQueue = new RenderQueue("playback");
+	glyphBatch = new GlyphBatch();
 	// rootLayer = NULL;
 	allLayers = NULL;
 
@@ -45,6 +47,9 @@ Playback::Playback(int x, int y, int w, int h, const char* l) :
 	this->resizable(this);
 
 	glContext = NULL;
+	frameOutput = NULL;
+
+	scheduler = new FrameScheduler();
 }
 
 /**
@@ -52,7 +57,10 @@ Playback::Playback(int x, int y, int w, int h, const char* l) :
  */
 Playback::~Playback()
 {
+	delete renderQueue;
+	delete glyphBatch;
 	delete camera;
+	delete scheduler;
 }
 
 /**
@@ -64,6 +72,10 @@ void Playback::draw()
 	if (!valid())
 	{
 		AnimataWindow::setupOpenGL();
+		// the projected output is timed, so only this window swaps on the
+		// refresh, otherwise the two windows would wait for two refreshes
+		// per frame
+		scheduler->setVSync(FrameScheduler::enableVSync());
 
 		camera->setSize(w(), h());
 	}
@@ -85,12 +97,62 @@ void Playback::draw()
 	*/
 	if (allLayers)
 	{
+		// the view coordinates of the editor camera are reused, mapped onto
+		// the viewport of this window by the projection of its own camera
+		ViewTransform *view = ui->editorBox->getViewTransform();
+		view->setOutput(camera);
+
+		// textures are batched, so the wireframe is drawn in a second pass
+		// above all of them
+		// the impostors of the editor are not used, they have the
+		// resolution of the editor picture
+		renderQueue->begin();
 		vector<Layer *>::iterator l = allLayers->begin();
 		for (; l < allLayers->end(); l++)
 		{
-			(*l)->drawWithoutRecursion(RENDER_FEEDBACK | RENDER_OUTPUT | RENDER_TEXTURE | RENDER_WIREFRAME);
+			(*l)->drawWithoutRecursion(RENDER_OUTPUT | RENDER_TEXTURE);
+		}
+		renderQueue->flush(view);
+
+		glyphBatch->begin();
+		l = allLayers->begin();
+		for (; l < allLayers->end(); l++)
+		{
+			(*l)->drawWithoutRecursion(RENDER_OUTPUT | RENDER_WIREFRAME);
 		}
+		glyphBatch->end();
+
+		view->setOutput(NULL);
 	}
+
+	if (frameOutput)
+		publishFrame();
+}
+
+/**
+ * Swaps the buffers of a drawn frame and measures the frame time.
+ */
+void Playback::flush()
+{
+	Fl_Gl_Window::flush();
+	scheduler->presented();
+}
+
+/**
+ * Reads back the picture of the window straight into the next slot of the
+ * shared frame output. The slots grow if the window is larger than them.
+ */
+void Playback::publishFrame()
+{
+	unsigned char *pixels = frameOutput->beginFrame(w(), h());
+	if (pixels == NULL)
+		return;
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadBuffer(GL_BACK);
+	glReadPixels(0, 0, w(), h(), GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+	frameOutput->endFrame();
 }
 
 /**
@@ -107,11 +169,14 @@ int Playback::handle(int event)
 		case FL_KEYUP:
 			if(Fl::event_key() == 32)
 			{
+				// the window is recreated through our own hide() and show(),
+				// so the OpenGL visual is chosen again and the context with
+				// all the uploaded textures is kept
 				if(fullscreen)
 				{
-                    Fl_Window::hide();
+					hide();
 					Fl_Window::fullscreen_off(ox, oy, ow, oh);
-                    Fl_Window::show();
+					show();
 				}
 				else
 				{
@@ -119,9 +184,9 @@ int Playback::handle(int event)
 					oy = this->y();
 					ow = this->w();
 					oh = this->h();
-                    Fl_Window::hide();
+					hide();
 					Fl_Window::fullscreen();
-					Fl_Window::show();
+					show();
 				}
 
 				fullscreen = !fullscreen;
@@ -144,13 +209,16 @@ int Playback::handle(int event)
 
 /**
  * Overrides Fl_Gl_Window::show() so it wont create a new opengl context every time.
- * \todo This function is not implemented.
+ * The context of the window is created once and kept until the window is
+ * destroyed. FLTK shares the textures and other resources of every context
+ * with the first one created, so the editor's context is made sure to exist
+ * before ours, then the textures uploaded by the TextureManager are used by
+ * both windows without uploading them again.
  */
 void Playback::show()
 {
-	// context should be recreated, because on win the old one wont be used
-	// TODO: reuse the main window's context
-	context(NULL);
+	if ((context() == NULL) && ui->editorBox->shown())
+		ui->editorBox->make_current();
 
 	Fl_Gl_Window::show();
 }
@@ -158,6 +226,8 @@ void Playback::show()
 /**
  * Overrides Fl_Gl_Window::hide() so the opengl context wont be destroyed.
  * If the context is destroyed, the editor context also stops on Mac OSX.
+ * The context stays set on the window, and FLTK makes it current with the
+ * new window when it is shown again.
  */
 void Playback::hide()
 {
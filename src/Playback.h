@@ -35,7 +35,10 @@
 #include <FL/Fl.H>
 #include <FL/Fl_Gl_Window.H>
 #include "Camera.h"
+#include "FrameScheduler.h"
 #include "Layer.h"
+#include "RenderQueue.h"
+#include "SharedFrameOutput.h"
 #include "animata.h"
 
 using namespace std;
@@ -51,6 +54,8 @@ class Playback : public Fl_Gl_Window
 	private:
 
 		Camera		*camera;				///< Camera which displays the playback window's picture. It's \a parent is set to AnimataWindow::camera.
+		RenderQueue	*renderQueue;			///< Batches the textured layers by texture.
+		GlyphBatch	*glyphBatch;			///< Batches the wireframe glyphs of a layer.
 		/*
 		Layer		*rootLayer;				///< The root of all layers, same as AnimataWindow::rootLayer.
 		*/
@@ -61,6 +66,12 @@ class Playback : public Fl_Gl_Window
 
 		void		*glContext;				///< OpenGL context of this window
 
+		SharedFrameOutput *frameOutput;		///< the frames are published here too if not NULL
+
+		FrameScheduler *scheduler;			///< paces the frames to the refresh of this window
+
+		void		publishFrame();
+
 	public:
 
 //		static const unsigned RENDER_PLAYBACK = RENDER_LAST;	///< Constant for drawing functions to render only the playback picture.
@@ -69,6 +80,7 @@ class Playback : public Fl_Gl_Window
 		~Playback();
 
 		void draw();
+		void flush();
 		int handle(int);
 
 		void show();
@@ -80,6 +92,13 @@ class Playback : public Fl_Gl_Window
 		 */
 		inline Camera *getCamera() { return camera; }
 
+		/**
+		 * Returns the scheduler pacing the frames of the windows and the
+		 * simulation.
+		 * \retval	FrameScheduler*	A pointer to the scheduler.
+		 */
+		inline FrameScheduler *getFrameScheduler() { return scheduler; }
+
 		/**
 		 * Sets the \a rootLayer to the given one.
 		 * \param	r	The new rootLayer.
@@ -88,6 +107,12 @@ class Playback : public Fl_Gl_Window
 		inline void setRootLayer(Layer *r) { rootLayer = r; }
 		*/
 		inline void setAllLayers(std::vector<Layer *> *l) { allLayers = l; }
+
+		/**
+		 * Publishes the rendered frames in shared memory besides the window.
+		 * \param	o	The frame output or NULL to stop publishing.
+		 */
+		inline void setFrameOutput(SharedFrameOutput *o) { frameOutput = o; }
 };
 
 } /* namespace Animata */
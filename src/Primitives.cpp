@@ -24,6 +24,7 @@
 #include <math.h>
 #include "animata.h"
 #include "Primitives.h"
+#include "GlyphBatch.h"
 #include "Bone.h"
 #include "Joint.h"
 
@@ -309,6 +310,20 @@ void Primitives::drawRect(float x, float y, float size)
 	float y1=y - size/2;
 	float x2=x + size/2;
 	float y2=y + size/2;
+
+	GlyphBatch *batch = GlyphBatch::getCurrent();
+	if (batch)
+	{
+		float fillColor[4] = { fillColorR, fillColorG, fillColorB, fillColorA };
+		float strokeColor[4] = { strokeColorR, strokeColorG, strokeColorB, strokeColorA };
+
+		if (doFill)
+			batch->addRect(x1, y1, x2, y2, fillColor);
+		if (doStroke)
+			batch->addRectOutline(x1, y1, x2, y2, strokeW, strokeColor);
+		return;
+	}
+
 	if (doFill)
 	{
 		glColor4f(fillColorR, fillColorG, fillColorB, fillColorA);
@@ -325,6 +340,10 @@ void Primitives::drawRect(float x, float y, float size)
 
 void Primitives::drawSelectionBox(float x1, float y1, float x2, float y2)
 {
+	// stippled lines are not batched, draw the glyphs below them first
+	if (GlyphBatch::getCurrent())
+		GlyphBatch::getCurrent()->flush();
+
 	glLineWidth(1);
 	glLineStipple(1, 0xAAAA);
 	glEnable(GL_LINE_STIPPLE);
@@ -338,8 +357,34 @@ void Primitives::drawSelectionBox(float x1, float y1, float x2, float y2)
 	glDisable(GL_LINE_STIPPLE);
 }
 
+/**
+ * Draws the outline of the lasso selection.
+ * \param points points of the lasso in window coordinates, \e y from the top
+ * \param height height of the window
+ **/
+void Primitives::drawSelectionLasso(vector<Vector2D> *points, int height)
+{
+	// stippled lines are not batched, draw the glyphs below them first
+	if (GlyphBatch::getCurrent())
+		GlyphBatch::getCurrent()->flush();
+
+	glLineWidth(1);
+	glLineStipple(1, 0xAAAA);
+	glEnable(GL_LINE_STIPPLE);
+	glColor4f(1.f, 1.f, 1.f, 1.f);
+	glBegin(GL_LINE_LOOP);
+	for (unsigned i = 0; i < points->size(); i++)
+		glVertex2f((*points)[i].x, height - (*points)[i].y);
+	glEnd();
+	glDisable(GL_LINE_STIPPLE);
+}
+
 void Primitives::drawSelectionCircle(float x, float y, float r)
 {
+	// stippled lines are not batched, draw the glyphs below them first
+	if (GlyphBatch::getCurrent())
+		GlyphBatch::getCurrent()->flush();
+
 	glLineWidth(1.5);
 	glLineStipple(1, 0xAAAA);
 	glEnable(GL_LINE_STIPPLE);
@@ -359,7 +404,13 @@ void Primitives::drawSelectionCircle(float x, float y, float r)
 
 void Primitives::drawTriangle(float x1, float y1, float x2, float y2, float x3, float y3)
 {
-	if (doFill)
+	GlyphBatch *batch = GlyphBatch::getCurrent();
+	if (batch && doFill)
+	{
+		float fillColor[4] = { fillColorR, fillColorG, fillColorB, fillColorA };
+		batch->addTriangle(x1, y1, x2, y2, x3, y3, fillColor);
+	}
+	else if (doFill)
 	{
 		glColor4f(fillColorR, fillColorG, fillColorB, fillColorA);
 		glBegin(GL_TRIANGLES);
@@ -378,7 +429,13 @@ void Primitives::drawTriangle(float x1, float y1, float x2, float y2, float x3,
 
 void Primitives::drawLine(float x1, float y1, float x2, float y2)
 {
-	if (doStroke)
+	GlyphBatch *batch = GlyphBatch::getCurrent();
+	if (batch && doStroke)
+	{
+		float strokeColor[4] = { strokeColorR, strokeColorG, strokeColorB, strokeColorA };
+		batch->addLine(x1, y1, x2, y2, strokeW, strokeColor);
+	}
+	else if (doStroke)
 	{
 		glLineWidth(strokeW);
 		glColor4f(strokeColorR, strokeColorG, strokeColorB, strokeColorA);
@@ -391,33 +448,34 @@ void Primitives::drawLine(float x1, float y1, float x2, float y2)
 
 void Primitives::drawCircle(float x, float y, float r)
 {
-	const int num = 8;
-	static float ca[num+1], sa[num+1];
-	static bool trigInited = false;
-
-	if (!trigInited)
+	GlyphBatch *batch = GlyphBatch::getCurrent();
+	if (batch)
 	{
-		float inc = 2 * M_PI/num;
-		float angle = 0;
-		for (int i = 0; i <= num; i++)
-		{
-			ca[i] = cos(angle);
-			sa[i] = sin(angle);
-			angle += inc;
-		}
-		trigInited = true;
+		float fillColor[4] = { fillColorR, fillColorG, fillColorB, fillColorA };
+		float strokeColor[4] = { strokeColorR, strokeColorG, strokeColorB, strokeColorA };
+
+		if (doFill)
+			batch->addCircle(x, y, r, fillColor);
+		if (doStroke)
+			batch->addCircleOutline(x, y, r, strokeW, strokeColor);
+		return;
 	}
 
+	const int num = GLYPH_CIRCLE_SEGMENTS;
+	const float *ca = GlyphBatch::circleCos;
+	const float *sa = GlyphBatch::circleSin;
+
+	GlyphBatch::initCircleTable();
+
 	if (doFill)
 	{
 		glColor4f(fillColorR, fillColorG, fillColorB, fillColorA);
 		glBegin(GL_TRIANGLE_FAN);
 		glVertex2f(x, y);
-		for(int i = 0; i < num; i++)
+		for(int i = 0; i <= num; i++)
 		{
 			glVertex2f(x + r*ca[i], y + r*sa[i]);
 		}
-		glVertex2f(x+r, y);
 		glEnd();
 	}
 	if (doStroke)
@@ -24,8 +24,11 @@
 #ifndef __PRIMITIVES_H__
 #define __PRIMITIVES_H__
 
+#include <vector>
+
 #include "Bone.h"
 #include "Joint.h"
+#include "Vector2D.h"
 
 #define fillColor(r, g, b, a) \
 { \
@@ -64,6 +67,7 @@ class Primitives
 
 		static void drawSelectionBox(float x1, float y1, float x2, float y2);
 		static void drawSelectionCircle(float x, float y, float r);
+		static void drawSelectionLasso(vector<Vector2D> *points, int height);
 
 		static void fill(bool b);
 		static void stroke(bool b);
@@ -74,6 +78,15 @@ class Primitives
 		static void drawRect(float x, float y, float size);
 		static void drawTriangle(float x1, float y1, float x2, float y2,float x3, float y3);
 
+		/// Returns the size of the bone glyphs.
+		static inline float getBoneSize(void) { return boneSize; }
+		/// Returns the radius of the joint glyphs.
+		static inline float getJointSize(void) { return jointSize; }
+		/// Returns the size of the vertex glyphs.
+		static inline float getVertexSize(void) { return vertexSize; }
+		/// Returns the width of the dark border around the glyphs.
+		static inline float getBorder(void) { return border; }
+
 	private:
 
 		static float fillColorR;
@@ -0,0 +1,299 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <stdio.h>
+#include <float.h>
+
+#include "RenderQueue.h"
+
+using namespace Animata;
+
+RenderQueue *RenderQueue::current = NULL;
+
+/**
+ * Creates a new render queue.
+ * \param name name of the queue printed in the statistics report
+ **/
+RenderQueue::RenderQueue(const char *name)
+{
+	this->name = name;
+
+	impostors = NULL;
+
+	batches = new vector<RenderBatch *>;
+	batchCount = 0;
+
+	meshCount = drawCount = bindCount = 0;
+	prevMeshCount = prevDrawCount = prevBindCount = -1;
+}
+
+RenderQueue::~RenderQueue()
+{
+	if (current == this)
+		current = NULL;
+
+	vector<RenderBatch *>::iterator b = batches->begin();
+	for (; b < batches->end(); b++)
+		delete *b;
+	delete batches;
+}
+
+/**
+ * Starts collecting meshes for a new frame. Mesh::draw() adds its textured
+ * triangles to the queue instead of drawing them until flush() is called.
+ * \param impostors cache of static mesh images, NULL if every mesh should be
+ *	drawn by its triangles
+ **/
+void RenderQueue::begin(ImpostorCache *impostors /* = NULL */)
+{
+	this->impostors = impostors;
+
+	for (unsigned i = 0; i < batchCount; i++)
+		(*batches)[i]->vertices.clear();
+	batchCount = 0;
+	meshCount = 0;
+
+	current = this;
+}
+
+/**
+ * Returns the batch the triangles of a mesh with the given texture and
+ * bounding box can be added to.
+ * The batches are searched backwards. A batch with the same texture is
+ * returned unless a batch drawn later overlaps the bounding box, otherwise a
+ * new batch is started.
+ * \param texture GL texture resource of the mesh
+ * \param minX, minY, maxX, maxY bounding box of the mesh in view coordinates
+ * \return the batch the mesh triangles should be added to
+ **/
+RenderBatch *RenderQueue::getBatch(GLuint texture, float minX, float minY,
+		float maxX, float maxY)
+{
+	RenderBatch *batch = NULL;
+
+	for (int i = batchCount - 1; i >= 0; i--)
+	{
+		RenderBatch *b = (*batches)[i];
+		if (b->texture == texture)
+		{
+			batch = b;
+			break;
+		}
+		// an overlapping batch has to stay above the mesh
+		if ((b->minX <= maxX) && (minX <= b->maxX) &&
+			(b->minY <= maxY) && (minY <= b->maxY))
+			break;
+	}
+
+	if (batch == NULL)
+	{
+		if (batchCount == batches->size())
+			batches->push_back(new RenderBatch);
+		batch = (*batches)[batchCount++];
+
+		batch->texture = texture;
+		batch->minX = batch->minY = FLT_MAX;
+		batch->maxX = batch->maxY = -FLT_MAX;
+	}
+
+	if (minX < batch->minX)
+		batch->minX = minX;
+	if (minY < batch->minY)
+		batch->minY = minY;
+	if (maxX > batch->maxX)
+		batch->maxX = maxX;
+	if (maxY > batch->maxY)
+		batch->maxY = maxY;
+
+	return batch;
+}
+
+/**
+ * Adds the textured triangles of a mesh to the queue.
+ * \param mesh the mesh with an attached texture and up to date view
+ *	coordinates
+ * \param alpha the texture alpha of the mesh
+ **/
+void RenderQueue::addMesh(Mesh *mesh, float alpha)
+{
+	vector<Face *> *faces = mesh->getFaces();
+	Texture *texture = mesh->getAttachedTexture();
+
+	if ((texture == NULL) || faces->empty())
+		return;
+
+	Impostor *impostor = impostors ? impostors->use(mesh) : NULL;
+	if (impostor)
+	{
+		addImpostor(impostor, alpha);
+		return;
+	}
+
+	float minX = FLT_MAX;
+	float minY = FLT_MAX;
+	float maxX = -FLT_MAX;
+	float maxY = -FLT_MAX;
+
+	vector<Vertex *> *vertices = mesh->getVertices();
+	for (unsigned i = 0; i < vertices->size(); i++)
+	{
+		Vector2D *view = &(*vertices)[i]->view;
+		if (view->x < minX)
+			minX = view->x;
+		if (view->y < minY)
+			minY = view->y;
+		if (view->x > maxX)
+			maxX = view->x;
+		if (view->y > maxY)
+			maxY = view->y;
+	}
+
+	RenderBatch *batch = getBatch(texture->getGlResource(),
+			minX, minY, maxX, maxY);
+
+	RenderVertex rv;
+	rv.r = rv.g = rv.b = 1.f;
+	rv.a = alpha;
+
+	for (unsigned i = 0; i < faces->size(); i++)
+	{
+		Face *face = (*faces)[i];
+		for (int j = 0; j < 3; j++)
+		{
+			rv.s = texture->mapS(face->v[j]->texCoord.x);
+			rv.t = texture->mapT(face->v[j]->texCoord.y);
+			rv.x = face->v[j]->view.x;
+			rv.y = face->v[j]->view.y;
+			batch->vertices.push_back(rv);
+		}
+	}
+
+	meshCount++;
+}
+
+/**
+ * Adds the cached image of a mesh to the queue as a quad.
+ * \param impostor the valid impostor of the mesh
+ * \param alpha the texture alpha of the mesh
+ **/
+void RenderQueue::addImpostor(Impostor *impostor, float alpha)
+{
+	RenderBatch *batch = getBatch(impostor->texture,
+			impostor->minX, impostor->minY, impostor->maxX, impostor->maxY);
+
+	RenderVertex corners[4];
+	for (int i = 0; i < 4; i++)
+	{
+		RenderVertex *rv = &corners[i];
+		bool right = (i == 1) || (i == 2);
+		bool top = (i >= 2);
+
+		rv->r = rv->g = rv->b = 1.f;
+		rv->a = alpha;
+		rv->s = right ? impostor->s : 0.f;
+		rv->t = top ? impostor->t : 0.f;
+		rv->x = right ? impostor->maxX : impostor->minX;
+		rv->y = top ? impostor->maxY : impostor->minY;
+	}
+
+	batch->vertices.push_back(corners[0]);
+	batch->vertices.push_back(corners[1]);
+	batch->vertices.push_back(corners[2]);
+	batch->vertices.push_back(corners[0]);
+	batch->vertices.push_back(corners[2]);
+	batch->vertices.push_back(corners[3]);
+
+	meshCount++;
+}
+
+/**
+ * Draws the collected batches and stops collecting. The counts of draw calls
+ * and texture binds are printed in debug builds when they differ from the
+ * previous frame.
+ * \param view the stage which computed the view coordinates of the meshes
+ **/
+void RenderQueue::flush(ViewTransform *view)
+{
+	current = NULL;
+
+	drawCount = 0;
+	bindCount = 0;
+
+	if (batchCount > 0)
+	{
+		view->setupOrtho();
+
+		glEnable(GL_TEXTURE_2D);
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glEnableClientState(GL_COLOR_ARRAY);
+
+		GLuint boundTexture = 0;
+		for (unsigned i = 0; i < batchCount; i++)
+		{
+			RenderBatch *batch = (*batches)[i];
+			RenderVertex *v = &batch->vertices[0];
+
+			if ((i == 0) || (batch->texture != boundTexture))
+			{
+				glBindTexture(GL_TEXTURE_2D, batch->texture);
+				boundTexture = batch->texture;
+				bindCount++;
+			}
+
+			glTexCoordPointer(2, GL_FLOAT, sizeof(RenderVertex), &v->s);
+			glColorPointer(4, GL_FLOAT, sizeof(RenderVertex), &v->r);
+			glVertexPointer(2, GL_FLOAT, sizeof(RenderVertex), &v->x);
+			glDrawArrays(GL_TRIANGLES, 0, batch->vertices.size());
+			drawCount++;
+		}
+
+		glDisableClientState(GL_COLOR_ARRAY);
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+		glDisableClientState(GL_VERTEX_ARRAY);
+		glDisable(GL_TEXTURE_2D);
+		glColor3f(1.f, 1.f, 1.f);
+
+		glMatrixMode(GL_MODELVIEW);
+		glPopMatrix();
+
+		glMatrixMode(GL_PROJECTION);
+		glPopMatrix();
+
+		glMatrixMode(GL_MODELVIEW);
+	}
+
+#ifdef DEBUG
+	if ((meshCount != prevMeshCount) || (drawCount != prevDrawCount) ||
+		(bindCount != prevBindCount))
+	{
+		printf("%s: %d textured meshes in %d draw calls, %d texture binds\n",
+				name, meshCount, drawCount, bindCount);
+		prevMeshCount = meshCount;
+		prevDrawCount = drawCount;
+		prevBindCount = bindCount;
+	}
+#endif
+}
+
@@ -0,0 +1,121 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __RENDERQUEUE_H__
+#define __RENDERQUEUE_H__
+
+#if defined(__APPLE__)
+	#include <OPENGL/gl.h>
+#else
+	#include <GL/gl.h>
+#endif
+
+#include <vector>
+
+#include "Mesh.h"
+#include "ViewTransform.h"
+#include "ImpostorCache.h"
+
+using namespace std;
+
+namespace Animata
+{
+
+/// Interleaved vertex of a render batch.
+struct RenderVertex
+{
+	float s, t;			///< texture coordinates
+	float r, g, b, a;	///< colour, the alpha holds the layer alpha
+	float x, y;			///< view coordinates
+};
+
+/// Textured triangles sharing the same texture, drawn with one call.
+struct RenderBatch
+{
+	GLuint texture;					///< GL texture resource of the batch
+	vector<RenderVertex> vertices;	///< triangle vertices
+
+	float minX, minY, maxX, maxY;	///< bounding box in view coordinates
+};
+
+/**
+ * Collects the textured triangles of the visible layers and draws them
+ * sorted by texture.
+ *
+ * Meshes are added back to front. A mesh is merged into an earlier batch of
+ * the same texture, if it does not overlap any batch drawn after that one,
+ * so the depth order of overlapping layers is kept. All meshes use the same
+ * alpha blending, so the texture is the only batch key. Meshes with a cached
+ * impostor are added as a single textured quad.
+ **/
+class RenderQueue
+{
+	public:
+		RenderQueue(const char *name);
+		~RenderQueue();
+
+		void begin(ImpostorCache *impostors = NULL);
+		void addMesh(Mesh *mesh, float alpha);
+		void flush(ViewTransform *view);
+
+		/**
+		 * Returns the queue collecting meshes between begin() and flush().
+		 * \retval RenderQueue* The collecting queue or NULL.
+		 **/
+		static inline RenderQueue *getCurrent(void) { return current; }
+
+		/// Returns the number of draw calls of the last frame.
+		inline int getDrawCount(void) { return drawCount; }
+		/// Returns the number of texture binds of the last frame.
+		inline int getBindCount(void) { return bindCount; }
+		/// Returns the number of meshes queued in the last frame.
+		inline int getMeshCount(void) { return meshCount; }
+
+	private:
+		const char *name;				///< name used in the statistics report
+
+		ImpostorCache *impostors;		///< cached images of static meshes, can be NULL
+
+		vector<RenderBatch *> *batches;	///< batches, reused between frames
+		unsigned batchCount;			///< number of batches used in this frame
+
+		int meshCount;					///< meshes queued in this frame
+		int drawCount;					///< draw calls in the last frame
+		int bindCount;					///< texture binds in the last frame
+
+		int prevMeshCount;				///< reported mesh count
+		int prevDrawCount;				///< reported draw call count
+		int prevBindCount;				///< reported bind count
+
+		static RenderQueue *current;	///< the collecting queue
+
+		RenderBatch *getBatch(GLuint texture, float minX, float minY,
+				float maxX, float maxY);
+		void addImpostor(Impostor *impostor, float alpha);
+};
+
+} /* namespace Animata */
+
+#endif
+
@@ -0,0 +1,148 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "SceneSnapshot.h"
+
+using namespace Animata;
+
+/**
+ * Creates an empty snapshot.
+ **/
+SceneSnapshot::SceneSnapshot()
+{
+	states = new vector<LayerSnapshot *>;
+	stateCount = 0;
+
+	index = new map<Layer *, LayerSnapshot *>;
+
+	frame = 0;
+}
+
+SceneSnapshot::~SceneSnapshot()
+{
+	vector<LayerSnapshot *>::iterator s = states->begin();
+	for (; s < states->end(); s++)
+		delete *s;
+	delete states;
+	delete index;
+}
+
+/**
+ * Forgets every layer state. Has to be called when the layers are deleted.
+ **/
+void SceneSnapshot::clear(void)
+{
+	stateCount = 0;
+	index->clear();
+}
+
+/**
+ * Copies the transformation matrices and the vertex and joint positions of
+ * the layers. The scene has to be locked while capturing.
+ * \param layers all layers of the scene
+ * \param frame the simulation step of the capture
+ **/
+void SceneSnapshot::capture(vector<Layer *> *layers, unsigned frame)
+{
+	this->frame = frame;
+
+	clear();
+
+	vector<Layer *>::iterator l = layers->begin();
+	for (; l < layers->end(); l++)
+	{
+		Layer *layer = *l;
+
+		if (stateCount == states->size())
+			states->push_back(new LayerSnapshot);
+		LayerSnapshot *state = (*states)[stateCount++];
+
+		state->layer = layer;
+		state->transformation = *layer->getTransformationMatrix();
+
+		vector<Vertex *> *vertices = layer->getMesh()->getVertices();
+		state->vertexX.resize(vertices->size());
+		state->vertexY.resize(vertices->size());
+		for (unsigned i = 0; i < vertices->size(); i++)
+		{
+			state->vertexX[i] = (*vertices)[i]->coord.x;
+			state->vertexY[i] = (*vertices)[i]->coord.y;
+		}
+
+		vector<Joint *> *joints = layer->getSkeleton()->getJoints();
+		state->jointX.resize(joints->size());
+		state->jointY.resize(joints->size());
+		for (unsigned i = 0; i < joints->size(); i++)
+		{
+			state->jointX[i] = (*joints)[i]->x;
+			state->jointY[i] = (*joints)[i]->y;
+		}
+
+		(*index)[layer] = state;
+	}
+}
+
+/**
+ * Compares the captured state with another snapshot.
+ * \param s the snapshot to compare with
+ * \return true if any layer, matrix or position differs
+ **/
+bool SceneSnapshot::differs(SceneSnapshot *s)
+{
+	if (stateCount != s->stateCount)
+		return true;
+
+	for (unsigned i = 0; i < stateCount; i++)
+	{
+		LayerSnapshot *a = (*states)[i];
+		LayerSnapshot *b = (*s->states)[i];
+
+		if ((a->layer != b->layer) ||
+			(a->vertexX != b->vertexX) || (a->vertexY != b->vertexY) ||
+			(a->jointX != b->jointX) || (a->jointY != b->jointY))
+			return true;
+
+		for (int j = 0; j < 16; j++)
+		{
+			if (a->transformation.f[j] != b->transformation.f[j])
+				return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Returns the captured state of a layer.
+ * \param layer the layer to look up
+ * \return the state of the layer or NULL if the layer was not captured
+ **/
+LayerSnapshot *SceneSnapshot::find(Layer *layer)
+{
+	map<Layer *, LayerSnapshot *>::iterator i = index->find(layer);
+	if (i == index->end())
+		return NULL;
+	return i->second;
+}
+
@@ -0,0 +1,87 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __SCENESNAPSHOT_H__
+#define __SCENESNAPSHOT_H__
+
+#include <vector>
+#include <map>
+
+#include "Layer.h"
+#include "Matrix.h"
+
+using namespace std;
+
+namespace Animata
+{
+
+/// Simulated state of a layer, copied from the layer at the end of a step.
+struct LayerSnapshot
+{
+	Layer *layer;				///< the layer the state belongs to
+	Matrix transformation;		///< accumulated transformation matrix of the layer
+
+	vector<float> vertexX;		///< \e x coordinates of the mesh vertices
+	vector<float> vertexY;		///< \e y coordinates of the mesh vertices
+	vector<float> jointX;		///< \e x coordinates of the skeleton joints
+	vector<float> jointY;		///< \e y coordinates of the skeleton joints
+};
+
+/**
+ * Copy of the simulated state of the scene, the layer transformations and
+ * the positions of the vertices and joints.
+ *
+ * The simulation thread captures a snapshot after every step, while the
+ * windows project the previous one. The layer state objects are reused
+ * between captures.
+ **/
+class SceneSnapshot
+{
+	public:
+		SceneSnapshot();
+		~SceneSnapshot();
+
+		void capture(vector<Layer *> *layers, unsigned frame);
+		void clear(void);
+
+		bool differs(SceneSnapshot *s);
+
+		LayerSnapshot *find(Layer *layer);
+
+		/// Returns the simulation step the snapshot was captured at.
+		inline unsigned getFrame(void) { return frame; }
+
+	private:
+		vector<LayerSnapshot *> *states;			///< layer states, reused between captures
+		unsigned stateCount;						///< number of layer states in use
+
+		map<Layer *, LayerSnapshot *> *index;		///< layer states by layer
+
+		unsigned frame;								///< simulation step of the capture
+};
+
+} /* namespace Animata */
+
+#endif
+
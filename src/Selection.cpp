@@ -24,7 +24,9 @@
 #include <stdio.h>
 
 #include "Selection.h"
+#include "animataUI.h"
 #include "Transform.h"
+#include "PickIndex.h"
 
 using namespace Animata;
 
@@ -35,15 +37,15 @@ using namespace Animata;
 Selection::Selection()
 {
 	hitCount = 0;
-
-	selectBuffer = new GLuint[BUFSIZE];
-	feedBuffer = new float[BUFSIZE];
+	hitHash = 0;
+	hitsChanged = false;
 
 	selectedLength = MAXHIT_INIT;
 	selected = new SelectItem[selectedLength];
 
-	pointsLength = 8190;
-	points = new float[pointsLength];
+	points = new vector<float>;
+
+	pickHits = new vector<SelectItem>;
 
 	pickLayer = NULL;
 }
@@ -53,19 +55,21 @@ Selection::Selection()
  */
 Selection::~Selection()
 {
-	delete [] selectBuffer;
-	delete [] feedBuffer;
 	delete [] selected;
-	delete [] points;
+	delete points;
+	delete pickHits;
 }
 
-		/// starts the picking on given coordinates
 /**
- * Drawing the mesh, skeleton and tetxure in GL_SELECT mode, deterimes which of their building blocks are in radius of the given coordinate.
+ * Determines which building blocks of the mesh and skeleton of a layer are in radius of the given coordinate.
  * This can be used for getting objects under the mouse cursor if called with the mouse coordinates.
  * Searching radius is read from \a radius.
- * The found primitives are then saved in the \a selected array, which elements hold each primitive's type and name.
- * Camera is used to determine the projection matrix for picking based on the camera properties.
+ * The primitives are looked up in the PickIndex of the layer, which is rebuilt only when the view
+ * coordinates have changed, instead of drawing the layer in GL_SELECT mode.
+ * The found primitives are then saved in the \a selected array, which elements hold each primitive's type and name,
+ * in the order the layer draws them, so later primitives take priority as before.
+ * Only the primitives displayed in the editor can be picked.
+ * Camera is used to map the window coordinates to the view coordinates of the primitives.
  *
  * \param	camera	The camera used for the scene.
  * \param	layer	Mesh and skeleton gets searched from this layer.
@@ -75,8 +79,6 @@ Selection::~Selection()
  */
 void Selection::doPick(Camera *camera, Layer *layer, TextureManager *textureManager, int x, int y)
 {
-	GLint hits;
-
 	// invalidate hits; if hit is valid during changing the actual layer in
 	// the laterTree, there could be an invalid selection on the new layer
 	// coming from the old one
@@ -86,381 +88,290 @@ void Selection::doPick(Camera *camera, Layer *layer, TextureManager *textureMana
 
 	pickLayer = layer;
 
-	// start selection mode
-	glSelectBuffer(BUFSIZE, selectBuffer);
-	(void)glRenderMode(GL_SELECT);
-
-	// clear the name stack, push initial name on it
-	glInitNames();
-	glPushName(0);
-
-	glMatrixMode(GL_PROJECTION);
-	glPushMatrix();
-
-	camera->setupPickingProjection(x, y, radius);
-
-	// drawing happens in ortho mode without any transformation in the modelview matrix
-	glMatrixMode(GL_MODELVIEW);
-	glPushMatrix();
-	glLoadIdentity();
-
-	if (layer->getMesh()->getAttachedTexture())
-		layer->getMesh()->getAttachedTexture()->draw();
+	float vx, vy;
+	windowToView(camera, x, y, &vx, &vy);
+	float scale = camera->getViewport()[2] > 0 ?
+		(float)camera->getWidth() / camera->getViewport()[2] : 1;
 
-	// draw only the current layer, no sublayers
-	layer->getMesh()->draw(RENDER_TEXTURE | RENDER_WIREFRAME);
-	layer->getSkeleton()->draw(RENDER_TEXTURE | RENDER_WIREFRAME);
+	PickIndex *index = layer->getPickIndex();
+	index->lock();
+	index->update(layer->getMesh(), layer->getSkeleton(),
+			ui->editorBox->getViewTransform()->getFrame());
+	index->pick(vx, vy, radius * scale / 2, displayedTypes(), pickHits);
+	index->unlock();
 
-	glMatrixMode(GL_MODELVIEW);
-	glPopMatrix();
+	processHits(pickHits);
+}
 
-	glMatrixMode(GL_PROJECTION);
-	glPopMatrix();
-	glFlush();
+/**
+ * Finds the face edge nearest to the given coordinate within the searching radius.
+ * The edges are looked up in the FaceTree of the layer, only if faces are displayed in the editor.
+ *
+ * \param	camera	The camera used for the scene.
+ * \param	layer	Mesh gets searched from this layer.
+ * \param	x		\e x window coordinate of the searching center.
+ * \param	y		\e y window coordinate of the searching center.
+ * \param	edge	The edge of the face is returned here, edge \a i connects face vertices \a i and \a i + 1.
+ * \retval	Face*	The face of the nearest edge, or NULL if there is no edge in range.
+ */
+Face *Selection::doPickEdge(Camera *camera, Layer *layer, int x, int y, int *edge)
+{
+	if(!(displayedTypes() & (1 << SELECT_TRIANGLE)))
+		return NULL;
+
+	float vx, vy;
+	windowToView(camera, x, y, &vx, &vy);
+	float scale = camera->getViewport()[2] > 0 ?
+		(float)camera->getWidth() / camera->getViewport()[2] : 1;
+
+	unsigned face;
+	PickIndex *index = layer->getPickIndex();
+	index->lock();
+	index->update(layer->getMesh(), layer->getSkeleton(),
+			ui->editorBox->getViewTransform()->getFrame());
+	bool found = index->nearestEdge(vx, vy, radius * scale, &face, edge);
+	index->unlock();
+
+	return found ? (*layer->getMesh()->getFaces())[face] : NULL;
+}
 
-	// go back to render mode, and process selection buffer
-	hits = glRenderMode(GL_RENDER);
-	processHits(hits, selectBuffer);
+/**
+ * Maps window coordinates to the orthographic view coordinates of the
+ * camera, as they are set up by Camera::setupPickingProjection().
+ * \param	camera	The camera used for the scene.
+ * \param	x		\e x window coordinate.
+ * \param	y		\e y window coordinate, from the top of the window.
+ * \param	vx		The \e x view coordinate is returned here.
+ * \param	vy		The \e y view coordinate is returned here.
+ */
+void Selection::windowToView(Camera *camera, float x, float y, float *vx, float *vy)
+{
+	const int *viewport = camera->getViewport();
+	float sx = viewport[2] > 0 ? (float)camera->getWidth() / viewport[2] : 1;
+	float sy = viewport[3] > 0 ? (float)camera->getHeight() / viewport[3] : 1;
+	*vx = viewport[0] + (x - viewport[0]) * sx;
+	*vy = viewport[1] + (viewport[3] - y - viewport[1]) * sy;
 }
 
-void Selection::processHits(unsigned hits, GLuint buffer[])
+/**
+ * Returns the primitive types displayed in the editor, only these can be picked and selected with the mouse.
+ * \retval unsigned Bitmask of the types, (1 << type).
+ */
+unsigned Selection::displayedTypes(void)
 {
-	// every hit record has 4 item
-	// - the number of names on the stack when the hit occured
-	// - the min/max window coordinate z values of all the vertices	of the primitive that intersected the viewing volume
-	// - contents of the name stack at the time of the hit, starting with the bottommost element first
+	unsigned types = 0;
+	int display = ui->settings.display_elements;
+	if(display & DISPLAY_EDITOR_TRIANGLE)
+		types |= 1 << SELECT_TRIANGLE;
+	if(display & DISPLAY_EDITOR_VERTEX)
+		types |= 1 << SELECT_VERTEX;
+	if(display & DISPLAY_EDITOR_BONE)
+		types |= 1 << SELECT_BONE;
+	if(display & DISPLAY_EDITOR_JOINT)
+		types |= 1 << SELECT_JOINT;
+	return types;
+}
 
-	GLuint found = 0;
-	GLuint *ptr = (GLuint*)buffer;
+/**
+ * Selects the found primitives by calling select() on the mesh or the skeleton of the layer.
+ * \param	layer	The layer of the primitives.
+ * \param	hits	The found primitives.
+ */
+void Selection::selectHits(Layer *layer, vector<SelectItem> *hits)
+{
+	for(unsigned i = 0; i < hits->size(); i++)
+	{
+		SelectItem *item = &(*hits)[i];
+		if((item->type == SELECT_VERTEX) || (item->type == SELECT_TRIANGLE))
+			layer->getMesh()->select(item->name, item->type);
+		else
+			layer->getSkeleton()->select(item->name, item->type);
+	}
+}
 
-	hitCount = 0;
+void Selection::processHits(vector<SelectItem> *hits)
+{
+	hitCount = hits->size();
 
-	// if selected array is to small to store hits, allocate a new one with hits lenght
-	if(hits > selectedLength)
+	// if selected array is to small to store hits, allocate a new one at least twice as long
+	if(hitCount > selectedLength)
 	{
 		delete [] selected;
 
-		selectedLength = hits;
+		while(selectedLength < hitCount)
+			selectedLength *= 2;
 		selected = new SelectItem[selectedLength];
 	}
 
-	for(unsigned i = 0; i < hits; i++)
-	{
-		GLuint names = *ptr;
-
-		//printf("number of names for this hit = %d\n", names); ptr++;
-		//printf("  z1 is %g;", (float) *ptr/0x7fffffff); ptr++;
-		//printf(" z2 is %g\n", (float) *ptr/0x7fffffff); ptr++;
+	for(unsigned i = 0; i < hitCount; i++)
+		selected[i] = (*hits)[i];
 
-		ptr += 3;
-		for(GLuint j = 0; j < names; j++)
-		{
-			found = *ptr;
-
-			if(j == 0)
-			{
-				selected[hitCount].type = found;
-			}
-			else if(j == 1)
-			{
-				selected[hitCount++].name = found;
-			}
-
-			ptr++;
-		}
+	// FNV-1a hash of the picked primitives
+	unsigned hash = 2166136261u;
+	for (unsigned i = 0; i < hitCount; i++)
+	{
+		hash = (hash ^ selected[i].type) * 16777619u;
+		hash = (hash ^ selected[i].name) * 16777619u;
 	}
+	hitsChanged = (hash != hitHash);
+	hitHash = hash;
 }
 
 /**
- * Selects the building elements of \c type from \c node in the given rectangle by calling select() for each element.
- * \c node has to be an inherited from Drawable, so it gets a valid select()
- * \param	node	The an object inherited from Drawable which gets searched for its primitives.
+ * Selects the building elements of \c type from \c layer drawn in the given rectangle.
+ * The elements are looked up in the PickIndex of the layer, only the types displayed in the editor can be selected.
+ * \param	layer	The layer which gets searched for its primitives.
  * \param	type	Type of primitive which are searched.
- * \param	x		\e x coordinate of the searching reactangle's upper left corner.
- * \param	y		\e y coordinate of the searching reactangle's upper left corner.
- * \param	w		Width of the searching reactangle.
- * \param	h		Height of the searching reactangle.
- * \sa doCircleSelect()
+ * \param	x		\e x window coordinate of a corner of the searching reactangle.
+ * \param	y		\e y window coordinate of a corner of the searching reactangle.
+ * \param	w		\e x window coordinate of the opposite corner.
+ * \param	h		\e y window coordinate of the opposite corner.
+ * \sa doCircleSelect(), doLassoSelect()
  */
-void Selection::doSelect(ADrawable *node, unsigned type, float x, float y, float w, float h)
+void Selection::doSelect(Layer *layer, unsigned type, float x, float y, float w, float h)
 {
-	GLint hits;
-
-	// get the boundaries of actual viewport
-	GLint viewport[4];
-	glGetIntegerv(GL_VIEWPORT, viewport);
-
-	// start selection mode
-	glSelectBuffer(BUFSIZE, selectBuffer);
-	(void)glRenderMode(GL_SELECT);
-
-	// clear the name stack, push initial name on it
-	glInitNames();
-	glPushName(0);
-
-	glMatrixMode(GL_PROJECTION);
-	glPushMatrix();
-	glLoadIdentity();
-
-	// mirror the screen along y coordinate because of the different coordinate systems
-	glOrtho(x, w, viewport[3] - h, viewport[3] - y, -1, 1);
-
-	glMatrixMode(GL_MODELVIEW);
-	glLoadIdentity();
-	node->draw(RENDER_TEXTURE | RENDER_WIREFRAME);
-
-	// restore the projection matrix
-	glMatrixMode(GL_PROJECTION);
-	glPopMatrix();
-	glFlush();
-
-	// go back to render mode, and process selection buffer
-	hits = glRenderMode(GL_RENDER);
-
-	GLuint *ptr = (GLuint*)selectBuffer;
-
-	for(GLint i = 0; i < hits; i++)
-	{
-		GLuint names = *ptr;
-		ptr += 3;
-
-		if(names == 2 && *ptr == type)
-		{
-			ptr++;
-			node->select(*ptr, type);
-			ptr++;
-		}
-		else
-		{
-			ptr += names;
-		}
-	}
+	Camera *camera = ui->editorBox->getCamera();
+	float x0, y0, x1, y1;
+	windowToView(camera, x, y, &x0, &y0);
+	windowToView(camera, w, h, &x1, &y1);
+
+	vector<SelectItem> hits;
+	PickIndex *index = layer->getPickIndex();
+	index->lock();
+	index->update(layer->getMesh(), layer->getSkeleton(),
+			ui->editorBox->getViewTransform()->getFrame());
+	index->rectQuery(x0, y0, x1, y1, (1 << type) & displayedTypes(), &hits);
+	index->unlock();
+
+	selectHits(layer, &hits);
 }
 
 /**
- * Selects the building elements of \c type from \c node in the given circle by calling circleSelect() for each element.
- * \c node has to be an inherited from Drawable, so it gets a valid circleSelect()
- * \param	node	The an object inherited from Drawable which gets searched for its primitives.
+ * Selects the building elements of \c type from \c layer inside the given circle.
+ * Vertices and joints are selected if their centre is in the circle, bones and faces if all their points are.
+ * \param	layer	The layer which gets searched for its primitives.
  * \param	type	Type of primitive which are searched.
- * \param	xc		\e x coordinate of the searching circle's center.
- * \param	yc		\e y coordinate of the searching circle's center.
+ * \param	xc		\e x view coordinate of the searching circle's center.
+ * \param	yc		\e y view coordinate of the searching circle's center.
  * \param	r		Radius of the searching circle.
- * \sa doSelect()
+ * \sa doSelect(), doLassoSelect()
  */
-void Selection::doCircleSelect(ADrawable *node, unsigned type, int xc, int yc, int r)
+void Selection::doCircleSelect(Layer *layer, unsigned type, int xc, int yc, int r)
 {
-	int x0 = xc - r;
-	int y0 = yc - r;
-	int x1 = xc + r;
-	int y1 = yc + r;
-
-	GLint hits;
-
-	// start selection mode
-	glSelectBuffer(BUFSIZE, selectBuffer);
-	(void)glRenderMode(GL_SELECT);
-
-	// clear the name stack, push initial name on it
-	glInitNames();
-	glPushName(0);
-
-	glMatrixMode(GL_PROJECTION);
-	glPushMatrix();
-	glLoadIdentity();
-
 	// no mirroring is required here as coordinates come from the bone structure (bone.getCenter),
 	// which has its coordinates in the opengl coordinate system, not in the window coordinate system
-	glOrtho(x0, x1, y0, y1, -1, 1);
-
-	glMatrixMode(GL_MODELVIEW);
-	glLoadIdentity();
-	node->draw(RENDER_TEXTURE | RENDER_WIREFRAME);
-
-	// restore the projection matrix
-	glMatrixMode(GL_PROJECTION);
-	glPopMatrix();
-	glFlush();
-
-	// go back to render mode, and process selection buffer
-	hits = glRenderMode(GL_RENDER);
-
-	GLuint *ptr = (GLuint*)selectBuffer;
-
-	for (GLint i = 0; i < hits; i++)
-	{
-		GLuint names = *ptr;
-		ptr += 3;
-
-		if (names == 2 && *ptr == type)
-		{
-			ptr++;
-			node->circleSelect(*ptr, type, xc, yc, r);
-			//node->select(*ptr, type);
-			ptr++;
-		}
-		else
-		{
-			ptr += names;
-		}
-	}
+	vector<SelectItem> hits;
+	PickIndex *index = layer->getPickIndex();
+	index->lock();
+	index->update(layer->getMesh(), layer->getSkeleton(),
+			ui->editorBox->getViewTransform()->getFrame());
+	index->circleQuery(xc, yc, r, 1 << type, &hits);
+	index->unlock();
+
+	selectHits(layer, &hits);
 }
 
-int Selection::processFeedback(int size, float buffer[], float points[])
+/**
+ * Selects the building elements of \c type from \c layer inside the polygon drawn by a lasso.
+ * Vertices and joints are selected if their centre is in the polygon, bones and faces if all their points are.
+ * Only the types displayed in the editor can be selected.
+ * \param	layer	The layer which gets searched for its primitives.
+ * \param	type	Type of primitive which are searched.
+ * \param	polygon	Points of the lasso in window coordinates, \e y from the top of the window.
+ * \sa doSelect(), doCircleSelect()
+ */
+void Selection::doLassoSelect(Layer *layer, unsigned type, vector<Vector2D> *polygon)
 {
-	int count = size;
-	int index = 0;
-	int passthrough = 0;
-
-	while(count)
+	Camera *camera = ui->editorBox->getCamera();
+	vector<Vector2D> viewPolygon(polygon->size());
+	for (unsigned i = 0; i < polygon->size(); i++)
 	{
-		GLfloat token = buffer[size - count];
-		count--;
-
-		if(token == GL_PASS_THROUGH_TOKEN)
-		{
-//			printf("GL_PASS_THROUGH_TOKEN\n");
-//			printf("  %4.2f\n", buffer[size - count]);
-
-			// if the actual passthrough token comes directly after the previous passthrough token
-			// then the primitive after the previous passthrough is out of screen
-			if(passthrough == 1)
-			{
-				points[index++] = OUT_OF_SCREEN;
-				points[index++] = OUT_OF_SCREEN;
-			}
-
-			points[index++] = buffer[size - count];
-			passthrough = 1;
-			count--;
-		}
-		else if(token == GL_POINT_TOKEN)
-		{
-//			printf("GL_POINT_TOKEN\n");
-			for(int i = 0; i < 2; i++)
-			{
-				points[index++] = buffer[size - count];
-//				printf("%4.2f ", buffer[size - count]);
-				count--;
-			}
-			passthrough = 0;
-//			printf("\n");
-		}
-
-		// others should not come
-		else if(token == GL_LINE_TOKEN)
-		{
-			printf("GL_LINE_TOKEN\n");
-			for(int n = 0; n < 2; n++)
-			{
-				for(int i = 0; i < 2; i++)
-				{
-					printf("%4.2f ", buffer[size - count]);
-					count--;
-				}
-				printf("\n");
-			}
-			assert(false);
-		}
-		else if(token == GL_LINE_RESET_TOKEN)
-		{
-			printf("GL_LINE_RESET_TOKEN\n");
-			for(int n = 0; n < 2; n++)
-			{
-				for(int i = 0; i < 2; i++)
-				{
-					printf("%4.2f ", buffer[size - count]);
-					count--;
-				}
-				printf("\n");
-			}
-			assert(false);
-		}
-		else if(token == GL_POLYGON_TOKEN)
-		{
-			printf("GL_POLYGON_TOKEN\n");
-			int n = (int)buffer[size - count];
-			count--;
-			for(; n > 0; n--)
-			{
-				for(int i = 0; i < 2; i++)
-				{
-					printf("%4.2f ", buffer[size - count]);
-					count--;
-				}
-				printf("\n");
-			}
-			assert(false);
-		}
-		else
-		{
-			printf("UNRECOGNIZED\n");
-			assert(false);
-		}
+		windowToView(camera, (*polygon)[i].x, (*polygon)[i].y,
+				&viewPolygon[i].x, &viewPolygon[i].y);
 	}
 
-	// check if the last primitive is also out of screen
-	if(passthrough == 1)
-	{
-		points[index++] = OUT_OF_SCREEN;
-		points[index++] = OUT_OF_SCREEN;
-	}
+	vector<SelectItem> hits;
+	PickIndex *index = layer->getPickIndex();
+	index->lock();
+	index->update(layer->getMesh(), layer->getSkeleton(),
+			ui->editorBox->getViewTransform()->getFrame());
+	index->lassoQuery(&viewPolygon, (1 << type) & displayedTypes(), &hits);
+	index->unlock();
 
-	return index;
+	selectHits(layer, &hits);
 }
 
 /**
- * Draws the given layer in \c GL_FEEDBACK mode, and sets the view coordinates of every primitive to the result of the feedback.
- * Drawing the mesh and skeleton in \c GL_FEEDBACK mode, result in drawing only an individual vertex to the vertices and joints.
- * This position is then used for the particular primitive's view coordinate. All of this is required to let primitive's size
- * view-distance independent.
+ * Computes the view coordinates of the vertices and joints of the given layer. The positions are
+ * packed into the \a points array and projected on the CPU by Transform::projectPoints(), which
+ * requires the transformation matrices of the layer to be set by Transform::setMatrices().
+ * The view coordinates are required to let primitive's size view-distance independent.
+ * If a captured state of the layer is given, its positions are projected instead of the ones
+ * being simulated, unless the layer has been edited since the capture.
  *
  * \param	layer	The layer with a mesh and skeleton which view coordinates get computed.
+ * \param	state	The state of the layer captured by the simulation, or NULL.
  * \sa Mesh::setVertexViewCoords(), Skeleton::setJointViewCoords()
  */
-void Selection::doFeedback(Layer *layer)
+void Selection::doFeedback(Layer *layer, LayerSnapshot *state /* = NULL */)
 {
-	int size, count;
-
-	// if points array is to small to hold points found in feedback mode, allocate new array with double size
-	// every point requires 3 value in the array
-	if(pointsLength < layer->getMesh()->getVertices()->size() * 3)
+	vector<Vertex *> *vertices = layer->getMesh()->getVertices();
+	vector<Joint *> *joints = layer->getSkeleton()->getJoints();
+
+	unsigned vertexCount = vertices->size();
+	unsigned jointCount = joints->size();
+
+	// every point requires four values in the array, the world and the view coordinates,
+	// the array grows with the largest layer, so every vertex and joint is projected
+	unsigned count = vertexCount > jointCount ? vertexCount : jointCount;
+	if(count == 0)
+		return;
+	if(points->size() < count * 4)
+		points->resize(count * 4);
+
+	float *x = &(*points)[0];
+	float *y = x + count;
+	float *vx = x + count * 2;
+	float *vy = x + count * 3;
+
+	if(state && (state->vertexX.size() == vertexCount))
 	{
-		pointsLength *= 2;
-
-		delete [] points;
-		points = new float[pointsLength];
+		for(unsigned i = 0; i < vertexCount; i++)
+		{
+			x[i] = state->vertexX[i];
+			y[i] = state->vertexY[i];
+		}
 	}
-
-	if(pointsLength < layer->getSkeleton()->getJoints()->size() * 3)
+	else
 	{
-		pointsLength *= 2;
-
-		delete [] points;
-		points = new float[pointsLength];
+		for(unsigned i = 0; i < vertexCount; i++)
+		{
+			Vertex *v = (*vertices)[i];
+			x[i] = v->coord.x;
+			y[i] = v->coord.y;
+		}
 	}
+	Transform::projectPoints(x, y, vx, vy, vertexCount);
+	layer->getMesh()->setVertexViewCoords(vx, vy);
 
-	// go to feedback mode
-	glFeedbackBuffer(BUFSIZE, GL_2D, feedBuffer);
-	glRenderMode(GL_FEEDBACK);
-
-	// draw mesh in feedback mode
-	layer->getMesh()->draw(RENDER_FEEDBACK);
-	size = glRenderMode(GL_RENDER);
-
-	// process the feedback buffer and set the vertex positions
-	count = processFeedback(size, feedBuffer, points);
-	layer->getMesh()->setVertexViewCoords(points, count);
-
-	// go to feedback mode
-	glFeedbackBuffer(BUFSIZE, GL_2D, feedBuffer);
-	glRenderMode(GL_FEEDBACK);
-
-	// draw skeleton in feedback mode
-	layer->getSkeleton()->draw(RENDER_FEEDBACK);
-	size = glRenderMode(GL_RENDER);
-
-	// process the feedback buffer and set the joint positions
-	count = processFeedback(size, feedBuffer, points);
-	layer->getSkeleton()->setJointViewCoords(points, count);
+	if(state && (state->jointX.size() == jointCount))
+	{
+		for(unsigned i = 0; i < jointCount; i++)
+		{
+			x[i] = state->jointX[i];
+			y[i] = state->jointY[i];
+		}
+	}
+	else
+	{
+		for(unsigned i = 0; i < jointCount; i++)
+		{
+			Joint *j = (*joints)[i];
+			x[i] = j->x;
+			y[i] = j->y;
+		}
+	}
+	Transform::projectPoints(x, y, vx, vy, jointCount);
+	layer->getSkeleton()->setJointViewCoords(vx, vy);
 }
 
@@ -36,6 +36,7 @@
 #include "Camera.h"
 #include "Layer.h"
 #include "TextureManager.h"
+#include "SceneSnapshot.h"
 
 using namespace std;
 
@@ -50,7 +51,8 @@ struct SelectItem
 };
 
 /**
- * Uses various alternative OpenGL rendermodes to implement basic picking, selection and feedback mechanisms.
+ * Implements basic picking, selection and feedback mechanisms. Picking and selection are done on the CPU with the
+ * PickIndex of the layer.
  * Has an own \a selected buffer to store which objects are found on a 2d coordinate or range during a pick or selection call.
  */
 class Selection
@@ -62,20 +64,20 @@ class Selection
 		SelectItem *selected;				///< list of the various primitives under mouse cursor
 		unsigned selectedLength;			///< actual lenght of the \a selected array
 		unsigned hitCount;					///< number of primitives under the mouse cursor after doPick()
+		unsigned hitHash;					///< hash of the primitives under the mouse cursor
+		bool hitsChanged;					///< set if the last doPick() found different primitives than the previous one
 
-		float *points;						///< holds vertices' position after calling doFeedback(), every vertex stores three value: name, x, y coordinate
-		unsigned pointsLength;				///< actual length of the \a points array
+		vector<float> *points;				///< packed world and view coordinates of the vertices and joints in doFeedback()
 
 		Layer *pickLayer;					///< layer where on the picking happens
+		vector<SelectItem> *pickHits;		///< primitives found by the PickIndex in doPick()
 
-		static const int BUFSIZE = 65536;	///< size of the OpenGL buffer during selection and feedback modes
-		GLuint *selectBuffer;				///< internal selection buffer for OpenGL
-		float *feedBuffer;					///< internal feedback buffer for OpenGL
+		/// Stores the picked primitives.
+		void processHits(vector<SelectItem> *hits);
+		void selectHits(Layer *layer, vector<SelectItem> *hits);
 
-		/// Processes selection buffer.
-		void processHits(unsigned hits, GLuint buffer[]);
-		/// Processes feedback buffer.
-		int processFeedback(int size, float buffer[], float points[]);
+		static void windowToView(Camera *camera, float x, float y, float *vx, float *vy);
+		static unsigned displayedTypes(void);
 
 	public:
 
@@ -90,17 +92,17 @@ class Selection
 			SELECT_TEXTURE
 		};
 
-		static const int OUT_OF_SCREEN = 0xABCD;	///< value for coordinates that are out of screen
-
 		Selection();
 		~Selection();
 
 		void doPick(Camera *camera, Layer *layer, TextureManager *textureManager, int x, int y);
+		Face *doPickEdge(Camera *camera, Layer *layer, int x, int y, int *edge);
 
-		void doSelect(ADrawable *node, unsigned type, float x, float y, float w, float h);
-		void doCircleSelect(ADrawable *node, unsigned type, int x, int y, int r);
+		void doSelect(Layer *layer, unsigned type, float x, float y, float w, float h);
+		void doCircleSelect(Layer *layer, unsigned type, int x, int y, int r);
+		void doLassoSelect(Layer *layer, unsigned type, vector<Vector2D> *polygon);
 
-		void doFeedback(Layer *layer);
+		void doFeedback(Layer *layer, LayerSnapshot *state = NULL);
 
 		/**
 		 * Returns the \a selected array, which holds the primitives that are under the mouse cursor.
@@ -111,9 +113,15 @@ class Selection
 		inline SelectItem* getSelected(void) { return selected; }
 		/**
 		 * Returns the number of primitives under the mouse cursor after calling doPick().
-		 * \retval int The number of the picked primitives.
+		 * \retval unsigned The number of the picked primitives.
+		 */
+		inline unsigned getHitCount(void) { return hitCount; }
+		/**
+		 * Returns true if the primitives under the mouse cursor changed in
+		 * the last doPick() call.
+		 * \retval bool True if the picked primitives changed.
 		 */
-		inline int getHitCount(void) { return hitCount; }
+		inline bool hasHitsChanged(void) { return hitsChanged; }
 		/**
 		 * Virtually clears the \a selected array by setting the size of it to 0.
 		 */
@@ -0,0 +1,122 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __SELECTIONSET_H__
+#define __SELECTIONSET_H__
+
+#include <vector>
+
+using namespace std;
+
+namespace Animata
+{
+
+/**
+ * The selected elements of a mesh or a skeleton.
+ *
+ * The \a selected flag of an element tells whether it is in the set, and the
+ * set keeps a dense list of the selected elements, so they can be processed
+ * without going through every element. The position of an element in the
+ * list is stored in its \a selectionIndex, which makes removal constant time
+ * by moving the last element to its place.
+ *
+ * The flag must not be changed directly, only through the set, and the
+ * elements have to be removed from the set before they are deleted.
+ **/
+template <class T>
+class SelectionSet
+{
+	public:
+		SelectionSet() { list = new vector<T *>; }
+		~SelectionSet() { delete list; }
+
+		/**
+		 * Adds an element to the set if it is not selected yet.
+		 * \param e the element
+		 **/
+		void add(T *e)
+		{
+			if (e->selected)
+				return;
+			e->selected = true;
+			e->selectionIndex = list->size();
+			list->push_back(e);
+		}
+
+		/**
+		 * Removes an element from the set if it is selected.
+		 * \param e the element
+		 **/
+		void remove(T *e)
+		{
+			if (!e->selected)
+				return;
+			T *last = list->back();
+			(*list)[e->selectionIndex] = last;
+			last->selectionIndex = e->selectionIndex;
+			list->pop_back();
+			e->selected = false;
+		}
+
+		/**
+		 * Selects or deselects an element.
+		 * \param e the element
+		 * \param s true to select, false to deselect
+		 **/
+		void set(T *e, bool s)
+		{
+			if (s)
+				add(e);
+			else
+				remove(e);
+		}
+
+		/// Inverts the selection state of an element.
+		void flip(T *e) { set(e, !e->selected); }
+
+		/// Deselects every element of the set.
+		void clear(void)
+		{
+			for (unsigned i = 0; i < list->size(); i++)
+				(*list)[i]->selected = false;
+			list->clear();
+		}
+
+		/// Returns the number of selected elements.
+		inline unsigned size(void) { return list->size(); }
+
+		/**
+		 * Returns the selected elements. The order of the elements changes
+		 * when one of them is removed.
+		 **/
+		inline vector<T *> *getList(void) { return list; }
+
+	private:
+		vector<T *> *list;	///< the selected elements
+};
+
+} /* namespace Animata */
+
+#endif
+
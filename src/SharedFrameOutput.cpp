@@ -0,0 +1,235 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "SharedFrameOutput.h"
+
+using namespace Animata;
+
+/**
+ * Creates the shared memory ring and its semaphore. The names get a leading
+ * slash if they do not have one, the semaphore is named \e name-frame.
+ * \param name name of the shared memory
+ * \param maxWidth the largest frame width
+ * \param maxHeight the largest frame height
+ * \param slots number of frames in the ring
+ **/
+SharedFrameOutput::SharedFrameOutput(const char *name, int maxWidth,
+		int maxHeight, int slots /* = SHARED_FRAME_SLOTS */)
+{
+	snprintf(this->name, sizeof(this->name), "%s%s",
+			name[0] == '/' ? "" : "/", name);
+	snprintf(semName, sizeof(semName), "%s-frame", this->name);
+
+	fd = -1;
+	size = 0;
+	header = NULL;
+	semaphore = SEM_FAILED;
+	this->slots = slots;
+	slot = NULL;
+	frame = 0;
+
+	if (!create(maxWidth, maxHeight))
+		return;
+
+	semaphore = sem_open(semName, O_CREAT, 0644, 0);
+	if (semaphore == SEM_FAILED)
+		perror(semName);
+}
+
+/**
+ * Creates and maps the shared memory with slots of the given size.
+ * \param maxWidth the largest frame width
+ * \param maxHeight the largest frame height
+ * \return true if the shared memory could be created
+ **/
+bool SharedFrameOutput::create(int maxWidth, int maxHeight)
+{
+	unsigned slotSize = maxWidth * maxHeight * 4;
+	slotSize = (slotSize + SHARED_FRAME_ALIGN - 1) & ~(SHARED_FRAME_ALIGN - 1);
+	unsigned dataOffset = sizeof(SharedFrameHeader) +
+		slots * sizeof(SharedFrameSlot);
+	dataOffset = (dataOffset + SHARED_FRAME_ALIGN - 1) &
+		~(SHARED_FRAME_ALIGN - 1);
+	size = dataOffset + (size_t)slots * slotSize;
+
+	fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+	if (fd < 0)
+	{
+		perror(name);
+		return false;
+	}
+
+	void *p = MAP_FAILED;
+	if (ftruncate(fd, size) == 0)
+		p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED)
+	{
+		perror(name);
+		close(fd);
+		shm_unlink(name);
+		fd = -1;
+		return false;
+	}
+
+	header = (SharedFrameHeader *)p;
+	memset(header, 0, dataOffset);
+	header->version = SHARED_FRAME_VERSION;
+	header->slotCount = slots;
+	header->slotSize = slotSize;
+	header->maxWidth = maxWidth;
+	header->maxHeight = maxHeight;
+	header->dataOffset = dataOffset;
+	header->latest = 0;
+	header->replaced = 0;
+	// the magic is written last, readers check it before the rest
+	__sync_synchronize();
+	strncpy(header->magic, SHARED_FRAME_MAGIC, sizeof(header->magic));
+
+#ifdef DEBUG
+	printf("frame output: %s, %d slots of %dx%d\n", name, slots,
+			maxWidth, maxHeight);
+#endif
+
+	return true;
+}
+
+/**
+ * Creates the shared memory again with slots fitting a larger frame. The
+ * old memory is marked as replaced and unlinked, the readers still having
+ * it mapped can read its last frames.
+ * \param width width of the frame
+ * \param height height of the frame
+ * \return true if the new shared memory could be created
+ **/
+bool SharedFrameOutput::grow(int width, int height)
+{
+	int maxWidth = (unsigned)width > header->maxWidth ? width : header->maxWidth;
+	int maxHeight = (unsigned)height > header->maxHeight ? height : header->maxHeight;
+
+	header->replaced = 1;
+	__sync_synchronize();
+
+	munmap(header, size);
+	close(fd);
+	shm_unlink(name);
+	header = NULL;
+
+	return create(maxWidth, maxHeight);
+}
+
+/**
+ * Removes the shared memory and the semaphore. Readers having them open
+ * can still read the last frames.
+ **/
+SharedFrameOutput::~SharedFrameOutput()
+{
+	if (semaphore != SEM_FAILED)
+	{
+		sem_close(semaphore);
+		sem_unlink(semName);
+	}
+
+	if (header)
+	{
+		munmap(header, size);
+		close(fd);
+		shm_unlink(name);
+	}
+}
+
+/**
+ * Starts writing the next frame of the ring.
+ * \param width width of the frame
+ * \param height height of the frame
+ * The slots are made larger if the frame does not fit.
+ * \return the pixels of the slot to write the bottom-up RGBA frame into, or
+ *	NULL if the output is closed
+ **/
+unsigned char *SharedFrameOutput::beginFrame(int width, int height)
+{
+	if ((header == NULL) || (width <= 0) || (height <= 0))
+		return NULL;
+
+	if (((unsigned)width > header->maxWidth) ||
+		((unsigned)height > header->maxHeight))
+	{
+		if (!grow(width, height))
+		{
+			fprintf(stderr, "%s: %dx%d frame dropped, the frame output "
+					"is closed\n", name, width, height);
+			return NULL;
+		}
+	}
+
+	unsigned index = frame % header->slotCount;
+	slot = (SharedFrameSlot *)(header + 1) + index;
+
+	slot->sequence++;
+	__sync_synchronize();
+
+	slot->frame = frame + 1;
+	slot->width = width;
+	slot->height = height;
+	slot->stride = width * 4;
+	slot->flags = SHARED_FRAME_BOTTOM_UP;
+
+	return (unsigned char *)header + header->dataOffset +
+		(size_t)index * header->slotSize;
+}
+
+/**
+ * Publishes the frame started by beginFrame() and signals the readers.
+ **/
+void SharedFrameOutput::endFrame(void)
+{
+	if (slot == NULL)
+		return;
+
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	slot->timestamp = tv.tv_sec + tv.tv_usec * 1e-6;
+
+	__sync_synchronize();
+	slot->sequence++;
+	frame++;
+	header->latest = frame;
+	slot = NULL;
+
+	// a reader not keeping up should not find a backlog of signals
+	int value = 0;
+	if (semaphore != SEM_FAILED)
+	{
+		if ((sem_getvalue(semaphore, &value) != 0) || (value == 0))
+			sem_post(semaphore);
+	}
+}
+
@@ -0,0 +1,122 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __SHAREDFRAMEOUTPUT_H__
+#define __SHAREDFRAMEOUTPUT_H__
+
+#include <stdlib.h>
+#include <semaphore.h>
+
+#define SHARED_FRAME_MAGIC "ANIMATA"
+#define SHARED_FRAME_VERSION 2
+/// default number of frames in the ring
+#define SHARED_FRAME_SLOTS 3
+/// pixel data of the slots is aligned to this many bytes
+#define SHARED_FRAME_ALIGN 64
+/// the rows of the frame are stored from the bottom like in OpenGL
+#define SHARED_FRAME_BOTTOM_UP 1
+
+namespace Animata
+{
+
+/**
+ * Header at the beginning of the shared memory. The slot headers follow it,
+ * then the pixel data of the slots at SharedFrameHeader::dataOffset.
+ **/
+struct SharedFrameHeader
+{
+	char magic[8];				///< SHARED_FRAME_MAGIC
+	unsigned version;			///< SHARED_FRAME_VERSION
+	unsigned slotCount;			///< number of frames in the ring
+	unsigned slotSize;			///< bytes of pixel data in a slot
+	unsigned maxWidth;			///< the largest frame width fitting in a slot
+	unsigned maxHeight;			///< the largest frame height fitting in a slot
+	unsigned dataOffset;		///< offset of the pixel data of the first slot
+	volatile unsigned latest;	///< number of the last complete frame, 0 if none
+	volatile unsigned replaced;	///< set when the output is created again with larger slots
+};
+
+/**
+ * Header of a frame in the ring. The sequence is odd while the frame is
+ * written, a reader has to check that it is even and unchanged after
+ * reading the pixels.
+ **/
+struct SharedFrameSlot
+{
+	volatile unsigned sequence;	///< incremented before and after writing
+	unsigned frame;				///< number of the frame, from 1
+	double timestamp;			///< time of the frame in seconds since the epoch
+	unsigned width;				///< width of the frame
+	unsigned height;			///< height of the frame
+	unsigned stride;			///< bytes in a row of RGBA pixels
+	unsigned flags;				///< SHARED_FRAME_BOTTOM_UP
+};
+
+/**
+ * Publishes the rendered frames in a POSIX shared memory ring, so other
+ * processes on the same machine can read them without copying or capturing
+ * the screen.
+ *
+ * The frames are written into the slots one after the other. A named
+ * semaphore with the same name is posted after every frame, a reader can
+ * wait on it and read the slot of SharedFrameHeader::latest.
+ *
+ * A frame larger than the slots makes the output create the shared memory
+ * again under the same name with larger slots. SharedFrameHeader::replaced
+ * is set in the old memory, so the readers know to map the new one.
+ **/
+class SharedFrameOutput
+{
+	public:
+		SharedFrameOutput(const char *name, int maxWidth, int maxHeight,
+				int slots = SHARED_FRAME_SLOTS);
+		~SharedFrameOutput();
+
+		/// Returns true if the shared memory could be created.
+		inline bool isOpen(void) { return header != NULL; }
+
+		unsigned char *beginFrame(int width, int height);
+		void endFrame(void);
+
+	private:
+		bool create(int maxWidth, int maxHeight);
+		bool grow(int width, int height);
+
+		char name[256];			///< name of the shared memory
+		char semName[264];		///< name of the semaphore
+
+		int fd;					///< shared memory file descriptor
+		size_t size;			///< size of the mapping
+		SharedFrameHeader *header;	///< the mapped shared memory
+		sem_t *semaphore;		///< posted after every frame
+
+		int slots;				///< number of frames in the ring
+		SharedFrameSlot *slot;	///< the slot being written or NULL
+		unsigned frame;			///< number of frames written
+};
+
+} /* namespace Animata */
+
+#endif
+
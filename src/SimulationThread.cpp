@@ -0,0 +1,243 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "animata.h"
+#include "animataUI.h"
+#include "SimulationThread.h"
+
+using namespace Animata;
+
+/**
+ * Creates the simulation thread, it is started by start().
+ **/
+SimulationThread::SimulationThread()
+{
+	thread = 0;
+	threadRunning = false;
+
+	pthread_mutex_init(&tickMutex, NULL);
+	pthread_cond_init(&tickCond, NULL);
+	ticked = false;
+
+	pthread_mutex_init(&commandMutex, NULL);
+	commands = new vector<SceneCommand *>;
+
+	pthread_mutex_init(&snapshotMutex, NULL);
+	snapshots[0] = new SceneSnapshot();
+	snapshots[1] = new SceneSnapshot();
+	front = 0;
+
+	frame = 0;
+}
+
+SimulationThread::~SimulationThread()
+{
+	stop();
+
+	vector<SceneCommand *>::iterator c = commands->begin();
+	for (; c < commands->end(); c++)
+		delete *c;
+	delete commands;
+	pthread_mutex_destroy(&commandMutex);
+
+	delete snapshots[0];
+	delete snapshots[1];
+	pthread_mutex_destroy(&snapshotMutex);
+
+	pthread_cond_destroy(&tickCond);
+	pthread_mutex_destroy(&tickMutex);
+}
+
+void *SimulationThread::threadFunc(void *p)
+{
+	static_cast<SimulationThread *>(p)->threadTask();
+	return 0;
+}
+
+/**
+ * Starts the simulation in a new thread.
+ **/
+void SimulationThread::start(void)
+{
+	if (thread == 0)
+	{
+		threadRunning = true;
+		pthread_create(&thread, NULL, &threadFunc, this);
+	}
+}
+
+/**
+ * Stops the simulation and waits for the thread to finish its step.
+ **/
+void SimulationThread::stop(void)
+{
+	if (thread)
+	{
+		pthread_mutex_lock(&tickMutex);
+		threadRunning = false;
+		pthread_cond_signal(&tickCond);
+		pthread_mutex_unlock(&tickMutex);
+
+		pthread_join(thread, NULL);
+		thread = 0;
+	}
+}
+
+/**
+ * Starts the next simulation step, called on every frame of the
+ * FrameScheduler.
+ **/
+void SimulationThread::tick(void)
+{
+	pthread_mutex_lock(&tickMutex);
+	ticked = true;
+	pthread_cond_signal(&tickCond);
+	pthread_mutex_unlock(&tickMutex);
+}
+
+void SimulationThread::threadTask(void)
+{
+	while (ui != NULL)
+	{
+		pthread_mutex_lock(&tickMutex);
+		while (threadRunning && !ticked)
+			pthread_cond_wait(&tickCond, &tickMutex);
+		ticked = false;
+		pthread_mutex_unlock(&tickMutex);
+
+		if (!threadRunning)
+			break;
+
+		step();
+	}
+}
+
+/**
+ * Does one simulation step, and publishes its result as the front snapshot.
+ **/
+void SimulationThread::step(void)
+{
+	AnimataWindow *editor = ui->editorBox;
+	SceneSnapshot *back = snapshots[1 - front];
+	bool changed = false;
+
+	editor->lock();
+
+	runCommands();
+	// the OSC messages received since the last step are applied in one batch
+	editor->getOSCListener()->applyCommands();
+
+	vector<Layer *> *layers = editor->getAllLayers();
+	Layer *rootLayer = editor->getRootLayer();
+	if (layers && rootLayer)
+	{
+		/* run the spring model simulation on all bones of the skeleton */
+		if (ui->settings.playSimulation == 1)
+			rootLayer->simulate(ui->settings.iteration);
+
+		vector<Layer *>::iterator l = layers->begin();
+		for (; l < layers->end(); l++)
+			(*l)->calcTransformationMatrix();
+
+		back->capture(layers, frame + 1);
+		// the front snapshot is only swapped by this thread, reading it
+		// needs no locking
+		changed = back->differs(snapshots[front]);
+	}
+
+	editor->unlock();
+
+	pthread_mutex_lock(&snapshotMutex);
+	front = 1 - front;
+	frame++;
+	pthread_mutex_unlock(&snapshotMutex);
+
+	if (changed)
+		editor->requestRedraw();
+}
+
+/**
+ * Queues an editor command for the next simulation step. The queue takes
+ * ownership of the command.
+ * \param command the command to execute
+ **/
+void SimulationThread::post(SceneCommand *command)
+{
+	pthread_mutex_lock(&commandMutex);
+	commands->push_back(command);
+	pthread_mutex_unlock(&commandMutex);
+}
+
+/**
+ * Executes and deletes the queued commands in the order they were posted.
+ * Has to be called with the scene locked, also before deleting layers, so no
+ * command refers to a deleted object.
+ **/
+void SimulationThread::runCommands(void)
+{
+	vector<SceneCommand *> pending;
+
+	pthread_mutex_lock(&commandMutex);
+	pending.swap(*commands);
+	pthread_mutex_unlock(&commandMutex);
+
+	vector<SceneCommand *>::iterator c = pending.begin();
+	for (; c < pending.end(); c++)
+	{
+		(*c)->execute();
+		delete *c;
+	}
+}
+
+/**
+ * Returns the last published snapshot. The snapshot is not swapped until
+ * releaseSnapshot() is called, so this should be held for short.
+ * \return the front snapshot
+ **/
+SceneSnapshot *SimulationThread::acquireSnapshot(void)
+{
+	pthread_mutex_lock(&snapshotMutex);
+	return snapshots[front];
+}
+
+/**
+ * Releases the snapshot returned by acquireSnapshot().
+ **/
+void SimulationThread::releaseSnapshot(void)
+{
+	pthread_mutex_unlock(&snapshotMutex);
+}
+
+/**
+ * Forgets the captured layers. Has to be called with the scene locked when
+ * layers are deleted.
+ **/
+void SimulationThread::clearSnapshots(void)
+{
+	pthread_mutex_lock(&snapshotMutex);
+	snapshots[0]->clear();
+	snapshots[1]->clear();
+	pthread_mutex_unlock(&snapshotMutex);
+}
+
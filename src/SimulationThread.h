@@ -0,0 +1,109 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __SIMULATIONTHREAD_H__
+#define __SIMULATIONTHREAD_H__
+
+#include <pthread.h>
+#include <vector>
+
+#include "SceneSnapshot.h"
+
+using namespace std;
+
+namespace Animata
+{
+
+/// Edit of the scene posted by the editor and executed between two simulation steps.
+class SceneCommand
+{
+	public:
+		virtual ~SceneCommand() {}
+
+		/// Applies the edit, called with the scene locked.
+		virtual void execute(void) = 0;
+};
+
+/**
+ * Runs the spring model simulation in its own thread.
+ *
+ * Every step executes the posted editor commands, applies the queued OSC
+ * messages, simulates the skeletons, calculates the layer transformations
+ * and captures the result into the back snapshot with the scene locked. The snapshots are swapped afterwards,
+ * so the windows can project frame N while frame N+1 is being simulated.
+ * A redraw is requested when the new snapshot differs from the previous one.
+ *
+ * The steps are started by tick() on the frame grid of the FrameScheduler,
+ * so the simulation keeps the cadence of the drawn frames. Ticks arriving
+ * during a step are merged into one step.
+ **/
+class SimulationThread
+{
+	public:
+		SimulationThread();
+		~SimulationThread();
+
+		void start(void);
+		void stop(void);
+		void tick(void);
+
+		void post(SceneCommand *command);
+		void runCommands(void);
+
+		SceneSnapshot *acquireSnapshot(void);
+		void releaseSnapshot(void);
+		void clearSnapshots(void);
+
+		/// Returns the number of simulation steps done.
+		inline unsigned getFrame(void) { return frame; }
+
+	private:
+		/// Helper function to call class method threadTask() from a thread.
+		static void *threadFunc(void *p);
+		/// Runs the simulation steps until the thread is stopped.
+		void threadTask(void);
+
+		void step(void);
+
+		pthread_t thread;
+		volatile bool threadRunning;		///< true if the thread is running
+
+		pthread_mutex_t tickMutex;			///< protects \a ticked
+		pthread_cond_t tickCond;			///< signalled by tick()
+		bool ticked;						///< true if a step is due
+
+		pthread_mutex_t commandMutex;		///< protects the command queue
+		vector<SceneCommand *> *commands;	///< commands waiting for the next step
+
+		pthread_mutex_t snapshotMutex;		///< held while the front snapshot is read
+		SceneSnapshot *snapshots[2];		///< front and back snapshots
+		int front;							///< index of the front snapshot
+
+		unsigned frame;						///< number of steps done
+};
+
+} /* namespace Animata */
+
+#endif
+
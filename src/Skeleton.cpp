@@ -41,6 +41,9 @@ Skeleton::Skeleton()
 
 	bones = new vector<Bone *>;
 	pBone = NULL;
+
+	selectedJoints = new SelectionSet<Joint>;
+	selectedBones = new SelectionSet<Bone>;
 }
 
 /**
@@ -52,7 +55,12 @@ Skeleton::~Skeleton()
 	{
 		vector<Joint *>::iterator j = joints->begin();
 		for (; j < joints->end(); j++)
+		{
+			/* the name lookups of the editor must not find deleted joints */
+			if (ui) // FIXME: ui should not be NULL
+				ui->editorBox->deleteFromAllJoints(*j);
 			delete *j;	/* free joints from memory */
+		}
 		joints->clear(); /* clear all vector elements */
 		delete joints;
 	}
@@ -61,10 +69,17 @@ Skeleton::~Skeleton()
 	{
 		vector<Bone *>::iterator b = bones->begin();
 		for (; b < bones->end(); b++)
+		{
+			if (ui)
+				ui->editorBox->deleteFromAllBones(*b);
 			delete *b;	/* free bones from memory */
+		}
 		bones->clear(); /* clear all vector elements */
 		delete bones;
 	}
+
+	delete selectedJoints;
+	delete selectedBones;
 }
 
 /**
@@ -76,6 +91,7 @@ Skeleton::~Skeleton()
 Joint *Skeleton::addJoint(float x, float y)
 {
 	Joint *j = new Joint(x, y);
+	j->index = joints->size();
 	joints->push_back(j);
 
 	/* add to vector of all joints */
@@ -95,10 +111,11 @@ Bone *Skeleton::addBone(Joint *j0, Joint *j1)
 	if (j0 == j1)
 		return NULL;
 
-	/* check if a previous bone exists between these two joints */
-	for (unsigned i = 0; i < bones->size(); i++)
+	/* check if a previous bone exists between these two joints, it would be
+	 * one of the bones of the first joint */
+	for (unsigned i = 0; i < j0->bones.size(); i++)
 	{
-		Bone *bone = (*bones)[i];
+		Bone *bone = j0->bones[i];
 		if (((bone->j0 == j0) && (bone->j1 == j1)) ||
 			((bone->j0 == j1) && (bone->j1 == j0)))
 		{
@@ -108,7 +125,10 @@ Bone *Skeleton::addBone(Joint *j0, Joint *j1)
 
 	/* make a new bone */
 	Bone *b = new Bone(j0, j1);
+	b->index = bones->size();
 	bones->push_back(b);
+	j0->bones.push_back(b);
+	j1->bones.push_back(b);
 
 	/* add to vector of all bones */
 	if (ui) // FIXME: ui should not be NULL!
@@ -124,20 +144,14 @@ Bone *Skeleton::addBone(Joint *j0, Joint *j1)
  **/
 int Skeleton::moveSelectedJoints(float dx, float dy)
 {
-	int movedJoints = 0;
+	vector<Joint *> *selected = selectedJoints->getList();
 
-	for (unsigned i = 0; i < joints->size(); i++)
+	for (unsigned i = 0; i < selected->size(); i++)
 	{
-		Joint *j = (*joints)[i];
-
-		if (j->selected)
-		{
-			j->drag(dx, dy);
-			movedJoints++;
-		}
+		(*selected)[i]->drag(dx, dy);
 	}
 	/* return the number of joints moved */
-	return movedJoints;
+	return selected->size();
 }
 
 /**
@@ -157,26 +171,20 @@ void Skeleton::endMoveSelectedJoints(void)
  **/
 int Skeleton::moveSelectedBones(float dx, float dy)
 {
-	int movedBones = 0;
+	vector<Bone *> *selected = selectedBones->getList();
 
 	/* timeStamp to prevent joints moved twice if they belong to
 	 * multiple bones */
 	static int timeStamp = 0;
 
-	for (unsigned i = 0; i < bones->size(); i++)
+	for (unsigned i = 0; i < selected->size(); i++)
 	{
-		Bone *b = (*bones)[i];
-
-		if (b->selected)
-		{
-			b->drag(dx, dy, timeStamp);
-			movedBones++;
-		}
+		(*selected)[i]->drag(dx, dy, timeStamp);
 	}
 
 	timeStamp++;
 	/* return the number of bones moved */
-	return movedBones;
+	return selected->size();
 }
 
 /**
@@ -195,45 +203,44 @@ void Skeleton::endMoveSelectedBones(void)
  **/
 void Skeleton::setSelectedJointParameters(enum ANIMATA_PREFERENCES prefParam, void *value)
 {
-	for (unsigned i = 0; i < joints->size(); i++)
+	vector<Joint *> *selected = selectedJoints->getList();
+
+	for (unsigned i = 0; i < selected->size(); i++)
 	{
-		Joint *j = (*joints)[i];
+		Joint *j = (*selected)[i];
 
-		if (j->selected)
+		switch (prefParam)
 		{
-			switch (prefParam)
-			{
-				case PREFS_JOINT_NAME:
-					j->setName(*((const char **)value));
-					break;
-				case PREFS_JOINT_X:
-					j->x = *((float *)value);
-					break;
-				case PREFS_JOINT_Y:
-					j->y = *((float *)value);
-					break;
-				case PREFS_JOINT_FIXED:
-					j->fixed = *((int *)value);
-					break;
-				case PREFS_JOINT_OSC:
+			case PREFS_JOINT_NAME:
+				j->setName(*((const char **)value));
+				break;
+			case PREFS_JOINT_X:
+				j->x = *((float *)value);
+				break;
+			case PREFS_JOINT_Y:
+				j->y = *((float *)value);
+				break;
+			case PREFS_JOINT_FIXED:
+				j->fixed = *((int *)value);
+				break;
+			case PREFS_JOINT_OSC:
+				{
+					int osc = *((int *)value);
+					j->osc = osc;
+					// add or remove the joint from the vector of joints
+					// needed to be sent via OSC
+					if (osc)
 					{
-						int osc = *((int *)value);
-						j->osc = osc;
-						// add or remove the joint from the vector of joints
-						// needed to be sent via OSC
-						if (osc)
-						{
-							ui->editorBox->addToOSCJoints(j);
-						}
-						else
-						{
-							ui->editorBox->deleteFromOSCJoints(j);
-						}
-						break;
+						ui->editorBox->addToOSCJoints(j);
+					}
+					else
+					{
+						ui->editorBox->deleteFromOSCJoints(j);
 					}
-				default:
 					break;
-			}
+				}
+			default:
+				break;
 		}
 	}
 }
@@ -249,28 +256,27 @@ void Skeleton::setSelectedJointParameters(enum ANIMATA_PREFERENCES prefParam, vo
 void Skeleton::setSelectedBoneParameters(const char *str, float s, float lm, float aRad,
 		float falloff)
 {
-	for (unsigned i = 0; i < bones->size(); i++)
-	{
-		Bone *b = (*bones)[i];
+	vector<Bone *> *selected = selectedBones->getList();
 
-		if (b->selected)
+	for (unsigned i = 0; i < selected->size(); i++)
+	{
+		Bone *b = (*selected)[i];
+
+		if (s > FLT_EPSILON)
+			b->damp = s;
+		if (str)
+			b->setName(str);
+		if (lm >= 0)
+			b->setLengthMult(lm);
+		if (aRad < FLT_MAX)
+			b->setRadiusMult(aRad);
+		if (falloff < FLT_MAX)
 		{
-			if (s > FLT_EPSILON)
-				b->damp = s;
-			if (str)
-				b->setName(str);
-			if (lm >= 0)
-				b->setLengthMult(lm);
-			if (aRad < FLT_MAX)
-				b->setRadiusMult(aRad);
-			if (falloff < FLT_MAX)
-			{
-				b->setFalloff(falloff); // set new falloff value
-				// calculate new weights of attached vertices
-				// FIXME: should be calculated when the attach
-				// button is pressed
-				b->recalculateWeights();
-			}
+			b->setFalloff(falloff); // set new falloff value
+			// calculate new weights of attached vertices
+			// FIXME: should be calculated when the attach
+			// button is pressed
+			b->recalculateWeights();
 		}
 	}
 }
@@ -281,14 +287,13 @@ void Skeleton::setSelectedBoneParameters(const char *str, float s, float lm, flo
  **/
 void Skeleton::setSelectedBoneLengthMultMin(float p)
 {
-	for (unsigned i = 0; i < bones->size(); i++)
+	vector<Bone *> *selected = selectedBones->getList();
+
+	for (unsigned i = 0; i < selected->size(); i++)
 	{
-		Bone *b = (*bones)[i];
+		Bone *b = (*selected)[i];
 
-		if (b->selected)
-		{
-			b->setLengthMultMin(p);
-		}
+		b->setLengthMultMin(p);
 	}
 }
 
@@ -298,14 +303,13 @@ void Skeleton::setSelectedBoneLengthMultMin(float p)
  **/
 void Skeleton::setSelectedBoneLengthMultMax(float p)
 {
-	for (unsigned i = 0; i < bones->size(); i++)
+	vector<Bone *> *selected = selectedBones->getList();
+
+	for (unsigned i = 0; i < selected->size(); i++)
 	{
-		Bone *b = (*bones)[i];
+		Bone *b = (*selected)[i];
 
-		if (b->selected)
-		{
-			b->setLengthMultMax(p);
-		}
+		b->setLengthMultMax(p);
 	}
 }
 
@@ -315,14 +319,13 @@ void Skeleton::setSelectedBoneLengthMultMax(float p)
  **/
 void Skeleton::setSelectedBoneTempo(float p)
 {
-	for (unsigned i = 0; i < bones->size(); i++)
+	vector<Bone *> *selected = selectedBones->getList();
+
+	for (unsigned i = 0; i < selected->size(); i++)
 	{
-		Bone *b = (*bones)[i];
+		Bone *b = (*selected)[i];
 
-		if (b->selected)
-		{
-			b->setTempo(p);
-		}
+		b->setTempo(p);
 	}
 }
 
@@ -331,7 +334,7 @@ void Skeleton::setSelectedBoneTempo(float p)
  **/
 void Skeleton::deleteSelectedJoint(void)
 {
-	unsigned char hit = selector->getHitCount();
+	unsigned hit = selector->getHitCount();
 	SelectItem *selected = selector->getSelected();
 
 	/* select the joint from the selection buffer */
@@ -349,28 +352,23 @@ void Skeleton::deleteSelectedJoint(void)
 	if (selJoint == NULL) /* no joint below the cursor */
 		return;
 
-	/* if the selected joint is part of a bone, delete it -
-	 * checking vector elements backwards to be able to iterate and erase
-	 * at the same time */
-	for (int i = bones->size() - 1; i >= 0; i--)
-	{
-		Bone *bone = (*bones)[i];
-		if ((bone->j0 == selJoint) ||
-			(bone->j1 == selJoint))
-		{
-			vector<Bone *>::iterator boneIter = bones->begin() + i;
-			delete bone;
-			bones->erase(boneIter);
-		}
-	}
+	/* if the selected joint is part of a bone, delete it */
+	while (!selJoint->bones.empty())
+		removeBone(selJoint->bones.back());
 
-	/* delete the joint */
-	vector<Joint *>::iterator iter = joints->begin() + selected->name;
 	/* delete the joint from vector of all joints */
 	if (ui) // FIXME: ui should not be NULL
-		ui->editorBox->deleteFromAllJoints(*iter);
-	delete *iter; /* delete object */
-	joints->erase(iter); /* remove it from the vector */
+	{
+		ui->editorBox->deleteFromAllJoints(selJoint);
+		ui->editorBox->deleteFromOSCJoints(selJoint);
+	}
+	selectedJoints->remove(selJoint);
+	/* move the last joint to the place of the deleted one */
+	Joint *last = joints->back();
+	(*joints)[selJoint->index] = last;
+	last->index = selJoint->index;
+	joints->pop_back();
+	delete selJoint; /* delete object */
 	/* current selection points to the next joint after the deleted one */
 	selector->clearSelection();
 }
@@ -399,31 +397,53 @@ void Skeleton::deleteSelectedBone(void)
 		return;
 
 	/* delete the bone and references to it*/
-	vector<Bone *>::iterator iter = bones->begin() + selected->name;
-	/* delete the bone from vector of all bones */
-	if (ui) // FIXME: ui should not be NULL
-		ui->editorBox->deleteFromAllBones(*iter);
-	delete *iter; /* delete object */
-	bones->erase(iter); /* remove it from the vector */
+	removeBone(selBone);
 	/* clear selection, because it contains a non-existing object */
 	selector->clearSelection();
-
 }
 
 /**
- * Clears the selection of bones and joints.
+ * Removes a bone from the skeleton and deletes it. The last bone is moved
+ * to its place, so only the bones of its joints are searched.
+ * \param b pointer to the bone
  **/
-void Skeleton::clearSelection(void)
+void Skeleton::removeBone(Bone *b)
 {
-	for (unsigned i = 0; i < joints->size(); i++)
+	Joint *ends[2] = { b->j0, b->j1 };
+	for (int k = 0; k < 2; k++)
 	{
-		(*joints)[i]->selected = false;
+		vector<Bone *> *jointBones = &ends[k]->bones;
+		for (unsigned i = 0; i < jointBones->size(); i++)
+		{
+			if ((*jointBones)[i] == b)
+			{
+				(*jointBones)[i] = jointBones->back();
+				jointBones->pop_back();
+				break;
+			}
+		}
 	}
 
-	for (unsigned i = 0; i < bones->size(); i++)
-	{
-		(*bones)[i]->selected = false;
-	}
+	/* delete the bone from vector of all bones */
+	if (ui) // FIXME: ui should not be NULL
+		ui->editorBox->deleteFromAllBones(b);
+	selectedBones->remove(b);
+
+	Bone *last = bones->back();
+	(*bones)[b->index] = last;
+	last->index = b->index;
+	bones->pop_back();
+
+	delete b; /* the attached vertices are disattached by the destructor */
+}
+
+/**
+ * Clears the selection of bones and joints.
+ **/
+void Skeleton::clearSelection(void)
+{
+	selectedJoints->clear();
+	selectedBones->clear();
 }
 
 /**
@@ -433,22 +453,9 @@ void Skeleton::clearSelection(void)
  **/
 void Skeleton::attachVertices(vector<Vertex *> *verts)
 {
-	Bone *selectedBone = NULL;
-
-	int s = 0;
-	for (unsigned i = 0; i < bones->size(); i++)
-	{
-		if ((*bones)[i]->selected)
-		{
-			selectedBone = (*bones)[i];
-			s++;
-		}
-	}
-
-	if (s == 1)
+	if (selectedBones->size() == 1)
 	{
-		selectedBone->attachVertices(verts);
-		delete verts;
+		(*selectedBones->getList())[0]->attachVertices(verts);
 	}
 }
 
@@ -456,50 +463,44 @@ void Skeleton::attachVertices(vector<Vertex *> *verts)
  * Select vertices in bone range
  * if there are no attached vertices use circle selection
  * otherwise select attached vertices
- * \param mesh pointer to mesh
+ * This is called from the simulation thread too, so the range is tested in
+ * layer coordinates, not in the view coordinates written by the drawing.
+ * \param layer the layer of the skeleton
  **/
-void Skeleton::selectVerticesInRange(Mesh *mesh)
+void Skeleton::selectVerticesInRange(Layer *layer)
 {
-	mesh->clearSelection();
-	for (unsigned i = 0; i < bones->size(); i++)
+	layer->getMesh()->clearSelection();
+
+	vector<Bone *> *selected = selectedBones->getList();
+	for (unsigned i = 0; i < selected->size(); i++)
 	{
-		Bone *b = (*bones)[i];
+		Bone *b = (*selected)[i];
 
 		/* select vertices in selection circle only if there are no vertices
 		 * attached */
-		if (b->selected)
+		if (b->getAttachedVerticesCount() == 0)
 		{
-			if (b->getAttachedVerticesCount() == 0)
-			{
-				// selection happens in screen coordinate system, just like the drawSelectionBox in animata.cpp
-				// so get the view radius as in Bone.draw()
-				Vector2D v = b->getCenter();
-				// float r = b->getRadius();
-				float r = b->getViewRadius();
-				selector->doCircleSelect(mesh, Selection::SELECT_VERTEX,
-						(int)v.x, (int)v.y, (int)r);
-			}
-			else
-			{
-				b->selectAttachedVertices();
-			}
+			b->selectVerticesInRange(layer->getMesh());
+		}
+		else
+		{
+			b->selectAttachedVertices(layer->getMesh());
 		}
 	}
 }
 
 /**
- * Disattaches vertices from bone.
+ * Disattaches vertices from the selected bones.
+ * \param mesh the mesh of the vertices
  **/
-void Skeleton::disattachVertices(void)
+void Skeleton::disattachVertices(Mesh *mesh)
 {
-	for (unsigned i = 0; i < bones->size(); i++)
+	vector<Bone *> *selected = selectedBones->getList();
+	for (unsigned i = 0; i < selected->size(); i++)
 	{
-		Bone *b = (*bones)[i];
-		if (b->selected)
-		{
-			b->selectAttachedVertices(false); // clear selection
-			b->disattachVertices();
-		}
+		Bone *b = (*selected)[i];
+		b->selectAttachedVertices(mesh, false); // clear selection
+		b->disattachVertices();
 	}
 }
 
@@ -512,43 +513,31 @@ void Skeleton::disattachSelectedVertex(Vertex *v)
 	if (v == NULL) /* no vertex below the cursor */
 		return;
 
-	for (unsigned i = 0; i < bones->size(); i++)
-	{
-		(*bones)[i]->disattachVertex(v);
-	}
+	/* only the bones the vertex is attached to are asked */
+	while (!v->bones.empty())
+		v->bones.back()->disattachVertex(v);
 }
 
 /**
  * Sets the view coordinates of the joints of this skeleton.
- * Setting the transformation matrices by Transform::setMatrices() is neccesary before calling this,
- * because Transform::project() is used for non visible primitives.
+ * \param	vx	Array of the \e x screen coordinates, one for every joint in order.
+ * \param	vy	Array of the \e y screen coordinates, one for every joint in order.
+ * \sa Selection::doFeedback()
  **/
-void Skeleton::setJointViewCoords(float *coords, unsigned int size)
+void Skeleton::setJointViewCoords(float *vx, float *vy)
 {
-	for(unsigned i = 0; i < size; i+=3)
+	for(unsigned i = 0; i < joints->size(); i++)
 	{
-		unsigned n = (unsigned)coords[i];
-		Joint *j = (*joints)[n];
-
-		// joint is out of screen lets do projection here
-		if(i + 1 < size && coords[i + 1] == Selection::OUT_OF_SCREEN)
-		{
-			Vector3D view = Transform::project(j->x, j->y, 0);
+		Joint *j = (*joints)[i];
 
-			j->vx = view.x;
-			j->vy = view.y;
-		}
-		else
-		{
-			j->vx = coords[i + 1];
-			j->vy = coords[i + 2];
-		}
+		j->vx = vx[i];
+		j->vy = vy[i];
 	}
 }
 
 /**
  * Draws the skeleton.
- * \param mode bitmask of RENDER_WIREFRAME, RENDER_FEEDBACK or RENDER_OUTPUT, determines
+ * \param mode bitmask of RENDER_WIREFRAME or RENDER_OUTPUT, determines
  *		how the primitives are drawn.
  * \param active active state
  **/
@@ -611,19 +600,7 @@ void Skeleton::draw(int mode, int active)
 		glPopName();
 	}
 
-	if(mode & RENDER_FEEDBACK)
-	{
-		for (unsigned i = 0; i < joints->size(); i++)
-		{
-			Joint *joint = (*joints)[i];
-
-			glPassThrough(i);
-			glBegin(GL_POINTS);
-				glVertex2f(joint->x, joint->y);
-			glEnd();
-		}
-	}
-	else if ((mode & RENDER_WIREFRAME) &&
+	if ((mode & RENDER_WIREFRAME) &&
 			 ((!(mode & RENDER_OUTPUT) && ui->settings.display_elements & DISPLAY_EDITOR_JOINT) ||
 			 ((mode & RENDER_OUTPUT) && ui->settings.display_elements & DISPLAY_OUTPUT_JOINT)))
 	{
@@ -658,19 +635,18 @@ void Skeleton::select(unsigned i, int type)
 		case Selection::SELECT_JOINT:
 			if (i < joints->size())
 			{
-				(*joints)[i]->selected = true;
+				selectedJoints->add((*joints)[i]);
+			}
+			break;
+		case Selection::SELECT_BONE:
+			if (i < bones->size())
+			{
+				selectedBones->add((*bones)[i]);
 			}
 			break;
 	}
 }
 
-/**
- * Not implemented.
- **/
-void Skeleton::circleSelect(unsigned i, int type, int xc, int yc, float r)
-{
-}
-
 /**
  * Runs the simulation on joints and bones
  * \param times number of times to run the simulation
@@ -31,12 +31,15 @@
 #include "Joint.h"
 #include "Bone.h"
 #include "Preferences.h"
+#include "SelectionSet.h"
 
 using namespace std;
 
 namespace Animata
 {
 
+class Layer;
+
 /// Skeleton attached to the mesh
 class Skeleton : public ADrawable
 {
@@ -67,19 +70,27 @@ class Skeleton : public ADrawable
 
 		void clearSelection(void);
 
-		void setJointViewCoords(float *coords, unsigned int size);
+		/// Selects or deselects a joint of the skeleton.
+		inline void selectJoint(Joint *j, bool s = true) { selectedJoints->set(j, s); }
+		/// Selects or deselects a bone of the skeleton.
+		inline void selectBone(Bone *b, bool s = true) { selectedBones->set(b, s); }
+		/// Inverts the selection state of a joint.
+		inline void flipJointSelection(Joint *j) { selectedJoints->flip(j); }
+		/// Inverts the selection state of a bone.
+		inline void flipBoneSelection(Bone *b) { selectedBones->flip(b); }
+
+		void setJointViewCoords(float *vx, float *vy);
 
 		virtual void draw(int mode, int active = 1);
 		virtual void select(unsigned i, int type);
-		virtual void circleSelect(unsigned i, int type, int xc, int yc, float r);
 
 		void simulate(int times = 1);
 
 		void attachVertices(vector<Vertex *> *verts);
-		void disattachVertices(void);
+		void disattachVertices(Mesh *mesh);
 		void disattachSelectedVertex(Vertex *v);
 
-		void selectVerticesInRange(Mesh *mesh);
+		void selectVerticesInRange(Layer *layer);
 
 		/// Returns the joint below the mouse cursor.
 		inline Joint *getPointedJoint(void) { return pJoint; }
@@ -91,10 +102,20 @@ class Skeleton : public ADrawable
 		/// Returns skeleton bones.
 		inline vector<Bone *> *getBones(void) { return bones; }
 
+		/// Returns the selected joints in no particular order.
+		inline vector<Joint *> *getSelectedJoints(void) { return selectedJoints->getList(); }
+		/// Returns the selected bones in no particular order.
+		inline vector<Bone *> *getSelectedBones(void) { return selectedBones->getList(); }
+
 	private:
+		void removeBone(Bone *b);
+
 		vector<Joint *> *joints;
 		vector<Bone *> *bones;
 
+		SelectionSet<Joint> *selectedJoints;	///< selected joints
+		SelectionSet<Bone> *selectedBones;		///< selected bones
+
 		Joint	*pJoint;	/**< joint below the cursor */
 		Bone	*pBone;		/**< bone below the cursor */
 };
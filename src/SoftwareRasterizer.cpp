@@ -0,0 +1,429 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <math.h>
+#include <unistd.h>
+#include <algorithm>
+
+#if defined(__SSE2__)
+	#include <emmintrin.h>
+#endif
+
+#include "SoftwareRasterizer.h"
+
+using namespace Animata;
+
+/**
+ * Creates a rasterizer with an image of the given size.
+ * \param width width of the image
+ * \param height height of the image
+ * \param threads number of threads rasterizing the tiles, the number of
+ *	processors if 0
+ **/
+SoftwareRasterizer::SoftwareRasterizer(int width, int height,
+		int threads /* = 0 */)
+{
+	this->width = width;
+	this->height = height;
+
+	pixels = new unsigned char[width * height * 4];
+	clearColor[0] = clearColor[1] = clearColor[2] = clearColor[3] = 0;
+
+	tilesX = (width + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+	tilesY = (height + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+
+	triangles = new vector<RasterTriangle>;
+	bins = new vector<int>[tilesX * tilesY];
+
+	if (threads <= 0)
+		threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	threadCount = threads > 0 ? threads : 1;
+
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&startCond, NULL);
+	pthread_cond_init(&doneCond, NULL);
+	frame = 0;
+	nextTile = 0;
+	busyThreads = 0;
+	quit = false;
+
+	// the thread calling end() rasterizes tiles too
+	this->threads = new pthread_t[threadCount - 1];
+	for (int i = 0; i < threadCount - 1; i++)
+		pthread_create(&this->threads[i], NULL, &threadFunc, this);
+}
+
+SoftwareRasterizer::~SoftwareRasterizer()
+{
+	pthread_mutex_lock(&mutex);
+	quit = true;
+	pthread_cond_broadcast(&startCond);
+	pthread_mutex_unlock(&mutex);
+
+	for (int i = 0; i < threadCount - 1; i++)
+		pthread_join(threads[i], NULL);
+	delete [] threads;
+
+	pthread_cond_destroy(&doneCond);
+	pthread_cond_destroy(&startCond);
+	pthread_mutex_destroy(&mutex);
+
+	delete [] bins;
+	delete triangles;
+	delete [] pixels;
+}
+
+void *SoftwareRasterizer::threadFunc(void *p)
+{
+	static_cast<SoftwareRasterizer *>(p)->threadTask();
+	return 0;
+}
+
+void SoftwareRasterizer::threadTask(void)
+{
+	unsigned done = 0;
+
+	while (true)
+	{
+		pthread_mutex_lock(&mutex);
+		while ((frame == done) && !quit)
+			pthread_cond_wait(&startCond, &mutex);
+		if (quit)
+		{
+			pthread_mutex_unlock(&mutex);
+			break;
+		}
+		done = frame;
+		pthread_mutex_unlock(&mutex);
+
+		rasterizeTiles();
+
+		pthread_mutex_lock(&mutex);
+		busyThreads--;
+		pthread_cond_signal(&doneCond);
+		pthread_mutex_unlock(&mutex);
+	}
+}
+
+/**
+ * Starts a new frame. The image is cleared to the given colour by end().
+ **/
+void SoftwareRasterizer::begin(unsigned char r /* = 0 */,
+		unsigned char g /* = 0 */, unsigned char b /* = 0 */,
+		unsigned char a /* = 0 */)
+{
+	clearColor[0] = r;
+	clearColor[1] = g;
+	clearColor[2] = b;
+	clearColor[3] = a;
+
+	triangles->clear();
+	for (int i = 0; i < tilesX * tilesY; i++)
+		bins[i].clear();
+}
+
+/**
+ * Adds a textured triangle to the frame. Pixels are covered if their centre
+ * is inside the triangle, pixels on a shared edge are drawn only once.
+ * \param v0 first corner of the triangle
+ * \param v1 second corner of the triangle
+ * \param v2 third corner of the triangle
+ * \param texture the texture of the triangle
+ * \param alpha the alpha the texels are multiplied by
+ **/
+void SoftwareRasterizer::addTriangle(RasterVertex *v0, RasterVertex *v1,
+		RasterVertex *v2, Texture *texture, float alpha)
+{
+	float area = (v1->x - v0->x) * (v2->y - v0->y) -
+		(v2->x - v0->x) * (v1->y - v0->y);
+	if ((fabs(area) < 1e-6f) || (alpha <= 0))
+		return;
+
+	// make the triangle counter-clockwise
+	if (area < 0)
+	{
+		RasterVertex *v = v1;
+		v1 = v2;
+		v2 = v;
+		area = -area;
+	}
+
+	RasterTriangle tri;
+
+	tri.minX = max((int)floor(min(v0->x, min(v1->x, v2->x))), 0);
+	tri.minY = max((int)floor(min(v0->y, min(v1->y, v2->y))), 0);
+	tri.maxX = min((int)ceil(max(v0->x, max(v1->x, v2->x))), width);
+	tri.maxY = min((int)ceil(max(v0->y, max(v1->y, v2->y))), height);
+	if ((tri.minX >= tri.maxX) || (tri.minY >= tri.maxY))
+		return;
+
+	// edge i is opposite to corner i, its edge function divided by the area
+	// is the barycentric weight of the corner
+	RasterVertex *v[3] = { v0, v1, v2 };
+	for (int i = 0; i < 3; i++)
+	{
+		RasterVertex *a = v[(i + 1) % 3];
+		RasterVertex *b = v[(i + 2) % 3];
+		float ex = b->x - a->x;
+		float ey = b->y - a->y;
+
+		tri.a[i] = -ey / area;
+		tri.b[i] = ex / area;
+		tri.c[i] = (ey * a->x - ex * a->y) / area;
+
+		// pixel centres exactly on an edge belong to the triangle on the
+		// left or top side of it
+		tri.topLeft[i] = (ey < 0) || ((ey == 0) && (ex > 0));
+	}
+
+	for (int j = 0; j < 3; j++)
+	{
+		tri.ds[j] = tri.dt[j] = 0;
+		for (int i = 0; i < 3; i++)
+		{
+			float e = (j == 0) ? tri.a[i] : ((j == 1) ? tri.b[i] : tri.c[i]);
+			tri.ds[j] += e * v[i]->s;
+			tri.dt[j] += e * v[i]->t;
+		}
+	}
+
+	tri.texture = texture;
+	tri.alpha = alpha;
+
+	int index = triangles->size();
+	triangles->push_back(tri);
+
+	for (int ty = tri.minY / RASTER_TILE_SIZE;
+			ty <= (tri.maxY - 1) / RASTER_TILE_SIZE; ty++)
+	{
+		for (int tx = tri.minX / RASTER_TILE_SIZE;
+				tx <= (tri.maxX - 1) / RASTER_TILE_SIZE; tx++)
+			bins[ty * tilesX + tx].push_back(index);
+	}
+}
+
+/**
+ * Rasterizes the triangles of the frame and returns when the image is
+ * complete.
+ **/
+void SoftwareRasterizer::end(void)
+{
+	pthread_mutex_lock(&mutex);
+	frame++;
+	nextTile = 0;
+	busyThreads = threadCount - 1;
+	pthread_cond_broadcast(&startCond);
+	pthread_mutex_unlock(&mutex);
+
+	rasterizeTiles();
+
+	pthread_mutex_lock(&mutex);
+	while (busyThreads > 0)
+		pthread_cond_wait(&doneCond, &mutex);
+	pthread_mutex_unlock(&mutex);
+}
+
+/**
+ * Takes tiles of the frame and rasterizes them until no tile is left.
+ **/
+void SoftwareRasterizer::rasterizeTiles(void)
+{
+	int tileCount = tilesX * tilesY;
+
+	while (true)
+	{
+		pthread_mutex_lock(&mutex);
+		int tile = nextTile++;
+		pthread_mutex_unlock(&mutex);
+
+		if (tile >= tileCount)
+			break;
+
+		rasterizeTile(tile);
+	}
+}
+
+/**
+ * Clears a tile, and draws the triangles touching it in their order.
+ * \param tile index of the tile
+ **/
+void SoftwareRasterizer::rasterizeTile(int tile)
+{
+	int x0 = (tile % tilesX) * RASTER_TILE_SIZE;
+	int y0 = (tile / tilesX) * RASTER_TILE_SIZE;
+	int x1 = min(x0 + RASTER_TILE_SIZE, width);
+	int y1 = min(y0 + RASTER_TILE_SIZE, height);
+
+	for (int y = y0; y < y1; y++)
+	{
+		unsigned char *p = pixels + (y * width + x0) * 4;
+		for (int x = x0; x < x1; x++, p += 4)
+		{
+			p[0] = clearColor[0];
+			p[1] = clearColor[1];
+			p[2] = clearColor[2];
+			p[3] = clearColor[3];
+		}
+	}
+
+	vector<int> *bin = &bins[tile];
+	for (unsigned i = 0; i < bin->size(); i++)
+	{
+		RasterTriangle *tri = &(*triangles)[(*bin)[i]];
+		rasterizeTriangle(tri, max(x0, tri->minX), max(y0, tri->minY),
+				min(x1, tri->maxX), min(y1, tri->maxY));
+	}
+}
+
+/**
+ * Draws the part of a triangle inside a rectangle of the image. The edge
+ * functions are evaluated for four pixels at once where SSE2 is available.
+ * \param tri the triangle to draw
+ * \param x0 left side of the rectangle
+ * \param y0 bottom side of the rectangle
+ * \param x1 right side of the rectangle, exclusive
+ * \param y1 top side of the rectangle, exclusive
+ **/
+void SoftwareRasterizer::rasterizeTriangle(RasterTriangle *tri,
+		int x0, int y0, int x1, int y1)
+{
+#if defined(__SSE2__)
+	__m128 zero = _mm_setzero_ps();
+	__m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, .5f);
+	__m128 ea[3], tl[3];
+	for (int i = 0; i < 3; i++)
+	{
+		ea[i] = _mm_set1_ps(tri->a[i]);
+		tl[i] = _mm_castsi128_ps(_mm_set1_epi32(tri->topLeft[i] ? -1 : 0));
+	}
+#endif
+
+	for (int y = y0; y < y1; y++)
+	{
+		float py = y + .5f;
+		unsigned char *row = pixels + y * width * 4;
+
+		for (int x = x0; x < x1; x += 4)
+		{
+			int mask = 0;
+
+#if defined(__SSE2__)
+			__m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int i = 0; i < 3; i++)
+			{
+				__m128 w = _mm_add_ps(_mm_mul_ps(ea[i], px),
+						_mm_set1_ps(tri->b[i] * py + tri->c[i]));
+				__m128 covered = _mm_or_ps(_mm_cmpgt_ps(w, zero),
+						_mm_and_ps(_mm_cmpeq_ps(w, zero), tl[i]));
+				inside = _mm_and_ps(inside, covered);
+			}
+			mask = _mm_movemask_ps(inside);
+#else
+			for (int k = 0; k < 4; k++)
+			{
+				float px = x + k + .5f;
+				bool inside = true;
+				for (int i = 0; i < 3; i++)
+				{
+					float w = tri->a[i] * px + tri->b[i] * py + tri->c[i];
+					if ((w < 0) || ((w == 0) && !tri->topLeft[i]))
+						inside = false;
+				}
+				if (inside)
+					mask |= 1 << k;
+			}
+#endif
+
+			for (int k = 0; (k < 4) && (x + k < x1); k++)
+			{
+				if (!(mask & (1 << k)))
+					continue;
+
+				float px = x + k + .5f;
+				float s = tri->ds[0] * px + tri->ds[1] * py + tri->ds[2];
+				float t = tri->dt[0] * px + tri->dt[1] * py + tri->dt[2];
+
+				float rgba[4];
+				sample(tri->texture, s, t, rgba);
+
+				// blended like glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA)
+				unsigned char *p = row + (x + k) * 4;
+				float a = rgba[3] * tri->alpha;
+				for (int c = 0; c < 3; c++)
+					p[c] = (unsigned char)(rgba[c] * 255.f * a + p[c] * (1.f - a) + .5f);
+				p[3] = (unsigned char)(a * 255.f + p[3] * (1.f - a) + .5f);
+			}
+		}
+	}
+}
+
+/**
+ * Samples a texture bilinearly like \c GL_LINEAR. The coordinates are
+ * clamped to the edge of the texture.
+ * \param texture the texture to sample
+ * \param s horizontal texture coordinate
+ * \param t vertical texture coordinate
+ * \param rgba the colour between 0 and 1 is returned here
+ **/
+void SoftwareRasterizer::sample(Texture *texture, float s, float t, float *rgba)
+{
+	int w = texture->getWidth();
+	int h = texture->getHeight();
+	int d = texture->getDepth();
+	unsigned char *data = texture->getData();
+
+	float u = s * w - .5f;
+	float v = t * h - .5f;
+	int x0 = (int)floor(u);
+	int y0 = (int)floor(v);
+	float fx = u - x0;
+	float fy = v - y0;
+
+	int x1 = min(max(x0 + 1, 0), w - 1);
+	int y1 = min(max(y0 + 1, 0), h - 1);
+	x0 = min(max(x0, 0), w - 1);
+	y0 = min(max(y0, 0), h - 1);
+
+	unsigned char *t00 = data + (y0 * w + x0) * d;
+	unsigned char *t10 = data + (y0 * w + x1) * d;
+	unsigned char *t01 = data + (y1 * w + x0) * d;
+	unsigned char *t11 = data + (y1 * w + x1) * d;
+
+	float w00 = (1 - fx) * (1 - fy);
+	float w10 = fx * (1 - fy);
+	float w01 = (1 - fx) * fy;
+	float w11 = fx * fy;
+
+	for (int c = 0; c < 3; c++)
+		rgba[c] = (t00[c] * w00 + t10[c] * w10 + t01[c] * w01 +
+			t11[c] * w11) / 255.f;
+
+	if (d == 4)
+		rgba[3] = (t00[3] * w00 + t10[3] * w10 + t01[3] * w01 +
+			t11[3] * w11) / 255.f;
+	else
+		rgba[3] = 1.f;
+}
+
@@ -0,0 +1,140 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __SOFTWARERASTERIZER_H__
+#define __SOFTWARERASTERIZER_H__
+
+#include <pthread.h>
+#include <vector>
+
+#include "Texture.h"
+
+/// width and height of the tiles rasterized by one thread at a time
+#define RASTER_TILE_SIZE 64
+
+using namespace std;
+
+namespace Animata
+{
+
+/// Corner of a triangle drawn by the SoftwareRasterizer.
+struct RasterVertex
+{
+	float x;	///< \e x window coordinate
+	float y;	///< \e y window coordinate, from the bottom of the image
+	float s;	///< horizontal texture coordinate, between 0 and 1
+	float t;	///< vertical texture coordinate, between 0 and 1
+};
+
+/// Triangle set up for rasterization.
+struct RasterTriangle
+{
+	float a[3];			///< \e x coefficients of the edge functions
+	float b[3];			///< \e y coefficients of the edge functions
+	float c[3];			///< constants of the edge functions
+	bool topLeft[3];	///< true if pixels exactly on the edge are covered
+
+	float ds[3];		///< plane equation of the \e s coordinate
+	float dt[3];		///< plane equation of the \e t coordinate
+
+	int minX;			///< bounding box of the triangle in pixels
+	int minY;
+	int maxX;
+	int maxY;
+
+	Texture *texture;	///< the texture of the triangle
+	float alpha;		///< the alpha the texels are multiplied by
+};
+
+/**
+ * Draws textured triangles into an RGBA image on the CPU, the same way
+ * Mesh::draw() does with OpenGL. The texels are sampled bilinearly and
+ * blended over the image by their alpha multiplied by the alpha of the layer.
+ *
+ * The triangles of a frame are collected between begin() and end(). end()
+ * sorts them into tiles, and the tiles are rasterized in parallel by a pool
+ * of threads. The triangles of a tile are drawn in the order they were added,
+ * so the blending is the same as with a single thread.
+ *
+ * The rows of the image are stored from the bottom like in OpenGL.
+ **/
+class SoftwareRasterizer
+{
+	public:
+		SoftwareRasterizer(int width, int height, int threads = 0);
+		~SoftwareRasterizer();
+
+		void begin(unsigned char r = 0, unsigned char g = 0,
+				unsigned char b = 0, unsigned char a = 0);
+		void addTriangle(RasterVertex *v0, RasterVertex *v1, RasterVertex *v2,
+				Texture *texture, float alpha);
+		void end(void);
+
+		/// Returns the pixels of the image, 4 bytes each, bottom row first.
+		inline unsigned char *getPixels(void) { return pixels; }
+		/// Returns the width of the image.
+		inline int getWidth(void) { return width; }
+		/// Returns the height of the image.
+		inline int getHeight(void) { return height; }
+		/// Returns the number of rasterizer threads.
+		inline int getThreadCount(void) { return threadCount; }
+
+	private:
+		/// Helper function to call class method threadTask() from a thread.
+		static void *threadFunc(void *p);
+		/// Rasterizes the tiles of each frame until the rasterizer is deleted.
+		void threadTask(void);
+
+		void rasterizeTiles(void);
+		void rasterizeTile(int tile);
+		void rasterizeTriangle(RasterTriangle *tri, int x0, int y0, int x1, int y1);
+
+		static void sample(Texture *texture, float s, float t, float *rgba);
+
+		int width;				///< width of the image
+		int height;				///< height of the image
+		unsigned char *pixels;	///< RGBA pixels of the image
+		unsigned char clearColor[4];	///< colour the tiles are cleared to
+
+		int tilesX;				///< number of tile columns
+		int tilesY;				///< number of tile rows
+
+		vector<RasterTriangle> *triangles;	///< triangles of the frame
+		vector<int> *bins;		///< indices of the triangles touching each tile
+
+		int threadCount;		///< number of threads rasterizing the tiles
+		pthread_t *threads;		///< the rasterizer threads beside the caller
+		pthread_mutex_t mutex;	///< protects the frame state below
+		pthread_cond_t startCond;	///< signalled when a frame is started
+		pthread_cond_t doneCond;	///< signalled when a thread has finished
+		unsigned frame;			///< number of frames started
+		int nextTile;			///< next tile to be rasterized
+		int busyThreads;		///< threads still rasterizing the frame
+		bool quit;				///< true if the threads have to exit
+};
+
+} /* namespace Animata */
+
+#endif
+
@@ -30,6 +30,8 @@
 
 using namespace Animata;
 
+bool Texture::offline = false;
+
 /**
  * Creates a new texture object with default parameters from the given image parameters.
  * \param	filename		A string which points to the imagefile.
@@ -58,18 +60,13 @@ Texture::Texture(const char *filename, int w, int h, int d, unsigned char* p, in
 	x = y = 0.f;
 	scale = 1.f;
 
+	atlasResource = 0;
+	atlasS = atlasT = 0.f;
+	atlasW = atlasH = 1.f;
+
 	if(!reuseResource)
 	{
-		// required because the data isnt padded at the end of each texel row
-		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-
-		glGenTextures(1, &glResource);
-		glBindTexture(GL_TEXTURE_2D, glResource);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, sWrap);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, tWrap);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, minFilter);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, magFilter);
-		gluBuild2DMipmaps(GL_TEXTURE_2D, depth, width, height, d == 3 ? GL_RGB : GL_RGBA, GL_UNSIGNED_BYTE, data);
+		upload();
 	}
 	else
 	{
@@ -77,12 +74,74 @@ Texture::Texture(const char *filename, int w, int h, int d, unsigned char* p, in
 	}
 }
 
+/**
+ * Creates the standalone OpenGL resource of the texture from its pixel data.
+ */
+void Texture::upload(void)
+{
+	if (offline)
+	{
+		glResource = 0;
+		return;
+	}
+
+	// required because the data isnt padded at the end of each texel row
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	glGenTextures(1, &glResource);
+	glBindTexture(GL_TEXTURE_2D, glResource);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, sWrap);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, tWrap);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, minFilter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, magFilter);
+	gluBuild2DMipmaps(GL_TEXTURE_2D, depth, width, height, depth == 3 ? GL_RGB : GL_RGBA, GL_UNSIGNED_BYTE, data);
+}
+
+/**
+ * Moves the texture to a region of an atlas page. The standalone OpenGL
+ * resource of the texture is freed.
+ * \param	page	OpenGL resource of the atlas page.
+ * \param	s		Left texture coordinate of the region on the page.
+ * \param	t		Top texture coordinate of the region on the page.
+ * \param	w		Width of the region in texture coordinates.
+ * \param	h		Height of the region in texture coordinates.
+ */
+void Texture::setAtlasRegion(GLuint page, float s, float t, float w, float h)
+{
+	if (glResource)
+	{
+		glDeleteTextures(1, &glResource);
+		glResource = 0;
+	}
+
+	atlasResource = page;
+	atlasS = s;
+	atlasT = t;
+	atlasW = w;
+	atlasH = h;
+}
+
+/**
+ * Removes the texture from its atlas page, and creates its standalone
+ * OpenGL resource again if needed.
+ */
+void Texture::clearAtlasRegion(void)
+{
+	atlasResource = 0;
+	atlasS = atlasT = 0.f;
+	atlasW = atlasH = 1.f;
+
+	if (glResource == 0)
+		upload();
+}
+
 /**
  * Frees up the OpenGL resource created for this texture.
  */
 Texture::~Texture()
 {
-	glDeleteTextures(1, &glResource);
+	if (glResource)
+		glDeleteTextures(1, &glResource);
 }
 
 /**
@@ -181,7 +240,7 @@ int Texture::getTriangleAlpha(float x0, float y0, float x1, float y1,
  */
 void Texture::draw(int mouseOver)
 {
-	glBindTexture(GL_TEXTURE_2D, glResource);
+	glBindTexture(GL_TEXTURE_2D, getGlResource());
 
 /*
 	if(mouseOver)
@@ -222,10 +281,10 @@ void Texture::draw(int mouseOver)
 	}
 
 	glBegin(GL_QUADS);
-		glTexCoord2f(0.f, 0.f); glVertex2f(viewTopLeft.x, viewTopLeft.y);
-		glTexCoord2f(1.f, 0.f); glVertex2f(viewBottomRight.x, viewTopLeft.y);
-		glTexCoord2f(1.f, 1.f); glVertex2f(viewBottomRight.x, viewBottomRight.y);
-		glTexCoord2f(0.f, 1.f); glVertex2f(viewTopLeft.x, viewBottomRight.y);
+		glTexCoord2f(mapS(0.f), mapT(0.f)); glVertex2f(viewTopLeft.x, viewTopLeft.y);
+		glTexCoord2f(mapS(1.f), mapT(0.f)); glVertex2f(viewBottomRight.x, viewTopLeft.y);
+		glTexCoord2f(mapS(1.f), mapT(1.f)); glVertex2f(viewBottomRight.x, viewBottomRight.y);
+		glTexCoord2f(mapS(0.f), mapT(1.f)); glVertex2f(viewTopLeft.x, viewBottomRight.y);
 	glEnd();
 // */
 
@@ -46,7 +46,13 @@ class Texture
 
 		float			scale;			///< scale multiplier for the size
 
-		GLuint			glResource;		///< OpenGL resource of the texture
+		GLuint			glResource;		///< OpenGL resource of the texture, 0 if the texture is in an atlas
+
+		GLuint			atlasResource;	///< OpenGL resource of the atlas page holding the texture, 0 if standalone
+		float			atlasS;			///< left texture coordinate of the texture on the atlas page
+		float			atlasT;			///< top texture coordinate of the texture on the atlas page
+		float			atlasW;			///< width of the texture on the atlas page in texture coordinates
+		float			atlasH;			///< height of the texture on the atlas page in texture coordinates
 
 		int				sWrap;			///< \c GL_TEXTURE_WRAP_S OpenGL parameter
 		int				tWrap;			///< \c GL_TEXTURE_WRAP_T OpenGL parameter
@@ -58,6 +64,10 @@ class Texture
 
 		int getTexelAlpha(float x, float y);
 
+		void upload(void);
+
+		static bool offline;			///< true if no OpenGL resources are created for the textures
+
 	public:
 
 		static const int BORDER = 0;	///< size of the border around the texture when mouse over
@@ -110,10 +120,63 @@ class Texture
 		 */
 		inline int getHeight() { return height; }
 		/**
-		 * Returns the OpenGL resource which holds the texture.
+		 * Returns colour depth of the texture.
+		 * \retval	int	Number of bytes per pixel.
+		 */
+		inline int getDepth() { return depth; }
+		/**
+		 * Returns the OpenGL resource which holds the texture. This is the
+		 * atlas page if the texture is packed into an atlas.
 		 * \retval	GLuint	OpenGL resource that represent the texture.
 		 */
-		inline GLuint getGlResource() { return glResource; }
+		inline GLuint getGlResource() { return atlasResource ? atlasResource : glResource; }
+
+		/**
+		 * Keeps the textures created from now on in memory only, without
+		 * creating OpenGL resources for them. Used when rendering without
+		 * an OpenGL context.
+		 * \param	o	True to create no OpenGL resources.
+		 */
+		static inline void setOffline(bool o) { offline = o; }
+		/**
+		 * Returns true if no OpenGL resources are created for the textures.
+		 * \retval	bool	True if the textures are kept in memory only.
+		 */
+		static inline bool isOffline() { return offline; }
+
+		void setAtlasRegion(GLuint page, float s, float t, float w, float h);
+		void clearAtlasRegion(void);
+
+		/**
+		 * Returns true if the texture is packed into an atlas page.
+		 * \retval	bool	True if the texture is in an atlas.
+		 */
+		inline bool isInAtlas() { return atlasResource != 0; }
+
+		/**
+		 * Maps a horizontal texture coordinate to the resource returned by
+		 * getGlResource(). Coordinates are clamped to the texture edge in
+		 * an atlas, so neighbouring textures are not sampled.
+		 * \param	s	Texture coordinate in the texture.
+		 * \retval	float	Texture coordinate in the resource.
+		 */
+		inline float mapS(float s)
+		{
+			return atlasResource ?
+				atlasS + (s < 0.f ? 0.f : (s > 1.f ? 1.f : s)) * atlasW : s;
+		}
+		/**
+		 * Maps a vertical texture coordinate to the resource returned by
+		 * getGlResource().
+		 * \param	t	Texture coordinate in the texture.
+		 * \retval	float	Texture coordinate in the resource.
+		 * \sa mapS()
+		 */
+		inline float mapT(float t)
+		{
+			return atlasResource ?
+				atlasT + (t < 0.f ? 0.f : (t > 1.f ? 1.f : t)) * atlasH : t;
+		}
 
 		/**
 		 * Returns the filename from which the texture was created.
@@ -0,0 +1,329 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#if defined(__APPLE__)
+	#include <OPENGL/glu.h>
+#else
+	#include <GL/glu.h>
+#endif
+
+#include "TextureAtlas.h"
+
+using namespace Animata;
+
+/**
+ * Creates an empty atlas page.
+ * \param size maximum width and height of the page
+ **/
+AtlasPage::AtlasPage(int size)
+{
+	width = height = size;
+	usedWidth = usedHeight = 0;
+	glResource = 0;
+
+	SkylineNode node = { 0, 0, size };
+	skyline.push_back(node);
+}
+
+AtlasPage::~AtlasPage()
+{
+	if (glResource)
+		glDeleteTextures(1, &glResource);
+}
+
+/**
+ * Checks if a rectangle fits on the skyline starting at the given segment.
+ * \param i index of the first skyline segment under the rectangle
+ * \param w width of the rectangle
+ * \param h height of the rectangle
+ * \param y returns the top of the rectangle
+ * \return true if the rectangle fits on the page
+ **/
+bool AtlasPage::fit(unsigned i, int w, int h, int *y)
+{
+	int x = skyline[i].x;
+	if (x + w > width)
+		return false;
+
+	int widthLeft = w;
+	*y = skyline[i].y;
+	while (widthLeft > 0)
+	{
+		*y = max(*y, skyline[i].y);
+		if (*y + h > height)
+			return false;
+		widthLeft -= skyline[i].width;
+		i++;
+	}
+	return true;
+}
+
+/**
+ * Places a texture with padding on the page at the lowest possible position.
+ * \param t the texture to place
+ * \return true if the texture has been placed, false if the page is full
+ **/
+bool AtlasPage::insert(Texture *t)
+{
+	int w = t->getWidth() + 2 * ATLAS_PADDING;
+	int h = t->getHeight() + 2 * ATLAS_PADDING;
+
+	int bestIndex = -1;
+	int bestBottom = height + 1;
+	int bestWidth = width + 1;
+	int bestY = 0;
+	for (unsigned i = 0; i < skyline.size(); i++)
+	{
+		int y;
+		if (fit(i, w, h, &y))
+		{
+			if ((y + h < bestBottom) ||
+				((y + h == bestBottom) && (skyline[i].width < bestWidth)))
+			{
+				bestIndex = i;
+				bestBottom = y + h;
+				bestWidth = skyline[i].width;
+				bestY = y;
+			}
+		}
+	}
+
+	if (bestIndex < 0)
+		return false;
+
+	AtlasPlacement p = { t, skyline[bestIndex].x, bestY };
+	placements.push_back(p);
+
+	usedWidth = max(usedWidth, p.x + w);
+	usedHeight = max(usedHeight, p.y + h);
+
+	// raise the skyline under the new rectangle
+	SkylineNode node = { p.x, p.y + h, w };
+	skyline.insert(skyline.begin() + bestIndex, node);
+
+	for (unsigned i = bestIndex + 1; i < skyline.size(); i++)
+	{
+		SkylineNode *prev = &skyline[i - 1];
+		int shrink = prev->x + prev->width - skyline[i].x;
+		if (shrink <= 0)
+			break;
+
+		skyline[i].x += shrink;
+		skyline[i].width -= shrink;
+		if (skyline[i].width > 0)
+			break;
+
+		skyline.erase(skyline.begin() + i);
+		i--;
+	}
+
+	// merge segments of the same height
+	for (unsigned i = 0; i + 1 < skyline.size(); i++)
+	{
+		if (skyline[i].y == skyline[i + 1].y)
+		{
+			skyline[i].width += skyline[i + 1].width;
+			skyline.erase(skyline.begin() + i + 1);
+			i--;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Copies the placed textures to the page, uploads it as a mipmapped OpenGL
+ * texture and moves the textures to their regions on the page.
+ * The page is shrunk to the smallest power of two covering the textures.
+ **/
+void AtlasPage::upload(void)
+{
+	int w = 1;
+	while (w < usedWidth)
+		w <<= 1;
+	int h = 1;
+	while (h < usedHeight)
+		h <<= 1;
+
+	unsigned char *pixels = new unsigned char[w * h * 4];
+	memset(pixels, 0, w * h * 4);
+
+	for (unsigned i = 0; i < placements.size(); i++)
+	{
+		Texture *t = placements[i].texture;
+		unsigned char *data = t->getData();
+		int depth = t->getDepth();
+		int tw = t->getWidth();
+		int th = t->getHeight();
+
+		// the padding repeats the edge texels of the texture
+		for (int y = -ATLAS_PADDING; y < th + ATLAS_PADDING; y++)
+		{
+			int sy = min(max(y, 0), th - 1);
+			unsigned char *dst = pixels +
+				((placements[i].y + ATLAS_PADDING + y) * w +
+				 placements[i].x) * 4;
+
+			for (int x = -ATLAS_PADDING; x < tw + ATLAS_PADDING; x++)
+			{
+				int sx = min(max(x, 0), tw - 1);
+				unsigned char *src = data + (sy * tw + sx) * depth;
+
+				dst[0] = src[0];
+				dst[1] = src[1];
+				dst[2] = src[2];
+				dst[3] = (depth == 4) ? src[3] : 255;
+				dst += 4;
+			}
+		}
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	glGenTextures(1, &glResource);
+	glBindTexture(GL_TEXTURE_2D, glResource);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	gluBuild2DMipmaps(GL_TEXTURE_2D, 4, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+	delete [] pixels;
+
+	for (unsigned i = 0; i < placements.size(); i++)
+	{
+		Texture *t = placements[i].texture;
+		t->setAtlasRegion(glResource,
+				(float)(placements[i].x + ATLAS_PADDING) / w,
+				(float)(placements[i].y + ATLAS_PADDING) / h,
+				(float)t->getWidth() / w, (float)t->getHeight() / h);
+	}
+}
+
+TextureAtlas::TextureAtlas()
+{
+	pages = new vector<AtlasPage *>;
+}
+
+TextureAtlas::~TextureAtlas()
+{
+	vector<AtlasPage *>::iterator p = pages->begin();
+	for (; p < pages->end(); p++)
+		delete *p;
+	delete pages;
+}
+
+/// Sorts textures by decreasing height for packing.
+static bool textureHeightPredicate(Texture *a, Texture *b)
+{
+	return a->getHeight() > b->getHeight();
+}
+
+/**
+ * Packs the textures into new atlas pages, and frees the previous pages.
+ * Textures too big for the atlas, or alone on a page, stay standalone.
+ * \param textures the textures to pack
+ **/
+void TextureAtlas::build(vector<Texture *> *textures)
+{
+	GLint maxSize;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+	int pageSize = min((int)maxSize, ATLAS_PAGE_SIZE);
+
+	vector<Texture *> packable;
+	vector<Texture *> standalone;
+	for (unsigned i = 0; i < textures->size(); i++)
+	{
+		Texture *t = (*textures)[i];
+		if ((t->getData() != NULL) &&
+			((t->getDepth() == 3) || (t->getDepth() == 4)) &&
+			(t->getWidth() <= ATLAS_MAX_IMAGE_SIZE) &&
+			(t->getHeight() <= ATLAS_MAX_IMAGE_SIZE) &&
+			(t->getWidth() + 2 * ATLAS_PADDING <= pageSize) &&
+			(t->getHeight() + 2 * ATLAS_PADDING <= pageSize))
+			packable.push_back(t);
+		else
+			standalone.push_back(t);
+	}
+
+	stable_sort(packable.begin(), packable.end(), textureHeightPredicate);
+
+	vector<AtlasPage *> *newPages = new vector<AtlasPage *>;
+	for (unsigned i = 0; i < packable.size(); i++)
+	{
+		unsigned p;
+		for (p = 0; p < newPages->size(); p++)
+		{
+			if ((*newPages)[p]->insert(packable[i]))
+				break;
+		}
+
+		if (p == newPages->size())
+		{
+			AtlasPage *page = new AtlasPage(pageSize);
+			page->insert(packable[i]);
+			newPages->push_back(page);
+		}
+	}
+
+	// a page with a single texture would not save anything
+	int packed = 0;
+	vector<AtlasPage *>::iterator p = newPages->begin();
+	while (p < newPages->end())
+	{
+		if ((*p)->getTextureCount() > 1)
+		{
+			(*p)->upload();
+			packed += (*p)->getTextureCount();
+			p++;
+		}
+		else
+		{
+			standalone.push_back((*p)->getTexture(0));
+			delete *p;
+			p = newPages->erase(p);
+		}
+	}
+
+	for (unsigned i = 0; i < standalone.size(); i++)
+	{
+		if (standalone[i]->isInAtlas())
+			standalone[i]->clearAtlasRegion();
+	}
+
+	for (p = pages->begin(); p < pages->end(); p++)
+		delete *p;
+	delete pages;
+	pages = newPages;
+
+#ifdef DEBUG
+	printf("texture atlas: %d textures in %d pages, %d standalone\n",
+			packed, (int)pages->size(), (int)standalone.size());
+#endif
+}
+
@@ -0,0 +1,116 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __TEXTUREATLAS_H__
+#define __TEXTUREATLAS_H__
+
+#if defined(__APPLE__)
+	#include <OPENGL/gl.h>
+#else
+	#include <GL/gl.h>
+#endif
+
+#include <vector>
+
+#include "Texture.h"
+
+/// maximum size of an atlas page
+#define ATLAS_PAGE_SIZE 2048
+/// textures bigger than this in any direction are left standalone
+#define ATLAS_MAX_IMAGE_SIZE 512
+/// texels around each texture repeating its edge against mipmap bleeding
+#define ATLAS_PADDING 4
+
+using namespace std;
+
+namespace Animata
+{
+
+/// Horizontal segment of the skyline of an atlas page.
+struct SkylineNode
+{
+	int x;		///< left of the segment
+	int y;		///< height of the skyline over the segment
+	int width;	///< width of the segment
+};
+
+/// Texture placed on an atlas page.
+struct AtlasPlacement
+{
+	Texture *texture;	///< the placed texture
+	int x, y;			///< position of the padded texture on the page
+};
+
+/// One OpenGL texture holding several small textures.
+class AtlasPage
+{
+	public:
+		AtlasPage(int size);
+		~AtlasPage();
+
+		bool insert(Texture *t);
+		void upload(void);
+
+		/// Returns the number of textures placed on the page.
+		inline int getTextureCount(void) { return placements.size(); }
+		/// Returns the i-th texture placed on the page.
+		inline Texture *getTexture(int i) { return placements[i].texture; }
+
+	private:
+		int width;						///< width of the page
+		int height;						///< height of the page
+		int usedWidth;					///< width covered by the placed textures
+		int usedHeight;					///< height covered by the placed textures
+
+		GLuint glResource;				///< OpenGL resource of the page, 0 if not uploaded
+
+		vector<SkylineNode> skyline;	///< skyline of the packed rectangles
+		vector<AtlasPlacement> placements;	///< textures placed on the page
+
+		bool fit(unsigned i, int w, int h, int *y);
+};
+
+/**
+ * Packs small textures into shared atlas pages with a skyline bottom-left
+ * packer, so meshes of different textures can be drawn with one bind.
+ **/
+class TextureAtlas
+{
+	public:
+		TextureAtlas();
+		~TextureAtlas();
+
+		void build(vector<Texture *> *textures);
+
+		/// Returns the number of atlas pages.
+		inline int getPageCount(void) { return pages->size(); }
+
+	private:
+		vector<AtlasPage *> *pages;	///< uploaded atlas pages
+};
+
+} /* namespace Animata */
+
+#endif
+
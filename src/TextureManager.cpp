@@ -23,6 +23,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <algorithm>
 
 #include "TextureManager.h"
 #include "animata.h"
@@ -37,6 +38,7 @@ using namespace Animata;
 TextureManager::TextureManager()
 {
 	textures = new std::vector<Texture*>;
+	atlas = new TextureAtlas();
 
 	pTexture = NULL;
 }
@@ -54,6 +56,8 @@ TextureManager::~TextureManager()
 		textures->clear();				// clear all vector elements
 		delete textures;
 	}
+
+	delete atlas;
 }
 
 /**
@@ -128,6 +132,58 @@ Texture *TextureManager::createTexture(ImageBox *box)
 	return texture;
 }
 
+/**
+ * Packs the textures attached to the meshes of the scene into atlas pages.
+ * Textures of meshes with texture coordinates outside the image are left
+ * standalone, as the neighbours on the atlas page would show up there.
+ **/
+void TextureManager::buildAtlas(void)
+{
+	// the atlas pages are OpenGL resources
+	if (Texture::isOffline())
+		return;
+
+	std::vector<Texture *> packable;
+
+	std::vector<Layer *> *layers = ui->editorBox->getAllLayers();
+	std::vector<Layer *>::iterator l = layers->begin();
+	for (; l < layers->end(); l++)
+	{
+		Mesh *mesh = (*l)->getMesh();
+		Texture *texture = mesh->getAttachedTexture();
+		if ((texture == NULL) ||
+			(find(packable.begin(), packable.end(), texture) != packable.end()))
+			continue;
+
+		bool inside = true;
+		std::vector<Vertex *> *vertices = mesh->getVertices();
+		std::vector<Vertex *>::iterator v = vertices->begin();
+		for (; v < vertices->end(); v++)
+		{
+			Vector2D *tc = &(*v)->texCoord;
+			if ((tc->x < 0) || (tc->x > 1) || (tc->y < 0) || (tc->y > 1))
+			{
+				inside = false;
+				break;
+			}
+		}
+
+		if (inside)
+			packable.push_back(texture);
+	}
+
+	// textures not used by the scene leave the atlas
+	std::vector<Texture *>::iterator t = textures->begin();
+	for (; t < textures->end(); t++)
+	{
+		if ((*t)->isInAtlas() &&
+			(find(packable.begin(), packable.end(), *t) == packable.end()))
+			(*t)->clearAtlasRegion();
+	}
+
+	atlas->build(&packable);
+}
+
 /**
  * Draws only the texture of the mesh on the currently active layer.
  * First the screen coordinates get computed by Transform::project(), then the texture gets draw in the resulting position.
@@ -178,14 +234,11 @@ void TextureManager::draw(int mode)
 
 				if (mode & RENDER_FEEDBACK)
 				{
-					glMatrixMode(GL_MODELVIEW);
-					glPushMatrix();
-					glMultMatrixf(ui->editorBox->getCurrentLayer()->getTransformationMatrix()->f);
-
-					Transform::setMatrices();
-
-					glMatrixMode(GL_MODELVIEW);
-					glPopMatrix();
+					Matrix transformation;
+					ui->editorBox->getLayerTransformation(
+							ui->editorBox->getCurrentLayer(), &transformation);
+					Transform::setMatrices(ui->editorBox->getCamera(),
+							&transformation);
 
 					Vector3D view0 = Transform::project(texture->x, texture->y, 0);
 					texture->viewTopLeft.set(view0.x, view0.y);
@@ -195,19 +248,8 @@ void TextureManager::draw(int mode)
 
 				if (mode & RENDER_TEXTURE)
 				{
-					// get the boundaries of actual viewport
-					GLint viewport[4];
-					glGetIntegerv(GL_VIEWPORT, viewport);
-
-					glMatrixMode(GL_PROJECTION);
-					glPushMatrix();
-					glLoadIdentity();
-					//glOrtho(0, viewport[2], 0, viewport[3], 0, 1);
-					glOrtho(viewport[0], viewport[2] + viewport[0], viewport[1], viewport[3] + viewport[1], 0, 1);
-
-					glMatrixMode(GL_MODELVIEW);
-					glPushMatrix();
-					glLoadIdentity();
+					// the view coordinates are relative to the camera viewport
+					ui->editorBox->getViewTransform()->setupOrtho();
 
 					texture->draw(pTexture == texture);
 
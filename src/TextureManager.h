@@ -26,6 +26,7 @@
 
 #include <vector>
 #include "Texture.h"
+#include "TextureAtlas.h"
 #include "ImageBox.h"
 
 using namespace std;
@@ -43,6 +44,8 @@ class TextureManager
 		Texture *pTexture;					///< texture below the mouse cursor
 		Texture *activeTexture;				///< texture attached to the mesh on currently active layer
 
+		TextureAtlas *atlas;				///< atlas pages of the small textures
+
 		/// Adds an already allocated texture to the manager.
 		void addTexture(Texture* t);
 
@@ -62,6 +65,9 @@ class TextureManager
 
 		void draw(int mode);
 
+		/// packs the small textures of the scene into atlas pages
+		void buildAtlas(void);
+
 		/**
 		 * Returns the \a textures vector holding all the textures uploaded to the manager.
 		 * \retval	std::vector<Texture*>* Texture vector.
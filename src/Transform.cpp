@@ -21,6 +21,10 @@
 
 */
 
+#if defined(__SSE__)
+	#include <xmmintrin.h>
+#endif
+
 #include "Transform.h"
 
 using namespace Animata;
@@ -30,13 +34,42 @@ double Transform::projection[16];
 GLint Transform::viewport[4];
 
 /**
- * Reads and stores the actual opengl modelview and projection matrices, and viewport parameters.
+ * Stores the modelview and projection matrices, and viewport parameters
+ * calculated by the camera, without reading back the OpenGL state.
+ * \param camera the camera whose matrices are used
+ * \param world world transformation of the layer multiplied onto the
+ *	modelview matrix of the camera, or NULL
  */
-void Transform::setMatrices()
+void Transform::setMatrices(Camera *camera, Matrix *world /* = NULL */)
 {
-	glGetDoublev(GL_MODELVIEW_MATRIX, modelview);
-	glGetDoublev(GL_PROJECTION_MATRIX, projection);
-	glGetIntegerv(GL_VIEWPORT, viewport);
+	const double *mv = camera->getModelView();
+	const double *p = camera->getProjection();
+	const int *vp = camera->getViewport();
+
+	if (world)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			for (int r = 0; r < 4; r++)
+			{
+				double s = 0;
+				for (int k = 0; k < 4; k++)
+					s += mv[k * 4 + r] * world->f[c * 4 + k];
+				modelview[c * 4 + r] = s;
+			}
+		}
+	}
+	else
+	{
+		for (int i = 0; i < 16; i++)
+			modelview[i] = mv[i];
+	}
+
+	for (int i = 0; i < 16; i++)
+		projection[i] = p[i];
+
+	for (int i = 0; i < 4; i++)
+		viewport[i] = vp[i];
 }
 
 /**
@@ -56,6 +89,76 @@ Vector3D Transform::project(float x, float y, float z)
 	return Vector3D(wx, wy, wz);
 }
 
+/**
+ * Projects points of the \e z = 0 plane to screen coordinates based on the
+ * previously saved transformation parameters, the same way as project().
+ * The coordinates are packed in separate arrays, so four points are projected
+ * at once where SSE is available.
+ *
+ * \param x array of the \e x coordinates of the points
+ * \param y array of the \e y coordinates of the points
+ * \param vx returns the \e x screen coordinates
+ * \param vy returns the \e y screen coordinates
+ * \param count number of points
+ */
+void Transform::projectPoints(const float *x, const float *y,
+		float *vx, float *vy, unsigned count)
+{
+	// combined projection * modelview matrix, only the rows needed for
+	// the x, y and w clip coordinates of points with z = 0
+	float m[16];
+	for (int c = 0; c < 4; c++)
+	{
+		for (int r = 0; r < 4; r++)
+		{
+			double s = 0;
+			for (int k = 0; k < 4; k++)
+				s += projection[k * 4 + r] * modelview[c * 4 + k];
+			m[c * 4 + r] = (float)s;
+		}
+	}
+
+	// clip coordinates to window coordinates
+	float sx = viewport[2] * .5f;
+	float sy = viewport[3] * .5f;
+	float ox = viewport[0] + sx;
+	float oy = viewport[1] + sy;
+
+	unsigned i = 0;
+
+#if defined(__SSE__)
+	__m128 m0 = _mm_set1_ps(m[0]), m4 = _mm_set1_ps(m[4]), m12 = _mm_set1_ps(m[12]);
+	__m128 m1 = _mm_set1_ps(m[1]), m5 = _mm_set1_ps(m[5]), m13 = _mm_set1_ps(m[13]);
+	__m128 m3 = _mm_set1_ps(m[3]), m7 = _mm_set1_ps(m[7]), m15 = _mm_set1_ps(m[15]);
+	__m128 sx4 = _mm_set1_ps(sx), sy4 = _mm_set1_ps(sy);
+	__m128 ox4 = _mm_set1_ps(ox), oy4 = _mm_set1_ps(oy);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 px = _mm_loadu_ps(x + i);
+		__m128 py = _mm_loadu_ps(y + i);
+
+		__m128 cx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, px), _mm_mul_ps(m4, py)), m12);
+		__m128 cy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m1, px), _mm_mul_ps(m5, py)), m13);
+		__m128 cw = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m3, px), _mm_mul_ps(m7, py)), m15);
+
+		__m128 rw = _mm_div_ps(_mm_set1_ps(1.f), cw);
+		_mm_storeu_ps(vx + i, _mm_add_ps(_mm_mul_ps(_mm_mul_ps(cx, rw), sx4), ox4));
+		_mm_storeu_ps(vy + i, _mm_add_ps(_mm_mul_ps(_mm_mul_ps(cy, rw), sy4), oy4));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		float cx = m[0] * x[i] + m[4] * y[i] + m[12];
+		float cy = m[1] * x[i] + m[5] * y[i] + m[13];
+		float cw = m[3] * x[i] + m[7] * y[i] + m[15];
+
+		vx[i] = cx / cw * sx + ox;
+		vy[i] = cy / cw * sy + oy;
+	}
+}
+
 /**
  * Unprojects a given 3D point (in screen coordinates) to world coordinates
  * based on the previously saved transformation parameters.
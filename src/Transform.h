@@ -33,6 +33,8 @@
 #endif
 
 #include "Vector3D.h"
+#include "Camera.h"
+#include "Matrix.h"
 
 namespace Animata
 {
@@ -49,10 +51,12 @@ class Transform
 		Transform() {}
 		virtual ~Transform () {}
 
-		static void setMatrices();
+		static void setMatrices(Camera *camera, Matrix *world = NULL);
 
 		static Vector3D unproject(float x, float y, float z);
 		static Vector3D project(float x, float y, float z);
+		static void projectPoints(const float *x, const float *y,
+				float *vx, float *vy, unsigned count);
 		static float getDepth(float x, float y);
 };
 
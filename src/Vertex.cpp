@@ -26,6 +26,8 @@
 
 using namespace Animata;
 
+HandleTable<Vertex> *Vertex::handles = new HandleTable<Vertex>;
+
 void Vertex::draw(int mouseOver, int active)
 {
 	Primitives::drawVertex(this, mouseOver, active);
@@ -39,8 +41,3 @@ void Vertex::draw(int mouseOver, int active)
 		drawVertex(this); */
 }
 
-void Vertex::flipSelection(void)
-{
-	selected = !selected;
-}
-
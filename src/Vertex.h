@@ -24,11 +24,19 @@
 #ifndef __VERTEX_H__
 #define __VERTEX_H__
 
+#include <vector>
+
 #include "Vector2D.h"
+#include "Handle.h"
+
+using namespace std;
 
 namespace Animata
 {
 
+class Face;
+class Bone;
+
 /// A point that builds up a Face.
 class Vertex
 {
@@ -37,14 +45,26 @@ class Vertex
 		Vector2D	texCoord;		///< texture coordinate used at this point
 		Vector2D	view;			///< the position of the Vertex on the screen
 
-		bool		selected;		///< selection state
+		bool		selected;		///< selection state, changed through Mesh::selectVertex()
+		unsigned	selectionIndex;	///< position in the selection set of the mesh while selected
+
+		unsigned		index;		///< position in the vertices of the mesh
+		vector<Face *>	faces;		///< faces using the Vertex, maintained by the Mesh
+		vector<Bone *>	bones;		///< bones the Vertex is attached to, maintained by the Bone
+
+		Handle		handle;			///< stable identity of the Vertex
+
+		static HandleTable<Vertex> *handles;	///< handles of all existing vertices
 
 		/**
 		 * Creates a new Vertex at a given position.
 		 * \param c The position where to place the new Vertex.
 		 * \param tc Texture coordinate assigned to the Vertex.
 		 */
-		Vertex(Vector2D c, Vector2D tc = Vector2D()) { coord = c; texCoord = tc; selected = false; }
+		Vertex(Vector2D c, Vector2D tc = Vector2D()) { coord = c; texCoord = tc; selected = false; selectionIndex = 0; index = 0; handle = handles->add(this); }
+
+		/// Invalidates the handle of the Vertex.
+		~Vertex() { handles->remove(handle); }
 
 		/**
 		 * Draws the Vertex onscreen.
@@ -52,9 +72,6 @@ class Vertex
 		 * \param active Indicates if the active state should be drawn.
 		 */
 		void draw(int mouseOver = 0, int active = 1);
-
-		/// Inverts the selection state of the Vertex.
-		void flipSelection(void);
 };
 
 } /* namespace Animata */
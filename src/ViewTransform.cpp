@@ -0,0 +1,222 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "ViewTransform.h"
+#include "Transform.h"
+#include "animata.h"
+
+using namespace Animata;
+
+/**
+ * Creates the view transform stage of a camera.
+ * \param camera the camera the view coordinates are computed for
+ **/
+ViewTransform::ViewTransform(Camera *camera)
+{
+	this->camera = camera;
+
+	viewport[0] = viewport[1] = 0;
+	viewport[2] = viewport[3] = 1;
+
+	frame = 0;
+
+	mapped = false;
+
+	uncaptured = new vector<Layer *>;
+}
+
+ViewTransform::~ViewTransform()
+{
+	delete uncaptured;
+}
+
+/**
+ * Computes the view coordinates of the visible layers in front of the
+ * camera. The matrices of the camera has to be calculated before calling
+ * this, and the transformation matrices of the layers has to be up to date.
+ * No OpenGL state is read or changed.
+ * If a snapshot is given, the layers are projected in their captured state,
+ * the ones not in the snapshot are left for updateUncaptured(). Without a
+ * snapshot the layers are projected in their current state.
+ * \param layers all layers of the scene
+ * \param snapshot state of the scene captured by the simulation, or NULL
+ **/
+void ViewTransform::update(vector<Layer *> *layers, SceneSnapshot *snapshot /* = NULL */)
+{
+	const int *vp = camera->getViewport();
+	for (int i = 0; i < 4; i++)
+		viewport[i] = vp[i];
+
+	float camZ = camera->getTarget()->z - camera->getDistance();
+
+	uncaptured->clear();
+
+	vector<Layer *>::iterator l = layers->begin();
+	for (; l < layers->end(); l++)
+	{
+		Layer *layer = *l;
+
+		/* layers behind the camera are not drawn */
+		if (!layer->getVisibility() || (layer->getTotalDepth() <= camZ))
+			continue;
+
+		if (snapshot == NULL)
+		{
+			Transform::setMatrices(camera, layer->getTransformationMatrix());
+			selector->doFeedback(layer);
+			continue;
+		}
+
+		LayerSnapshot *state = snapshot->find(layer);
+		if (state == NULL)
+		{
+			// added since the last simulation step
+			uncaptured->push_back(layer);
+			continue;
+		}
+
+		// set the transformation matrices for the projection in doFeedback
+		Transform::setMatrices(camera, &state->transformation);
+		selector->doFeedback(layer, state);
+	}
+
+	frame++;
+}
+
+/**
+ * Projects the layers left out by the last update() because they were not
+ * in the snapshot yet, from their current state. Has to be called with the
+ * scene locked and the snapshot released, as the simulation thread changes
+ * the layers.
+ **/
+void ViewTransform::updateUncaptured(void)
+{
+	vector<Layer *>::iterator l = uncaptured->begin();
+	for (; l < uncaptured->end(); l++)
+	{
+		Transform::setMatrices(camera, (*l)->getTransformationMatrix());
+		selector->doFeedback(*l);
+	}
+	uncaptured->clear();
+}
+
+/**
+ * Sets the camera of the window the view coordinates are drawn in. The
+ * mapping from the viewport of this stage to the viewport of the output
+ * camera is calculated from the matrices of both cameras, which has to look
+ * from the same eye in the same direction, by projecting three world points
+ * with each.
+ * \param output camera of the drawn window, NULL for the camera of this
+ *	stage
+ **/
+void ViewTransform::setOutput(Camera *output /* = NULL */)
+{
+	mapped = false;
+	if (output == NULL)
+		return;
+
+	output->calcMatrices();
+	const int *vp = output->getViewport();
+	for (int i = 0; i < 4; i++)
+		outputViewport[i] = vp[i];
+
+	// the mapping is the same for every depth, the target plane is used
+	Vector3D *t = camera->getTarget();
+	float dist = camera->getDistance();
+	float wx[3] = { t->x, t->x + dist, t->x };
+	float wy[3] = { t->y, t->y, t->y + dist };
+
+	Vector3D e[3], p[3];
+	Transform::setMatrices(camera);
+	for (int i = 0; i < 3; i++)
+	{
+		Vector3D v = Transform::project(wx[i], wy[i], t->z);
+		e[i].set(v.x, v.y, v.z);
+	}
+	Transform::setMatrices(output);
+	for (int i = 0; i < 3; i++)
+	{
+		Vector3D v = Transform::project(wx[i], wy[i], t->z);
+		p[i].set(v.x, v.y, v.z);
+	}
+
+	double ex0 = e[1].x - e[0].x;
+	double ey0 = e[1].y - e[0].y;
+	double ex1 = e[2].x - e[0].x;
+	double ey1 = e[2].y - e[0].y;
+	double det = ex0 * ey1 - ex1 * ey0;
+	if (det == 0)
+		return;
+
+	double px0 = p[1].x - p[0].x;
+	double py0 = p[1].y - p[0].y;
+	double px1 = p[2].x - p[0].x;
+	double py1 = p[2].y - p[0].y;
+
+	// x' = a x + b y + tx, y' = c x + d y + ty
+	double a = (px0 * ey1 - px1 * ey0) / det;
+	double b = (px1 * ex0 - px0 * ex1) / det;
+	double c = (py0 * ey1 - py1 * ey0) / det;
+	double d = (py1 * ex0 - py0 * ex1) / det;
+
+	for (int i = 0; i < 16; i++)
+		mapping[i] = 0;
+	mapping[0] = a;
+	mapping[1] = c;
+	mapping[4] = b;
+	mapping[5] = d;
+	mapping[10] = 1;
+	mapping[12] = p[0].x - a * e[0].x - b * e[0].y;
+	mapping[13] = p[0].y - c * e[0].x - d * e[0].y;
+	mapping[15] = 1;
+
+	mapped = true;
+}
+
+/**
+ * Sets up an orthographic projection mapping the view coordinates onto the
+ * viewport of the output camera, and resets the modelview matrix. Both
+ * matrices are pushed, and has to be popped after drawing.
+ **/
+void ViewTransform::setupOrtho(void)
+{
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	if (mapped)
+	{
+		glOrtho(outputViewport[0], outputViewport[2] + outputViewport[0],
+				outputViewport[1], outputViewport[3] + outputViewport[1], 0, 1);
+		glMultMatrixd(mapping);
+	}
+	else
+	{
+		glOrtho(viewport[0], viewport[2] + viewport[0], viewport[1], viewport[3] + viewport[1], 0, 1);
+	}
+
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+}
+
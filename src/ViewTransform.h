@@ -0,0 +1,97 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __VIEWTRANSFORM_H__
+#define __VIEWTRANSFORM_H__
+
+#if defined(__APPLE__)
+	#include <OPENGL/gl.h>
+#else
+	#include <GL/gl.h>
+#endif
+
+#include <vector>
+
+#include "Camera.h"
+#include "Layer.h"
+#include "SceneSnapshot.h"
+
+using namespace std;
+
+namespace Animata
+{
+
+/**
+ * Per-frame stage computing the view coordinates of the vertices and joints
+ * of every layer seen by a camera.
+ *
+ * The results are stored in Vertex::view and Joint::vx, Joint::vy in the
+ * window coordinates of the camera viewport. The playback camera looks from
+ * the same eye in the same direction, so its picture of every layer is the
+ * same 2D affine image of the editor's picture. setOutput() calculates this
+ * mapping by projecting world points with both cameras, and setupOrtho()
+ * applies it, so the playback window draws the coordinates of the editor
+ * camera in its own viewport instead of projecting the scene again.
+ **/
+class ViewTransform
+{
+	public:
+		ViewTransform(Camera *camera);
+		~ViewTransform();
+
+		void update(vector<Layer *> *layers, SceneSnapshot *snapshot = NULL);
+		void updateUncaptured(void);
+		void setOutput(Camera *output = NULL);
+		void setupOrtho(void);
+
+		/// Returns true if the last update() left out layers missing from the snapshot.
+		inline bool hasUncaptured(void) { return !uncaptured->empty(); }
+
+		/**
+		 * Returns the viewport the view coordinates are relative to.
+		 * \retval GLint* Viewport position and size.
+		 **/
+		inline GLint *getViewport(void) { return viewport; }
+		/**
+		 * Returns the number of updates since the stage was created.
+		 * \retval unsigned Number of frames computed.
+		 **/
+		inline unsigned getFrame(void) { return frame; }
+
+	private:
+		Camera *camera;		///< camera the view coordinates are computed for
+		GLint viewport[4];	///< viewport of the camera at the last update
+		unsigned frame;		///< number of updates
+
+		bool mapped;				///< true if drawing for another camera
+		GLint outputViewport[4];	///< viewport of the output camera
+		double mapping[16];			///< maps the view coordinates to the output camera
+
+		vector<Layer *> *uncaptured;	///< layers left for updateUncaptured()
+};
+
+} /* namespace Animata */
+
+#endif
+
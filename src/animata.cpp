@@ -26,10 +26,13 @@
 #include <unistd.h>
 #include <algorithm>
 #include <iterator>
+#include <string>
 
 #include "animata.h"
 #include "animataUI.h"
 #include "Transform.h"
+#include "MeshOptimizer.h"
+#include "HeadlessRenderer.h"
 
 AnimataUI *ui;
 
@@ -38,6 +41,167 @@ using namespace Animata;
 namespace Animata
 {
 	Selection *selector;
+
+/**
+ * Joint or layer preference edited on the user interface. The value is
+ * copied when the command is posted, as the user interface reuses its
+ * storage.
+ **/
+class PreferenceCommand : public SceneCommand
+{
+	public:
+		PreferenceCommand(Layer *layer, enum ANIMATA_PREFERENCES prefParam,
+				void *value);
+		virtual void execute(void);
+
+	private:
+		Layer *layer;						///< layer of the edited joints
+		enum ANIMATA_PREFERENCES prefParam;	///< parameter to set
+		string str;							///< name value
+		float f;							///< float value
+		int i;								///< integer value
+};
+
+/// Bone parameter edited on the user interface.
+class BonePreferenceCommand : public SceneCommand
+{
+	public:
+		/// Bone parameters set by the command.
+		enum BONE_PREFERENCE
+		{
+			BONE_PARAMETERS,
+			BONE_LENGTH_MULT_MIN,
+			BONE_LENGTH_MULT_MAX,
+			BONE_TEMPO,
+			BONE_ATTACH
+		};
+
+		BonePreferenceCommand(Layer *layer, enum BONE_PREFERENCE pref,
+				const char *name = NULL, float p0 = 0, float p1 = 0);
+		virtual void execute(void);
+
+	private:
+		Layer *layer;				///< layer of the edited bones
+		enum BONE_PREFERENCE pref;	///< parameter to set
+		bool hasName;				///< true if the name is set
+		string name;				///< bone name
+		float p0;					///< first value
+		float p1;					///< second value
+};
+
+} /* namespace Animata */
+
+/**
+ * Creates a joint or layer preference command.
+ * \param layer layer of the edited joints or the edited layer
+ * \param prefParam parameter to set
+ * \param value parameter value cast to (void *)
+ **/
+PreferenceCommand::PreferenceCommand(Layer *layer,
+		enum ANIMATA_PREFERENCES prefParam, void *value)
+{
+	this->layer = layer;
+	this->prefParam = prefParam;
+	f = 0;
+	i = 0;
+
+	switch (prefParam)
+	{
+		case PREFS_JOINT_NAME:
+		case PREFS_LAYER_NAME:
+			str = *((const char **)value);
+			break;
+		case PREFS_JOINT_X:
+		case PREFS_JOINT_Y:
+		case PREFS_LAYER_ALPHA:
+			f = *((float *)value);
+			break;
+		case PREFS_JOINT_FIXED:
+		case PREFS_JOINT_OSC:
+		case PREFS_LAYER_VISIBILITY:
+			i = *((int *)value);
+			break;
+		default:
+			break;
+	}
+}
+
+void PreferenceCommand::execute(void)
+{
+	const char *name = str.c_str();
+
+	switch (prefParam)
+	{
+		case PREFS_JOINT_NAME:
+			layer->getSkeleton()->setSelectedJointParameters(prefParam, &name);
+			break;
+		case PREFS_JOINT_X:
+		case PREFS_JOINT_Y:
+			layer->getSkeleton()->setSelectedJointParameters(prefParam, &f);
+			break;
+		case PREFS_JOINT_FIXED:
+		case PREFS_JOINT_OSC:
+			layer->getSkeleton()->setSelectedJointParameters(prefParam, &i);
+			break;
+		case PREFS_LAYER_NAME:
+			layer->setName(name);
+			break;
+		case PREFS_LAYER_ALPHA:
+			layer->setAlpha(f);
+			break;
+		case PREFS_LAYER_VISIBILITY:
+			layer->setVisibility(i);
+			break;
+		default:
+			break;
+	}
+}
+
+/**
+ * Creates a bone preference command.
+ * \param layer layer of the edited bones
+ * \param pref parameter to set
+ * \param name bone name for BONE_PARAMETERS, NULL keeps the name
+ * \param p0 stiffness, length multiplier minimum, maximum, tempo or attach area
+ * \param p1 length multiplier for BONE_PARAMETERS, falloff for BONE_ATTACH
+ **/
+BonePreferenceCommand::BonePreferenceCommand(Layer *layer,
+		enum BONE_PREFERENCE pref, const char *name /* = NULL */,
+		float p0 /* = 0 */, float p1 /* = 0 */)
+{
+	this->layer = layer;
+	this->pref = pref;
+	hasName = (name != NULL);
+	if (name)
+		this->name = name;
+	this->p0 = p0;
+	this->p1 = p1;
+}
+
+void BonePreferenceCommand::execute(void)
+{
+	Skeleton *skeleton = layer->getSkeleton();
+
+	switch (pref)
+	{
+		case BONE_PARAMETERS:
+			skeleton->setSelectedBoneParameters(
+					hasName ? name.c_str() : NULL, p0, p1);
+			break;
+		case BONE_LENGTH_MULT_MIN:
+			skeleton->setSelectedBoneLengthMultMin(p0);
+			break;
+		case BONE_LENGTH_MULT_MAX:
+			skeleton->setSelectedBoneLengthMultMax(p0);
+			break;
+		case BONE_TEMPO:
+			skeleton->setSelectedBoneTempo(p0);
+			break;
+		case BONE_ATTACH:
+			skeleton->setSelectedBoneParameters(NULL, FLT_EPSILON, -1, p0, p1);
+			skeleton->selectVerticesInRange(layer);
+			break;
+	}
 }
 
 AnimataSettings::AnimataSettings()
@@ -56,6 +220,21 @@ AnimataSettings::AnimataSettings()
 	triangulateAlphaThreshold = 100;
 }
 
+/**
+ * Compares the settings.
+ * \param s settings to compare with
+ * \return nonzero if any of the settings differ
+ **/
+int AnimataSettings::operator != (AnimataSettings &s)
+{
+	return (mode != s.mode) || (prevMode != s.prevMode) ||
+		(playSimulation != s.playSimulation) || (gravity != s.gravity) ||
+		(gravityForce != s.gravityForce) || (gravityX != s.gravityX) ||
+		(gravityY != s.gravityY) || (iteration != s.iteration) ||
+		(fps != s.fps) || (display_elements != s.display_elements) ||
+		(triangulateAlphaThreshold != s.triangulateAlphaThreshold);
+}
+
 /**
  * Creates the application window.
  * \param x x-position of window
@@ -68,6 +247,13 @@ AnimataWindow::AnimataWindow(int x, int y, int w, int h, const char* l) :
 	Fl_Gl_Window(x, y, w, h, l)
 {
 	camera = new Camera();
+	renderQueue = new RenderQueue("editor");
+	glyphBatch = new GlyphBatch();
+	viewTransform = new ViewTransform(camera);
+	impostorCache = new ImpostorCache(camera, viewTransform);
+
+	// the impostors are captured with the alpha of the layer textures
+	mode(FL_RGB | FL_ALPHA | FL_DOUBLE | FL_DEPTH);
 
 	selector = new Selection();
 	textureManager = new TextureManager();
@@ -78,15 +264,29 @@ AnimataWindow::AnimataWindow(int x, int y, int w, int h, const char* l) :
 	allBones = NULL;
 	allJoints = NULL;
 	oscJoints = NULL;
-
-	pthread_mutex_init(&mutex, NULL);
+	layerNames = NULL;
+	boneNames = NULL;
+	jointNames = NULL;
+	nameVersion = 1;
+
+	// the scene lock is taken again by the edits called with it held
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&mutex, &attr);
+	pthread_mutexattr_destroy(&attr);
 
 	io = new IO();
 
 	oscListener = new OSCListener();
 	oscSender = new OSCSender(OSC_HOST);
+	simulation = new SimulationThread();
+	lassoPoints = new vector<Vector2D>;
 
 	bDoUpdateTextures = false;
+
+	redrawRequested = true;
+	drawnRevision = 0;
 }
 
 /**
@@ -100,11 +300,16 @@ void AnimataWindow::startup(void)
 	oscListener->start();
 	oscSender->start();
 	newScene();
+	simulation->start();
 }
 
 AnimataWindow::~AnimataWindow()
 {
+	simulation->stop();
+
 	cleanup();
+	delete simulation;
+	delete lassoPoints;
 
 	pthread_mutex_destroy(&mutex);
 
@@ -116,12 +321,19 @@ AnimataWindow::~AnimataWindow()
 	delete textureManager;
 	delete io;
 
+	delete renderQueue;
+	delete glyphBatch;
+	delete impostorCache;
+	delete viewTransform;
 	delete camera;
 }
 
 void AnimataWindow::cleanup(void)
 {
+	lock();
+
 	selector->cancelPickLayer();
+	impostorCache->clear();
 
 	if (ui)
 		ui->clearLayerTree();
@@ -156,6 +368,24 @@ void AnimataWindow::cleanup(void)
 		oscJoints = NULL;
 	}
 
+	if (layerNames)
+	{
+		delete layerNames;
+		layerNames = NULL;
+	}
+
+	if (boneNames)
+	{
+		delete boneNames;
+		boneNames = NULL;
+	}
+
+	if (jointNames)
+	{
+		delete jointNames;
+		jointNames = NULL;
+	}
+
 	pointedVertex = pointedPrevVertex = pointedPrevPrevVertex = NULL;
 	pointedFace = NULL;
 	pointedJoint = pointedPrevJoint = NULL;
@@ -164,12 +394,20 @@ void AnimataWindow::cleanup(void)
 
 	dragging = false;
 	filename[0] = 0; // empty filename
+
+	unlock();
 }
 
 void AnimataWindow::addToAllLayers(Layer *l)
 {
+	requestRedraw();
+
+	lock();
 	allLayers->push_back(l);
 	sort(allLayers->begin(), allLayers->end(), Layer::zorder);
+	layerNames->add(l);
+	namesChanged();
+	unlock();
 }
 
 /**
@@ -178,6 +416,18 @@ void AnimataWindow::addToAllLayers(Layer *l)
  **/
 void AnimataWindow::deleteFromAllLayers(Layer *layer)
 {
+	requestRedraw();
+
+	// the pending edits and the snapshots can refer to the deleted layer,
+	// the caller holds the lock until the layer is freed
+	lock();
+	simulation->runCommands();
+	simulation->clearSnapshots();
+	unlock();
+
+	// the cached name lookups can refer to the deleted layer
+	namesChanged();
+
 	vector<Layer *>::iterator pos;
 
 	// find position of layer in vector
@@ -190,6 +440,11 @@ void AnimataWindow::deleteFromAllLayers(Layer *layer)
 	}
 
 	allLayers->erase(pos);
+	layerNames->remove(layer);
+
+	pos = std::find(selectedLayers.begin(), selectedLayers.end(), layer);
+	if (pos != selectedLayers.end())
+		selectedLayers.erase(pos);
 }
 
 /**
@@ -198,6 +453,9 @@ void AnimataWindow::deleteFromAllLayers(Layer *layer)
  **/
 void AnimataWindow::deleteFromAllBones(Bone *bone)
 {
+	// the cached name lookups can refer to the deleted bone
+	namesChanged();
+
 	vector<Bone *>::iterator pos;
 
 	// find position of bone in vector
@@ -206,6 +464,7 @@ void AnimataWindow::deleteFromAllBones(Bone *bone)
 		return;
 
 	allBones->erase(pos);
+	boneNames->remove(bone);
 }
 
 /**
@@ -214,6 +473,9 @@ void AnimataWindow::deleteFromAllBones(Bone *bone)
  **/
 void AnimataWindow::deleteFromAllJoints(Joint *joint)
 {
+	// the cached name lookups can refer to the deleted joint
+	namesChanged();
+
 	vector<Joint *>::iterator pos;
 
 	// find position of joint in vector
@@ -222,6 +484,7 @@ void AnimataWindow::deleteFromAllJoints(Joint *joint)
 		return;
 
 	allJoints->erase(pos);
+	jointNames->remove(joint);
 }
 
 /**
@@ -230,10 +493,10 @@ void AnimataWindow::deleteFromAllJoints(Joint *joint)
  **/
 void AnimataWindow::deleteFromOSCJoints(Joint *joint)
 {
-	vector<Joint *>::iterator pos;
+	vector<Handle>::iterator pos;
 
 	// find position of joint in vector
-	pos = std::find(oscJoints->begin(), oscJoints->end(), joint);
+	pos = std::find(oscJoints->begin(), oscJoints->end(), joint->handle);
 	if (pos == oscJoints->end()) // not a member
 		return;
 
@@ -245,13 +508,25 @@ void AnimataWindow::saveScene(const char *filename)
 	io->save(filename, rootLayer);
 }
 
-void AnimataWindow::loadScene(const char *filename)
+/**
+ * Loads a scene, or creates a new one if the scene cannot be loaded.
+ * \param filename filename to load from
+ * \return true if the scene is loaded
+ **/
+bool AnimataWindow::loadScene(const char *filename)
 {
+	requestRedraw();
+
+	lock();
+
 	cleanup();
 	allLayers = new vector<Layer *>;
 	allBones = new vector<Bone *>;
 	allJoints = new vector<Joint *>;
-	oscJoints = new vector<Joint *>;
+	oscJoints = new vector<Handle>;
+	layerNames = new NameIndex<Layer>;
+	boneNames = new NameIndex<Bone>;
+	jointNames = new NameIndex<Joint>;
 
 	Layer *layer = io->load(filename);
 
@@ -270,6 +545,9 @@ void AnimataWindow::loadScene(const char *filename)
 			//ui->playback->setRootLayer(rootLayer);
 			ui->refreshLayerTree(rootLayer);
 		}
+
+		textureManager->buildAtlas();
+		impostorCache->clear();
 	}
 	else /* loading error */
 	{
@@ -281,9 +559,18 @@ void AnimataWindow::loadScene(const char *filename)
 		allJoints = NULL;
 		delete oscJoints;
 		oscJoints = NULL;
+		delete layerNames;
+		layerNames = NULL;
+		delete boneNames;
+		boneNames = NULL;
+		delete jointNames;
+		jointNames = NULL;
 		newScene();
 	}
 
+	unlock();
+
+	return layer != NULL;
 }
 
 /**
@@ -292,11 +579,17 @@ void AnimataWindow::loadScene(const char *filename)
  **/
 void AnimataWindow::importScene(const char *filename)
 {
+	requestRedraw();
+
+	lock();
+
 	Layer *layer = io->load(filename);
 	/* if no error add the layer to the current layer's children */
 	if (layer)
 	{
 		cLayer->addSublayer(layer);
+		textureManager->buildAtlas();
+		impostorCache->clear();
 
 		#if 0
 		// set parent of imported root level layers to the current layer
@@ -312,6 +605,8 @@ void AnimataWindow::importScene(const char *filename)
 		#endif
 	}
 
+	unlock();
+
 	if (ui)
 	{
 		//ui->playback->setRootLayer(rootLayer);
@@ -321,12 +616,19 @@ void AnimataWindow::importScene(const char *filename)
 
 void AnimataWindow::newScene(void)
 {
+	requestRedraw();
+
+	lock();
+
 	cleanup();
 
 	allLayers = new vector<Layer *>;
 	allBones = new vector<Bone *>;
 	allJoints = new vector<Joint *>;
-	oscJoints = new vector<Joint *>;
+	oscJoints = new vector<Handle>;
+	layerNames = new NameIndex<Layer>;
+	boneNames = new NameIndex<Bone>;
+	jointNames = new NameIndex<Joint>;
 
 	rootLayer = new Layer();
 
@@ -337,6 +639,8 @@ void AnimataWindow::newScene(void)
 
 	oscListener->setRootLayer(rootLayer);
 
+	unlock();
+
 	// TODO: erasing image boxes
 
 	if (ui)
@@ -349,6 +653,8 @@ void AnimataWindow::newScene(void)
 /// Refresh all textures on disk
 void AnimataWindow::updateTextures(void)
 {
+	lock();
+
     vector<Layer *>::iterator l = allLayers->begin();
 	for (; l < allLayers->end(); l++)
 	{
@@ -382,13 +688,16 @@ void AnimataWindow::updateTextures(void)
 	    }
 	}
 
+	textureManager->buildAtlas();
+	impostorCache->clear();
 
-
+	unlock();
 }
 
 void AnimataWindow::flagUpdateTextures() {
 
     bDoUpdateTextures = true;
+	requestRedraw();
 }
 
 /// Sets filename of the scene.
@@ -400,8 +709,12 @@ void AnimataWindow::setFilename(const char *filename)
 /// Calls the mesh triangulation routine.
 void AnimataWindow::triangulate(void)
 {
+	requestRedraw();
+
+	lock();
 	cMesh->triangulate();
 	pointedFace = NULL;
+	unlock();
 }
 
 /**
@@ -409,7 +722,11 @@ void AnimataWindow::triangulate(void)
  **/
 void AnimataWindow::attachVertices(void)
 {
+	requestRedraw();
+
+	lock();
 	cSkeleton->attachVertices(cMesh->getSelectedVertices());
+	unlock();
 }
 
 /**
@@ -417,7 +734,11 @@ void AnimataWindow::attachVertices(void)
  **/
 void AnimataWindow::disattachVertices(void)
 {
-	cSkeleton->disattachVertices();
+	requestRedraw();
+
+	lock();
+	cSkeleton->disattachVertices(cMesh);
+	unlock();
 }
 
 /**
@@ -442,28 +763,66 @@ void AnimataWindow::drawScene(void)
 	camera->setupPerspective();
 	camera->setupModelView();
 
+	// the view coordinates are computed once per frame for both windows
+	// from the last state published by the simulation thread
+	SceneSnapshot *snapshot = simulation->acquireSnapshot();
+	viewTransform->update(allLayers, snapshot);
+	simulation->releaseSnapshot();
+	// the layers added since the last step are projected from their current
+	// state, the scene is locked after the snapshot is released, as the
+	// layers are deleted with the scene locked before clearing the snapshots
+	if (viewTransform->hasUncaptured())
+	{
+		lock();
+		viewTransform->updateUncaptured();
+		unlock();
+	}
+
+	// static layers are rendered into their impostors before the scene
+	impostorCache->update(allLayers);
+
 	textureManager->draw(RENDER_FEEDBACK | RENDER_TEXTURE);
 	// rootLayer->draw(RENDER_FEEDBACK | RENDER_TEXTURE);
 	// rootLayer->draw(RENDER_WIREFRAME);
 
-	lock();
+	renderQueue->begin(impostorCache);
 	vector<Layer *>::iterator l = allLayers->begin();
 	for (; l < allLayers->end(); l++)
 	{
-		(*l)->calcTransformationMatrix();
+		(*l)->drawWithoutRecursion(RENDER_TEXTURE);
 	}
-	unlock();
+	renderQueue->flush(viewTransform);
 
+	// the glyphs are collected per layer and drawn at once
+	glyphBatch->begin();
 	l = allLayers->begin();
 	for (; l < allLayers->end(); l++)
 	{
-		(*l)->drawWithoutRecursion(RENDER_FEEDBACK | RENDER_TEXTURE);
+		(*l)->drawWithoutRecursion(RENDER_WIREFRAME);
 	}
+	glyphBatch->end();
+}
 
-	l = allLayers->begin();
-	for (; l < allLayers->end(); l++)
+/**
+ * Copies the transformation matrix of a layer as published by the simulation
+ * thread, which rewrites the matrix of the layer itself in every step.
+ * \param layer the layer
+ * \param m the matrix is copied here
+ **/
+void AnimataWindow::getLayerTransformation(Layer *layer, Matrix *m)
+{
+	SceneSnapshot *snapshot = simulation->acquireSnapshot();
+	LayerSnapshot *state = snapshot->find(layer);
+	if (state)
+		*m = state->transformation;
+	simulation->releaseSnapshot();
+
+	// not captured yet, the scene is locked after releasing the snapshot
+	if (state == NULL)
 	{
-		(*l)->drawWithoutRecursion(RENDER_WIREFRAME);
+		lock();
+		*m = *layer->getTransformationMatrix();
+		unlock();
 	}
 }
 
@@ -516,10 +875,6 @@ void AnimataWindow::draw()
 
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	/* run the spring model simulation on all bones of the skeleton */
-	if (ui->settings.playSimulation == 1)
-		rootLayer->simulate(ui->settings.iteration);
-
 	drawScene();
 
 	glMatrixMode(GL_MODELVIEW);
@@ -557,7 +912,9 @@ void AnimataWindow::draw()
 			break;
 	}
 
-	// multiple box-selection
+	// multiple box-selection, the simulation thread selects vertices too
+	// when it attaches bones, so the selection is changed with the scene locked
+	lock();
 	if (dragging)
 	{
 		// for vertex
@@ -570,12 +927,21 @@ void AnimataWindow::draw()
 			if (!Fl::event_state(FL_SHIFT))
 				cMesh->clearSelection();
 
-			// drawSelectionBox(transDragMouse.x, transDragMouse.y, transMouse.x, transMouse.y);
-			Primitives::drawSelectionBox(dragMouseX, h() - dragMouseY, mouseX, h() - mouseY);
+			if (Fl::event_state(FL_ALT))
+			{
+				Primitives::drawSelectionLasso(lassoPoints, h());
+				selector->doLassoSelect(cLayer, Selection::SELECT_VERTEX,
+						lassoPoints);
+			}
+			else
+			{
+				// drawSelectionBox(transDragMouse.x, transDragMouse.y, transMouse.x, transMouse.y);
+				Primitives::drawSelectionBox(dragMouseX, h() - dragMouseY, mouseX, h() - mouseY);
 
-			// use view coordinates as vertices are drawn on an ortho layer
-			selector->doSelect(cMesh, Selection::SELECT_VERTEX,
-					dragMouseX, dragMouseY, mouseX, mouseY);
+				// use view coordinates as vertices are drawn on an ortho layer
+				selector->doSelect(cLayer, Selection::SELECT_VERTEX,
+						dragMouseX, dragMouseY, mouseX, mouseY);
+			}
 
 			/* circle selection
 			float r = sqrt((mouseX - dragMouseX)*(mouseX - dragMouseX) +
@@ -594,20 +960,58 @@ void AnimataWindow::draw()
 			if (!Fl::event_state(FL_SHIFT))
 				cSkeleton->clearSelection();
 
-			// drawSelectionBox(transDragMouse.x, transDragMouse.y, transMouse.x, transMouse.y);
-			Primitives::drawSelectionBox(dragMouseX, h() - dragMouseY, mouseX, h() - mouseY);
+			if (Fl::event_state(FL_ALT))
+			{
+				Primitives::drawSelectionLasso(lassoPoints, h());
+				selector->doLassoSelect(cLayer, Selection::SELECT_JOINT,
+						lassoPoints);
+			}
+			else
+			{
+				// drawSelectionBox(transDragMouse.x, transDragMouse.y, transMouse.x, transMouse.y);
+				Primitives::drawSelectionBox(dragMouseX, h() - dragMouseY, mouseX, h() - mouseY);
 
-			// use view coordinates as joints are drawn on an ortho layer
-			selector->doSelect(cSkeleton, Selection::SELECT_JOINT,
-				dragMouseX, dragMouseY, mouseX, mouseY);
+				// use view coordinates as joints are drawn on an ortho layer
+				selector->doSelect(cLayer, Selection::SELECT_JOINT,
+					dragMouseX, dragMouseY, mouseX, mouseY);
+			}
 		}
 	}
+	unlock();
 
 	glMatrixMode(GL_MODELVIEW);
 	glPopMatrix();
 
 	// call selection
 	selector->doPick(camera, cLayer, textureManager, mouseX, mouseY);
+
+	// the highlight of the primitives below the cursor changes in the
+	// next frame
+	if (selector->hasHitsChanged())
+		requestRedraw();
+
+	drawnSettings = ui->settings;
+	drawnRevision = Mesh::getLastRevision();
+}
+
+/**
+ * Advances the scene by one timer tick. Starts the simulation step of the
+ * tick in its own thread, and checks whether anything changed since the last
+ * drawn frame, the simulation, OSC messages, the camera, the user interface
+ * or the meshes.
+ * \return true if the windows have to be redrawn
+ **/
+bool AnimataWindow::advance(void)
+{
+	simulation->tick();
+
+	if ((ui->settings != drawnSettings) ||
+		(Mesh::getLastRevision() != drawnRevision))
+		requestRedraw();
+
+	bool redraw = redrawRequested;
+	redrawRequested = false;
+	return redraw;
 }
 
 /**
@@ -620,7 +1024,7 @@ void AnimataWindow::selectVertices(void)
 		// if CTRL is pressed flip the selection of the current vertex
 		if (Fl::event_state(FL_CTRL))
 		{
-			pointedVertex->flipSelection();
+			cMesh->flipVertexSelection(pointedVertex);
 		}
 		else
 		// if there's a not selected vertex below the cursor select it,
@@ -629,7 +1033,7 @@ void AnimataWindow::selectVertices(void)
 		{
 			if (!Fl::event_state(FL_SHIFT | FL_CTRL))
 				cMesh->clearSelection();
-			pointedVertex->selected = true;
+			cMesh->selectVertex(pointedVertex);
 		}
 	}
 	else
@@ -643,6 +1047,8 @@ void AnimataWindow::selectVertices(void)
 
 void AnimataWindow::setCurrentLayer(Layer *l)
 {
+	requestRedraw();
+
 	cLayer = l;
 
 	cSkeleton = cLayer->getSkeleton();
@@ -650,15 +1056,17 @@ void AnimataWindow::setCurrentLayer(Layer *l)
 	cMatrix = cLayer->getTransformationMatrix();
 }
 
-void AnimataWindow::setSelectedLayers(Layer *l, int num)
+/**
+ * Sets the layers the layer preferences are applied to.
+ * \param layers the selected layers
+ **/
+void AnimataWindow::setSelectedLayers(vector<Layer *> *layers)
 {
-	Layer *layer = l;
-	selectedLayers.clear();
+	requestRedraw();
 
-	for (int i = 0; i < num; i++, layer++)
-	{
-		selectedLayers.push_back(layer);
-	}
+	lock();
+	selectedLayers = *layers;
+	unlock();
 }
 
 /**
@@ -669,11 +1077,18 @@ void AnimataWindow::setSelectedLayers(Layer *l, int num)
  **/
 void AnimataWindow::createAttachedTexture(ImageBox *box)
 {
+	requestRedraw();
+
+	lock();
+
 	if(cMesh->getAttachedTexture())
 	{
 		// do not create a new texture if its already attached
 		if(!strcmp(cMesh->getAttachedTexture()->getFilename(), box->getFilename()))
+		{
+			unlock();
 			return;
+		}
 
 		// deallocate the previously attached texture
 		textureManager->removeTexture(cMesh->getAttachedTexture());
@@ -682,25 +1097,17 @@ void AnimataWindow::createAttachedTexture(ImageBox *box)
 
 	Texture *texture = textureManager->createTexture(box);
 	cMesh->attachTexture(texture);
+
+	unlock();
 }
 
 Vector2D AnimataWindow::transformMouseToWorld(int x, int y)
 {
-	glMatrixMode(GL_MODELVIEW);
-	glPushMatrix();
-	camera->setupModelView();
-	glMultMatrixf(cMatrix->f);
+	Matrix transformation;
+	getLayerTransformation(cLayer, &transformation);
 
-	glMatrixMode(GL_PROJECTION);
-	glPushMatrix();
-	camera->setupPerspective();
-
-	Transform::setMatrices();
-
-	glMatrixMode(GL_PROJECTION);
-	glPopMatrix();
-	glMatrixMode(GL_MODELVIEW);
-	glPopMatrix();
+	camera->calcMatrices();
+	Transform::setMatrices(camera, &transformation);
 
 	Vector3D o = Transform::unproject(x, y, 0);
 	Vector3D v = Transform::unproject(x, y, 1);
@@ -740,6 +1147,9 @@ void AnimataWindow::handleLeftMousePress(void)
 	prevMouseX = dragMouseX = mouseX = Fl::event_x();
 	prevMouseY = dragMouseY = mouseY = Fl::event_y();
 
+	lassoPoints->clear();
+	lassoPoints->push_back(Vector2D(mouseX, mouseY));
+
 	// transform the mouse coordinates based on the transformation of the current layer
 	Vector2D p = transformMouseToWorld(mouseX, mouseY);
 	transDragMouse.x = transMouse.x = p.x;
@@ -803,7 +1213,7 @@ void AnimataWindow::handleLeftMousePress(void)
 					Joint *j = cSkeleton->addJoint((float)transMouse.x,
 												   (float)transMouse.y);
 					cSkeleton->clearSelection();
-					j->selected = true;
+					cSkeleton->selectJoint(j);
 
 					setJointUIPrefs(j);
 				}
@@ -817,7 +1227,7 @@ void AnimataWindow::handleLeftMousePress(void)
 				if (b)
 				{
 					cSkeleton->clearSelection();
-					b->selected = true;
+					cSkeleton->selectBone(b);
 
 					setBoneUIPrefs(b);
 				}
@@ -833,7 +1243,7 @@ void AnimataWindow::handleLeftMousePress(void)
 				 * joint */
 				if (Fl::event_state(FL_CTRL))
 				{
-					pointedJoint->flipSelection();
+					cSkeleton->flipJointSelection(pointedJoint);
 				}
 				else
 				/* if there's a not selected joint below the cursor select it,
@@ -842,7 +1252,7 @@ void AnimataWindow::handleLeftMousePress(void)
 				{
 					if (!Fl::event_state(FL_SHIFT | FL_CTRL))
 						cSkeleton->clearSelection();
-					pointedJoint->selected = true;
+					cSkeleton->selectJoint(pointedJoint);
 				}
 				setJointUIPrefs(pointedJoint);
 			}
@@ -851,14 +1261,14 @@ void AnimataWindow::handleLeftMousePress(void)
 			{
 				if (Fl::event_state(FL_CTRL))
 				{
-					pointedBone->flipSelection();
+					cSkeleton->flipBoneSelection(pointedBone);
 				}
 				else
 				if (!(pointedBone->selected))
 				{
 					if (!Fl::event_state(FL_SHIFT | FL_CTRL))
 						cSkeleton->clearSelection();
-					pointedBone->selected = true;
+					cSkeleton->selectBone(pointedBone);
 				}
 				setBoneUIPrefs(pointedBone);
 			}
@@ -878,10 +1288,10 @@ void AnimataWindow::handleLeftMousePress(void)
 				if (!(pointedBone->selected))
 				{
 					cSkeleton->clearSelection();
-					pointedBone->selected = true;
+					cSkeleton->selectBone(pointedBone);
 
 					cMesh->clearSelection();
-					pointedBone->selectAttachedVertices();
+					pointedBone->selectAttachedVertices(cMesh);
 				}
 				setAttachUIPrefs(pointedBone);
 			}
@@ -902,6 +1312,18 @@ void AnimataWindow::handleLeftMousePress(void)
 			break;
 
 		case ANIMATA_MODE_CREATE_TRIANGLE:
+			if (!pointedVertex)
+			{
+				// clicking next to an edge continues the mesh from the edge,
+				// the face gets created by clicking on its third vertex
+				int edge;
+				if (Face *face = selector->doPickEdge(camera, cLayer, mouseX, mouseY, &edge))
+				{
+					pointedPrevVertex = face->v[edge];
+					pointedVertex = face->v[(edge + 1) % 3];
+				}
+			}
+			else
 			if (pointedPrevPrevVertex && pointedPrevVertex && pointedVertex)
 			{
 				cMesh->addFace(pointedPrevPrevVertex, pointedPrevVertex, pointedVertex);
@@ -969,7 +1391,7 @@ void AnimataWindow::handleLeftMouseRelease()
 					 * because the selection has been flipped already on
 					 * mouse button press */
 					if (!Fl::event_state(FL_CTRL))
-						pointedJoint->selected = true;
+						cSkeleton->selectJoint(pointedJoint);
 				}
 				else
 				{
@@ -985,7 +1407,7 @@ void AnimataWindow::handleLeftMouseRelease()
 					if (!Fl::event_state(FL_SHIFT | FL_CTRL))
 						cSkeleton->clearSelection();
 					if (!Fl::event_state(FL_CTRL))
-						pointedBone->selected = true;
+						cSkeleton->selectBone(pointedBone);
 				}
 				else
 				{
@@ -1029,6 +1451,7 @@ void AnimataWindow::handleMouseDrag(void)
 	mouseY = Fl::event_y();
 
 	dragging = true;
+	lassoPoints->push_back(Vector2D(mouseX, mouseY));
 	Vector2D dragTrans = transformMouseToWorld(dragMouseX, dragMouseY);
 
 	// transform the mouse coordinates based on the transformation of the current layer
@@ -1141,6 +1564,24 @@ void AnimataWindow::handleMouseWheel(void)
  * Event handler.
  **/
 int AnimataWindow::handle(int event)
+{
+	// mouse and keyboard events change the picture or the highlight
+	requestRedraw();
+
+	// the simulation waits while the scene is edited
+	lock();
+	int r = handleEvent(event);
+	unlock();
+
+	return r;
+}
+
+/**
+ * Handles the events of the editor window with the scene locked.
+ * \param event the event to handle
+ * \return 1 if the event was used, 0 otherwise
+ **/
+int AnimataWindow::handleEvent(int event)
 {
 	switch (event)
 	{
@@ -1188,6 +1629,10 @@ int AnimataWindow::handle(int event)
                 cout << "UPDATING TEXTURES" << endl;
                 updateTextures();
 			}
+			if(Fl::event_key() == 'o') {
+				// optimize the mesh of the current layer for vertex cache reuse
+				MeshOptimizer::optimize(cMesh, true);
+			}
 			if(Fl::event_key() == FL_Escape) {
                 cout << "ESC key pressed" << endl;
 				exit(0);
@@ -1223,7 +1668,8 @@ void AnimataWindow::setJointUIPrefs(Joint *j)
  **/
 void AnimataWindow::setJointPrefsFromUI(enum ANIMATA_PREFERENCES prefParam, void *value)
 {
-	cSkeleton->setSelectedJointParameters(prefParam, value);
+	simulation->post(new PreferenceCommand(cLayer, prefParam, value));
+	requestRedraw();
 }
 
 /**
@@ -1250,7 +1696,9 @@ void AnimataWindow::setBoneUIPrefs(Bone *b)
  **/
 void AnimataWindow::setBonePrefsFromUI(const char *name, float stiffness, float lengthMult)
 {
-	cSkeleton->setSelectedBoneParameters(name, stiffness, lengthMult);
+	simulation->post(new BonePreferenceCommand(cLayer,
+			BonePreferenceCommand::BONE_PARAMETERS, name, stiffness, lengthMult));
+	requestRedraw();
 }
 
 /**
@@ -1259,7 +1707,9 @@ void AnimataWindow::setBonePrefsFromUI(const char *name, float stiffness, float
  **/
 void AnimataWindow::setBoneLengthMultMin(float p)
 {
-	cSkeleton->setSelectedBoneLengthMultMin(p);
+	simulation->post(new BonePreferenceCommand(cLayer,
+			BonePreferenceCommand::BONE_LENGTH_MULT_MIN, NULL, p));
+	requestRedraw();
 }
 
 /**
@@ -1268,7 +1718,9 @@ void AnimataWindow::setBoneLengthMultMin(float p)
  **/
 void AnimataWindow::setBoneLengthMultMax(float p)
 {
-	cSkeleton->setSelectedBoneLengthMultMax(p);
+	simulation->post(new BonePreferenceCommand(cLayer,
+			BonePreferenceCommand::BONE_LENGTH_MULT_MAX, NULL, p));
+	requestRedraw();
 }
 
 /**
@@ -1277,7 +1729,9 @@ void AnimataWindow::setBoneLengthMultMax(float p)
  **/
 void AnimataWindow::setBoneTempo(float p)
 {
-	cSkeleton->setSelectedBoneTempo(p);
+	simulation->post(new BonePreferenceCommand(cLayer,
+			BonePreferenceCommand::BONE_TEMPO, NULL, p));
+	requestRedraw();
 }
 
 /**
@@ -1287,8 +1741,9 @@ void AnimataWindow::setBoneTempo(float p)
  **/
 void AnimataWindow::setAttachPrefsFromUI(float area /* = FLT_MAX*/, float falloff /* = FLT_MAX */)
 {
-	cSkeleton->setSelectedBoneParameters(NULL, FLT_EPSILON, -1, area, falloff);
-	cSkeleton->selectVerticesInRange(cMesh);
+	simulation->post(new BonePreferenceCommand(cLayer,
+			BonePreferenceCommand::BONE_ATTACH, NULL, area, falloff));
+	requestRedraw();
 }
 
 /**
@@ -1298,47 +1753,33 @@ void AnimataWindow::setAttachPrefsFromUI(float area /* = FLT_MAX*/, float fallof
 void AnimataWindow::setAttachUIPrefs(Bone *b)
 {
 	ui->attachArea->value(b->getRadiusMult());
-	cSkeleton->selectVerticesInRange(cMesh);
+	cSkeleton->selectVerticesInRange(cLayer);
 	ui->attachFalloff->value(b->getFalloff());
 	// TODO: check if tab switching is needed
 	ui->skeletonPrefTabs->value(ui->attachVertices);
 }
 
 /**
- * Sets layer preferences from the user interface.
+ * Sets layer preferences from the user interface on the selected layers, or
+ * on the current layer if none is selected. The name is only set on the
+ * current layer. The preferences are applied by the simulation thread
+ * between two steps.
  * \param prefParam parameter to set
  * \param value parameter value cast to (void *)
  **/
 void AnimataWindow::setLayerPrefsFromUI(enum ANIMATA_PREFERENCES prefParam, void *value)
 {
-	// vector<Layer *>::iterator l = selectedLayers.begin();
-
-	switch (prefParam)
+	lock();
+	if (selectedLayers.empty() || (prefParam == PREFS_LAYER_NAME))
+		simulation->post(new PreferenceCommand(cLayer, prefParam, value));
+	else
 	{
-		case PREFS_LAYER_NAME:
-			/*
-			for (; l < selectedLayers.end(); l++)
-				(*l)->setName(*((const char **)value));
-			*/
-			cLayer->setName(*((const char **)value));
-			break;
-		case PREFS_LAYER_ALPHA:
-			/*
-			for (; l < selectedLayers.end(); l++)
-				(*l)->setAlpha(*((float *)value));
-			*/
-			cLayer->setAlpha(*((float *)value));
-			break;
-		case PREFS_LAYER_VISIBILITY:
-			/*
-			for (; l < selectedLayers.end(); l++)
-				(*l)->setVisibility(*((int *)value));
-			*/
-			cLayer->setVisibility(*((int *)value));
-			break;
-		default:
-			break;
+		vector<Layer *>::iterator l = selectedLayers.begin();
+		for (; l < selectedLayers.end(); l++)
+			simulation->post(new PreferenceCommand(*l, prefParam, value));
 	}
+	unlock();
+	requestRedraw();
 }
 
 /**
@@ -1374,13 +1815,20 @@ void AnimataWindow::unlock(void)
 
 void timerCallback(void *v)
 {
-	ui->editorBox->lock();
-	ui->editorBox->redraw();
-	ui->playback->redraw();
-	ui->editorBox->unlock();
+	FrameScheduler *scheduler = ui->playback->getFrameScheduler();
+	scheduler->setRate(ui->settings.fps);
 
-	usleep(1);
-	Fl::repeat_timeout(1.0/ui->settings.fps, timerCallback);
+	// the windows are only redrawn if the frame differs from the last one,
+	// but the simulation keeps running with the same cadence
+	if (ui->editorBox->advance())
+	{
+		ui->editorBox->redraw();
+		ui->playback->redraw();
+	}
+
+	// the timeout is set to the next deadline of the frame grid, so the
+	// delay of the callback does not accumulate
+	Fl::add_timeout(scheduler->next(), timerCallback);
 }
 
 void loadFileAtStartup(void *filename)
@@ -1396,6 +1844,32 @@ void init(void)
 int main(int argc, char **argv)
 {
 	ui = new AnimataUI();
+
+	/* render the scene into files without opening any window */
+	HeadlessRenderer renderer;
+	bool render = renderer.parseArguments(argc, argv);
+	if (renderer.hasArgumentError())
+	{
+		delete ui;
+		return 1;
+	}
+	if (render)
+	{
+		int r = renderer.run();
+		delete ui;
+		return r;
+	}
+
+	/* publish the playback window for other processes, the slots are sized
+	 * for a fullscreen window and grow if it is larger */
+	SharedFrameOutput *frameOutput = NULL;
+	if (renderer.getFrameOutputName())
+	{
+		frameOutput = new SharedFrameOutput(renderer.getFrameOutputName(),
+				Fl::w(), Fl::h());
+		ui->playback->setFrameOutput(frameOutput);
+	}
+
 	ui->editorBox->startup();
 	ui->show();
 	/* make window cover the whole screen */
@@ -1404,16 +1878,18 @@ int main(int argc, char **argv)
 	init();
 
 	/* load file if there's a command line argument */
-	if (argc > 1)
+	if (renderer.getSceneFile())
 	{
 		/* FIXME: loading file after fltk's mainloop has started, so opengl
 		 * gets initialised, otherwise textures can't be uploaded */
-		Fl::add_timeout(0.1, loadFileAtStartup, argv[1]);
+		Fl::add_timeout(0.1, loadFileAtStartup,
+				(void *)renderer.getSceneFile());
 	}
 
 	Fl::run();
 
 	delete ui;
+	delete frameOutput;
 
 	return 0;
 }
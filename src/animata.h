@@ -51,8 +51,14 @@
 #include "IO.h"
 #include "Camera.h"
 #include "OSCManager.h"
+#include "RenderQueue.h"
+#include "GlyphBatch.h"
+#include "ImpostorCache.h"
+#include "ViewTransform.h"
+#include "SimulationThread.h"
 #include "ImageBox.h"
 #include "Preferences.h"
+#include "NameIndex.h"
 
 using namespace std;
 
@@ -134,6 +140,8 @@ class AnimataSettings
 		int triangulateAlphaThreshold; /**< triangulation threshold */
 
 		AnimataSettings();
+
+		int operator != (AnimataSettings &s);
 };
 
 /// Main application window class.
@@ -147,6 +155,8 @@ class AnimataWindow : public Fl_Gl_Window
 		/** mouse coordinates where the dragging started */
 		int dragMouseX, dragMouseY;
 		bool dragging; /**< set to true while dragging the mouse */
+		/** points of the lasso in view coordinates while dragging with alt */
+		vector<Vector2D> *lassoPoints;
 
 		/** transformed mouse coordinates, based on current layers transformation */
 		Vector2D	transMouse;
@@ -171,7 +181,6 @@ class AnimataWindow : public Fl_Gl_Window
 
 		vector<Layer *> selectedLayers;
 
-		/* FIXME: use multimap instead of vectors and store only named elements */
 		/* the following vectors are needed to reach the elements quickly
 		 * without traversing the whole hierarcy recursively */
 		/** vector of all layers without the hierarchical structure */
@@ -181,8 +190,18 @@ class AnimataWindow : public Fl_Gl_Window
 		/** vector of all joints without the hierarchical structure */
 		vector<Joint *> *allJoints;
 
-		/** vector of all joints needed to be send via OSC */
-		vector<Joint *> *oscJoints;
+		/* the named elements of the vectors above hashed by name, for the
+		 * OSC messages addressing them */
+		NameIndex<Layer> *layerNames;	///< named layers
+		NameIndex<Bone> *boneNames;		///< named bones
+		NameIndex<Joint> *jointNames;	///< named joints
+		/** changed whenever an element is added, deleted or renamed, the
+		 * results derived from the names are valid while it is the same */
+		unsigned nameVersion;
+
+		/** handles of all joints needed to be send via OSC, the sender
+		 * thread resolves them, so joints deleted meanwhile are skipped */
+		vector<Handle> *oscJoints;
 
 		Layer			*cLayer; /**< current layer */
 		Mesh			*cMesh;	 /**< mesh of current layer */
@@ -193,10 +212,16 @@ class AnimataWindow : public Fl_Gl_Window
 
 		OSCListener		*oscListener; /**< handles osc messages */
 		OSCSender		*oscSender; /**< transmits osc messages */
+		SimulationThread	*simulation; /**< runs the simulation beside the drawing */
 
 		Camera			*camera;
 
-		pthread_mutex_t mutex;
+		RenderQueue		*renderQueue; /**< batches the textured layers by texture */
+		GlyphBatch		*glyphBatch; /**< batches the joints, vertices and bones of a layer */
+		ViewTransform	*viewTransform; /**< view coordinates of the layers seen by the camera */
+		ImpostorCache	*impostorCache; /**< cached images of the static layers */
+
+		pthread_mutex_t mutex; /**< recursive lock of the scene */
 
 		void handleLeftMousePress(void);
 		void handleRightMousePress(void);
@@ -205,6 +230,7 @@ class AnimataWindow : public Fl_Gl_Window
 		void handleMouseMotion(void);
 		void handleMouseDrag(void);
 		void handleMouseWheel(void);
+		int handleEvent(int event);
 
 		/// Erases scene and initialises values.
 		void cleanup(void);
@@ -224,6 +250,10 @@ class AnimataWindow : public Fl_Gl_Window
 
 		bool bDoUpdateTextures;
 
+		volatile bool	redrawRequested; /**< set when the next frame differs from the last drawn one */
+		AnimataSettings	drawnSettings; /**< settings the last frame was drawn with */
+		unsigned		drawnRevision; /**< last mesh revision when the last frame was drawn */
+
 	public:
 		AnimataWindow(int x, int y, int w, int h, const char* l);
 		~AnimataWindow();
@@ -238,7 +268,7 @@ class AnimataWindow : public Fl_Gl_Window
 		/// Saves scene under the specified filename.
 		void saveScene(const char *filename);
 		/// Loads scene from the file specified by filename.
-		void loadScene(const char *filename);
+		bool loadScene(const char *filename);
 		/// Imports scene from the file specified by filename.
 		void importScene(const char *filename);
 
@@ -253,6 +283,13 @@ class AnimataWindow : public Fl_Gl_Window
 		void draw(void);
 		void triangulate(void);
 
+		bool advance(void);
+		/**
+		 * Requests redrawing the editor and playback windows at the next
+		 * timer tick. Can be called from any thread.
+		 **/
+		inline void requestRedraw(void) { redrawRequested = true; }
+
 		void attachVertices(void);
 		void disattachVertices(void);
 
@@ -281,6 +318,20 @@ class AnimataWindow : public Fl_Gl_Window
 		 * \return pointer to camera
 		 **/
 		inline Camera *getCamera() { return camera; }
+		/**
+		 * Returns the view transform stage of the camera.
+		 * \return pointer to the view transform
+		 **/
+		inline ViewTransform *getViewTransform() { return viewTransform; }
+
+		void getLayerTransformation(Layer *layer, Matrix *m);
+		/**
+		 * Returns the cache of the static layer images.
+		 * \return pointer to the impostor cache
+		 **/
+		inline ImpostorCache *getImpostorCache() { return impostorCache; }
+		/// Returns the listener applying the OSC messages.
+		inline OSCListener *getOSCListener() { return oscListener; }
 		/**
 		 * Returns current mesh.
 		 * \return pointer to mesh
@@ -300,7 +351,7 @@ class AnimataWindow : public Fl_Gl_Window
 		 * \param l layer to be the current
 		 **/
 		void setCurrentLayer(Layer *l);
-		void setSelectedLayers(Layer *l, int num);
+		void setSelectedLayers(vector<Layer *> *layers);
 
 		void createAttachedTexture(ImageBox *box);
 
@@ -318,32 +369,45 @@ class AnimataWindow : public Fl_Gl_Window
 		void deleteFromAllLayers(Layer *layer);
 		/// Returns the vector storing all layers.
 		inline vector<Layer *> *getAllLayers() { return allLayers; }
+		/// Returns the named layers hashed by name.
+		inline NameIndex<Layer> *getLayerNames() { return layerNames; }
 
 		/** Adds bone to vector of all bones.
 		 * \param b bone pointer to add
 		 **/
-		inline void addToAllBones(Bone *b) { allBones->push_back(b); }
+		inline void addToAllBones(Bone *b)
+			{ allBones->push_back(b); boneNames->add(b); namesChanged(); }
 		void deleteFromAllBones(Bone *bone);
 		/// Returns the vector storing all bones.
 		inline vector<Bone *> *getAllBones() { return allBones; }
+		/// Returns the named bones hashed by name.
+		inline NameIndex<Bone> *getBoneNames() { return boneNames; }
 
 		/** Adds joint to vector of all joints.
 		 * \param j joint pointer to add
 		 **/
-		inline void addToAllJoints(Joint *j) { allJoints->push_back(j); }
+		inline void addToAllJoints(Joint *j)
+			{ allJoints->push_back(j); jointNames->add(j); namesChanged(); }
 		/// Deletes joint from the vector of all joints.
 		void deleteFromAllJoints(Joint *joint);
 		/// Returns the vector storing all joints.
 		inline vector<Joint *> *getAllJoints() { return allJoints; }
+		/// Returns the named joints hashed by name.
+		inline NameIndex<Joint> *getJointNames() { return jointNames; }
+
+		/// Notes that an element has been added, deleted or renamed.
+		inline void namesChanged() { nameVersion++; }
+		/// Returns the version of the element names.
+		inline unsigned getNameVersion() { return nameVersion; }
 
 		/** Adds joint to vector of OSC joints.
 		 * \param j joint pointer to add
 		 **/
-		inline void addToOSCJoints(Joint *j) { oscJoints->push_back(j); }
+		inline void addToOSCJoints(Joint *j) { oscJoints->push_back(j->handle); }
 		/// Deletes joint from the vector of OSC joints.
 		void deleteFromOSCJoints(Joint *joint);
-		/// Returns the vector storing OSC joints.
-		inline vector<Joint *> *getOSCJoints() { return oscJoints; }
+		/// Returns the handles of the OSC joints, use it with the scene locked.
+		inline vector<Handle> *getOSCJoints() { return oscJoints; }
 
 		void lock(void);
 		void unlock(void);
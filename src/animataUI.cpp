@@ -533,19 +533,16 @@ if (n)
 	}
 }
 
-/*
+// the layer preferences are applied to all selected layers
+vector<Layer *> layers;
 int l = layerTree->num_selected();
-Layer *layers = new Layer[l];
-Layer *actLayer = layers;
-for (int i = 0; i < l; i++)
+for (int i = 1; i <= l; i++)
 {
-	Flu_Tree_Browser::Node* n = layerTree->get_selected(i);
-	actLayer = (Layer *)n->user_data();
-	actLayer++;
+	Flu_Tree_Browser::Node* node = layerTree->get_selected(i);
+	if (node->user_data())
+		layers.push_back((Layer *)node->user_data());
 }
-editorBox->setSelectedLayers(layers, l);
-delete [] layers;
-*/
+editorBox->setSelectedLayers(&layers);
 
 window->redraw();
 }
@@ -0,0 +1,168 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+/*
+ * Checks the name index with the elements of a scene. The joints and layers
+ * are added to the index unnamed and named afterwards, in the same order as
+ * the scene loader and the editor do it, then they are looked up by name.
+ *
+ * usage: nameindextest [scene.nmt]
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+#include "tinyxml.h"
+#include "NameIndex.h"
+
+using namespace std;
+using namespace Animata;
+
+/// Named element of the scene, like a Joint or a Layer.
+class Element
+{
+	public:
+		bool inNameIndex;
+
+		Element() { name[0] = 0; inNameIndex = false; }
+
+		const char *getName(void) { return name; }
+
+		/// Renames the element like Joint::setName() does.
+		void setName(NameIndex<Element> *index, const char *str)
+		{
+			bool indexed = index->remove(this);
+
+			strncpy(name, str, 15);
+			name[15] = 0;
+
+			if (indexed)
+				index->add(this);
+		}
+
+	private:
+		char name[16];
+};
+
+static int failures = 0;
+
+static void check(bool ok, const char *what, const char *name)
+{
+	if (!ok)
+	{
+		fprintf(stderr, "FAILED: %s: %s\n", what, name);
+		failures++;
+	}
+}
+
+/**
+ * Collects the named joints and layers of the scene, the elements are
+ * registered before they are named like in IO::load().
+ **/
+static void load(TiXmlElement *node, NameIndex<Element> *index,
+		vector<Element *> *elements, vector<string> *names)
+{
+	for (; node; node = node->NextSiblingElement())
+	{
+		const char *name = node->Attribute("name");
+		if ((strcmp(node->Value(), "joint") == 0) ||
+			(strcmp(node->Value(), "layer") == 0))
+		{
+			Element *e = new Element();
+			index->add(e);
+			if (name)
+				e->setName(index, name);
+			elements->push_back(e);
+			names->push_back(name ? e->getName() : "");
+		}
+		load(node->FirstChildElement(), index, elements, names);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const char *filename = (argc > 1) ? argv[1] :
+		"../examples/scenes/babel/babel.nmt";
+
+	TiXmlDocument doc(filename);
+	if (!doc.LoadFile())
+	{
+		fprintf(stderr, "cannot load %s\n", filename);
+		return 1;
+	}
+
+	NameIndex<Element> *index = new NameIndex<Element>;
+	vector<Element *> elements;
+	vector<string> names;
+	load(doc.RootElement(), index, &elements, &names);
+
+	unsigned named = 0;
+	for (unsigned i = 0; i < elements.size(); i++)
+	{
+		if (names[i].empty())
+			continue;
+		named++;
+
+		vector<Element *> found;
+		index->find(names[i].c_str(), &found);
+		check(find(found.begin(), found.end(), elements[i]) != found.end(),
+				"loaded element is not found by name", names[i].c_str());
+	}
+	check(index->size() == named, "wrong number of named elements", filename);
+
+	if (!elements.empty())
+	{
+		// renamed elements are found by the new name only
+		Element *e = elements[0];
+		string oldName = e->getName();
+		e->setName(index, "renamed");
+		vector<Element *> found;
+		index->find("renamed", &found);
+		check(find(found.begin(), found.end(), e) != found.end(),
+				"renamed element is not found", "renamed");
+		found.clear();
+		index->find(oldName.c_str(), &found);
+		check(find(found.begin(), found.end(), e) == found.end(),
+				"renamed element is found by its old name", oldName.c_str());
+
+		// removed elements are not found and are not added back on rename
+		index->remove(e);
+		e->setName(index, "removed");
+		found.clear();
+		index->find("removed", &found);
+		check(found.empty(), "removed element is found", "removed");
+	}
+
+	printf("%s: %u elements, %u named, %d failures\n", filename,
+			(unsigned)elements.size(), named, failures);
+
+	for (unsigned i = 0; i < elements.size(); i++)
+		delete elements[i];
+	delete index;
+
+	return failures ? 1 : 0;
+}
+
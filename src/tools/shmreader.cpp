@@ -0,0 +1,237 @@
+/*
+ Animata
+
+ Copyright (C) 2007 Peter Nemeth, Gabor Papp, Bence Samu
+ Kitchen Budapest, <http://animata.kibu.hu/>
+
+ This file is part of Animata.
+
+ Animata is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Animata is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Animata. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+/*
+ * Reference reader of the shared frame output of Animata.
+ *
+ * usage: shmreader name [frames] [out_%05d.ppm]
+ *
+ * Waits for the frames published under the given name, prints their number,
+ * size and latency, and optionally saves them as PPM images.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "../SharedFrameOutput.h"
+
+using namespace Animata;
+
+static double now(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/**
+ * Copies the latest frame out of the ring. The copy is retried if the
+ * writer has overwritten the slot meanwhile.
+ * \param header the mapped shared memory
+ * \param info the header of the copied frame is returned here
+ * \param pixels buffer of slotSize bytes for the pixels
+ * \return true if a frame could be copied
+ **/
+static bool readLatest(SharedFrameHeader *header, SharedFrameSlot *info,
+		unsigned char *pixels)
+{
+	for (int tries = 0; tries < 16; tries++)
+	{
+		unsigned latest = header->latest;
+		if (latest == 0)
+			return false;
+
+		unsigned index = (latest - 1) % header->slotCount;
+		SharedFrameSlot *slot = (SharedFrameSlot *)(header + 1) + index;
+
+		unsigned sequence = slot->sequence;
+		__sync_synchronize();
+		if (sequence & 1)
+			continue;
+
+		*info = *slot;
+		if (info->stride * info->height <= header->slotSize)
+		{
+			memcpy(pixels, (unsigned char *)header + header->dataOffset +
+					(size_t)index * header->slotSize,
+					info->stride * info->height);
+		}
+
+		__sync_synchronize();
+		if ((slot->sequence == sequence) &&
+			(info->stride * info->height <= header->slotSize))
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * Maps the shared memory of the frame output.
+ * \param name name of the shared memory
+ * \param size the size of the mapping is returned here
+ * \return the mapped header, or NULL on error
+ **/
+static SharedFrameHeader *openOutput(const char *name, size_t *size)
+{
+	int fd = shm_open(name, O_RDONLY, 0);
+	struct stat st;
+	if ((fd < 0) || (fstat(fd, &st) != 0))
+	{
+		perror(name);
+		return NULL;
+	}
+
+	void *p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED)
+	{
+		perror(name);
+		return NULL;
+	}
+
+	SharedFrameHeader *header = (SharedFrameHeader *)p;
+	if (strncmp(header->magic, SHARED_FRAME_MAGIC, sizeof(header->magic)) ||
+		(header->version != SHARED_FRAME_VERSION))
+	{
+		fprintf(stderr, "%s: not an animata frame output\n", name);
+		munmap(p, st.st_size);
+		return NULL;
+	}
+
+	*size = st.st_size;
+	return header;
+}
+
+static bool writePPM(const char *filename, SharedFrameSlot *info,
+		unsigned char *pixels)
+{
+	FILE *f = fopen(filename, "wb");
+	if (f == NULL)
+		return false;
+
+	fprintf(f, "P6\n%d %d\n255\n", info->width, info->height);
+	for (unsigned y = 0; y < info->height; y++)
+	{
+		unsigned row = (info->flags & SHARED_FRAME_BOTTOM_UP) ?
+			info->height - 1 - y : y;
+		unsigned char *p = pixels + row * info->stride;
+		for (unsigned x = 0; x < info->width; x++, p += 4)
+			fwrite(p, 1, 3, f);
+	}
+
+	fclose(f);
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: shmreader name [frames] [out_%%05d.ppm]\n");
+		return 1;
+	}
+
+	char name[256];
+	char semName[264];
+	snprintf(name, sizeof(name), "%s%s", argv[1][0] == '/' ? "" : "/",
+			argv[1]);
+	snprintf(semName, sizeof(semName), "%s-frame", name);
+	int frames = (argc > 2) ? atoi(argv[2]) : 0;
+	const char *pattern = (argc > 3) ? argv[3] : NULL;
+
+	size_t size;
+	SharedFrameHeader *header = openOutput(name, &size);
+	if (header == NULL)
+		return 1;
+
+	sem_t *semaphore = sem_open(semName, 0);
+	if (semaphore == SEM_FAILED)
+	{
+		perror(semName);
+		return 1;
+	}
+
+	printf("%s: %d slots of %dx%d\n", name, header->slotCount,
+			header->maxWidth, header->maxHeight);
+
+	unsigned char *pixels = new unsigned char[header->slotSize];
+	SharedFrameSlot info;
+	unsigned last = 0;
+	int count = 0;
+
+	while ((frames <= 0) || (count < frames))
+	{
+		if (sem_wait(semaphore) != 0)
+			break;
+
+		// the output was created again with larger slots
+		if (header->replaced)
+		{
+			munmap(header, size);
+			header = openOutput(name, &size);
+			if (header == NULL)
+				break;
+
+			printf("%s: %d slots of %dx%d\n", name, header->slotCount,
+					header->maxWidth, header->maxHeight);
+			delete [] pixels;
+			pixels = new unsigned char[header->slotSize];
+		}
+
+		if (!readLatest(header, &info, pixels) || (info.frame == last))
+			continue;
+
+		printf("frame %u: %ux%u, %u dropped, latency %.2f ms\n",
+				info.frame, info.width, info.height,
+				last ? info.frame - last - 1 : 0,
+				(now() - info.timestamp) * 1000.0);
+		last = info.frame;
+
+		if (pattern)
+		{
+			char filename[PATH_MAX];
+			snprintf(filename, PATH_MAX, pattern, count);
+			if (!writePPM(filename, &info, pixels))
+				perror(filename);
+		}
+		count++;
+	}
+
+	delete [] pixels;
+	sem_close(semaphore);
+	if (header)
+		munmap(header, size);
+
+	return 0;
+}
+